@@ -0,0 +1,690 @@
+#include "MarchingCubes.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+namespace LG {
+
+namespace {
+
+// cells per block along every axis
+const int BLOCK = 16;
+
+// grid points of a block along every axis, including the layer shared with
+// the next block
+const int BLOCK_POINTS = BLOCK + 1;
+
+// one bit per point and axis for the crossed edges of a block
+const int BLOCK_WORDS = (BLOCK_POINTS * BLOCK_POINTS * BLOCK_POINTS * 3 + 63) / 64;
+
+const int MAX_CASE_TRIANGLES = 12;
+
+// smallest distance of a vertex from the grid points of its edge, as a
+// fraction of the edge
+const Scalar ISO_NUDGE = Scalar(1e-3);
+
+inline int popcount(uint64_t x)
+{
+  return (int)std::bitset<64>(x).count();
+}
+
+
+//== CASE TABLE ===============================================================
+
+
+// Triangulate the polygon of cell edges p[0..n) into t without a diagonal
+// between two edges of a common cube face: the neighbour cell behind that face
+// could use the same diagonal, giving an edge with four triangles.
+bool triangulate(const int* p, int n, const bool on_common_face[12][12], int* t)
+{
+  if (n == 3)
+  {
+    t[0] = p[0];
+    t[1] = p[1];
+    t[2] = p[2];
+    return true;
+  }
+
+  // the triangle on side (p[0], p[n-1]) with apex p[k]
+  for (int k = 1; k < n - 1; ++k)
+  {
+    if ((k > 1 && on_common_face[p[0]][p[k]]) || (k < n - 2 && on_common_face[p[k]][p[n - 1]]))
+    {
+      continue;
+    }
+    int* rest = t + 3;
+    if (k > 1 && !triangulate(p, k + 1, on_common_face, rest))
+    {
+      continue;
+    }
+    rest += (k > 1) ? 3 * (k - 1) : 0;
+    if (k < n - 2 && !triangulate(p + k, n - k, on_common_face, rest))
+    {
+      continue;
+    }
+    t[0] = p[0];
+    t[1] = p[k];
+    t[2] = p[n - 1];
+    return true;
+  }
+  return false;
+}
+
+
+// Corner c of a cell lies at offset (c & 1, (c >> 1) & 1, (c >> 2) & 1), bit c
+// of the case index is set if the corner is inside.
+struct Case_table
+{
+  Case_table();
+
+  // cell edge e starts at corner edge_corner[e] and runs along edge_axis[e]
+  int edge_corner[12];
+  int edge_axis[12];
+
+  // triangles of every case as triples of cell edges
+  unsigned char n_triangles[256];
+  unsigned char triangles[256][3 * MAX_CASE_TRIANGLES];
+};
+
+
+Case_table::Case_table()
+{
+  // edges along x, then along y, then along z
+  int edge_of[8][8];
+  int n_edges = 0;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    for (int c = 0; c < 8; ++c)
+    {
+      if (!(c & (1 << axis)))
+      {
+        const int d = c | (1 << axis);
+        edge_corner[n_edges] = c;
+        edge_axis[n_edges]   = axis;
+        edge_of[c][d] = edge_of[d][c] = n_edges;
+        ++n_edges;
+      }
+    }
+  }
+
+  // corners of the six faces, counterclockwise seen from outside the cell
+  int face[6][4];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    const int u = 1 << ((axis + 1) % 3), v = 1 << ((axis + 2) % 3), w = 1 << axis;
+    const int quad[4] = { 0, u, u | v, v };
+    for (int i = 0; i < 4; ++i)
+    {
+      face[2 * axis][i]     = quad[3 - i];
+      face[2 * axis + 1][i] = quad[i] | w;
+    }
+  }
+
+  // cell edges on a common face
+  bool on_common_face[12][12] = { { false } };
+  for (int f = 0; f < 6; ++f)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        on_common_face[edge_of[face[f][i]][face[f][(i + 1) % 4]]][edge_of[face[f][j]][face[f][(j + 1) % 4]]] = true;
+      }
+    }
+  }
+
+  for (int mask = 0; mask < 256; ++mask)
+  {
+    // On every face the surface runs from the edge where the face boundary
+    // leaves a run of inside corners back to the edge where it entered the
+    // run. Diagonally opposite inside corners are thereby cut off separately,
+    // which only depends on the face, so both cells of a face agree.
+    int next[12];
+    for (int e = 0; e < 12; ++e)
+    {
+      next[e] = -1;
+    }
+    for (int f = 0; f < 6; ++f)
+    {
+      bool inside[4];
+      for (int i = 0; i < 4; ++i)
+      {
+        inside[i] = (mask & (1 << face[f][i])) != 0;
+      }
+      for (int i = 0; i < 4; ++i)
+      {
+        if (inside[i] && !inside[(i + 1) % 4])
+        {
+          int j = (i + 3) % 4;
+          while (inside[j])
+          {
+            j = (j + 3) % 4;
+          }
+          next[edge_of[face[f][i]][face[f][(i + 1) % 4]]] = edge_of[face[f][j]][face[f][(j + 1) % 4]];
+        }
+      }
+    }
+
+    // every crossed edge starts one segment and ends another, the segments
+    // form closed polygons
+    n_triangles[mask] = 0;
+    bool used[12] = { false };
+    for (int start = 0; start < 12; ++start)
+    {
+      if (next[start] < 0 || used[start])
+      {
+        continue;
+      }
+      int polygon[12], n = 0;
+      for (int e = start; !used[e]; e = next[e])
+      {
+        used[e] = true;
+        polygon[n++] = e;
+      }
+      int triangulation[3 * MAX_CASE_TRIANGLES];
+      const bool found = triangulate(polygon, n, on_common_face, triangulation);
+      assert(found);
+      for (int i = 0; found && i < n - 2; ++i)
+      {
+        // the polygons run clockwise seen from outside
+        unsigned char* t = triangles[mask] + 3 * n_triangles[mask]++;
+        t[0] = (unsigned char)triangulation[3 * i];
+        t[1] = (unsigned char)triangulation[3 * i + 2];
+        t[2] = (unsigned char)triangulation[3 * i + 1];
+      }
+    }
+    assert(n_triangles[mask] <= MAX_CASE_TRIANGLES);
+  }
+}
+
+
+const Case_table& case_table()
+{
+  static const Case_table table;
+  return table;
+}
+
+}
+
+
+//== EXTRACTION ===============================================================
+
+
+namespace {
+
+// The extraction works on patches of BLOCK_POINTS^3 values copied from the
+// grid, a source provides the patches and the candidate blocks.
+
+// dense grid, every block is a candidate
+class Dense_source
+{
+public:
+  explicit Dense_source(const ScalarGrid& grid) : grid_(grid) {};
+
+  const ScalarGrid& grid() const { return grid_; };
+
+  void candidates(const int blocks[3], std::vector<size_t>& result) const
+  {
+    result.resize(size_t(blocks[0]) * blocks[1] * blocks[2]);
+    for (size_t b = 0; b < result.size(); ++b)
+    {
+      result[b] = b;
+    }
+  }
+
+  // n[0] x n[1] x n[2] values starting at point lo
+  void load(const int lo[3], const int n[3], Scalar* patch) const
+  {
+    for (int k = 0; k < n[2]; ++k)
+    {
+      for (int j = 0; j < n[1]; ++j)
+      {
+        const Scalar* row = &grid_.values()[grid_.index(lo[0], lo[1] + j, lo[2] + k)];
+        std::copy(row, row + n[0], patch + (k * BLOCK_POINTS + j) * BLOCK_POINTS);
+      }
+    }
+  }
+
+private:
+  const ScalarGrid& grid_;
+};
+
+
+// sparse grid, only blocks owning edges between differing grid blocks are
+// candidates
+class Sparse_source
+{
+public:
+  explicit Sparse_source(const SparseGrid& grid) : grid_(grid) {};
+
+  const SparseGrid& grid() const { return grid_; };
+
+  void candidates(const int blocks[3], std::vector<size_t>& result) const
+  {
+    // An edge can only be crossed if one of its points lies in an allocated
+    // grid block, or if it joins two tiles of different value: the tiles of a
+    // row of grid blocks take their sign from the allocated blocks of the row,
+    // so neighbouring rows may differ all along x. The candidates are the
+    // blocks owning the lower points of such edges, which are all points of
+    // allocated grid blocks and the last point layer of grid blocks before an
+    // allocated block or a differing tile, together with the blocks of the
+    // cells using these edges.
+    const int S = SparseGrid::BLOCK_SIZE;
+    result.clear();
+
+    // add the blocks owning the points [lo, hi] (inclusive) or a cell with
+    // one of them as a corner
+    auto add = [&](const int lo[3], const int hi[3])
+    {
+      int first[3], last[3];
+      for (int a = 0; a < 3; ++a)
+      {
+        first[a] = std::min(std::max(lo[a] - 1, 0) / BLOCK, blocks[a] - 1);
+      last[a]  = std::min(hi[a] / BLOCK, blocks[a] - 1);
+      }
+      for (int k = first[2]; k <= last[2]; ++k)
+      {
+        for (int j = first[1]; j <= last[1]; ++j)
+        {
+          for (int i = first[0]; i <= last[0]; ++i)
+          {
+            result.push_back((size_t(k) * blocks[1] + j) * blocks[0] + i);
+          }
+        }
+      }
+    };
+
+    // only rows with allocated blocks and their neighbours differ from the
+    // background
+    std::vector<size_t> rows;
+    for (int b = 0; b < (int)grid_.n_blocks(); ++b)
+    {
+      int c[3];
+      grid_.block_coordinates(b, c[0], c[1], c[2]);
+      for (int dk = -1; dk <= 1; ++dk)
+      {
+        for (int dj = -1; dj <= 1; ++dj)
+        {
+          const int bj = c[1] + dj, bk = c[2] + dk;
+          if ((dj == 0 || dk == 0) && bj >= 0 && bk >= 0 && bj < grid_.blocks(1) && bk < grid_.blocks(2))
+          {
+            rows.push_back(grid_.block_index(0, bj, bk));
+          }
+        }
+      }
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    // allocated grid block or tile value of block c
+    auto kind = [&](const int c[3], Scalar& tile)
+    {
+      const bool allocated = grid_.find_block(grid_.block_index(c[0], c[1], c[2])) >= 0;
+      tile = allocated ? Scalar(0) : grid_.tile_value(c[0], c[1], c[2]);
+      return allocated;
+    };
+
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+      const int bj = int((rows[r] / grid_.blocks(0)) % grid_.blocks(1));
+      const int bk = int(rows[r] / (size_t(grid_.blocks(0)) * grid_.blocks(1)));
+      for (int bi = 0; bi < grid_.blocks(0); ++bi)
+      {
+        const int c[3] = { bi, bj, bk };
+        int lo[3], hi[3];
+        for (int a = 0; a < 3; ++a)
+        {
+          lo[a] = c[a] * S;
+          hi[a] = std::min(lo[a] + S, grid_.size(a)) - 1;
+        }
+        Scalar tile;
+        const bool allocated = kind(c, tile);
+        if (allocated)
+        {
+          add(lo, hi);
+        }
+
+        for (int a = 0; a < 3; ++a)
+        {
+          int d[3] = { c[0], c[1], c[2] };
+          if (++d[a] >= grid_.blocks(a))
+          {
+            continue;
+          }
+          Scalar next_tile;
+          const bool next_allocated = kind(d, next_tile);
+          if (!allocated && (next_allocated || next_tile != tile))
+          {
+            int layer[3] = { lo[0], lo[1], lo[2] };
+            layer[a] = hi[a];
+            add(layer, hi);
+          }
+        }
+      }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  }
+
+  void load(const int lo[3], const int n[3], Scalar* patch) const
+  {
+    const int S = SparseGrid::BLOCK_SIZE;
+    for (int bk = lo[2] / S; bk <= (lo[2] + n[2] - 1) / S; ++bk)
+    {
+      for (int bj = lo[1] / S; bj <= (lo[1] + n[1] - 1) / S; ++bj)
+      {
+        for (int bi = lo[0] / S; bi <= (lo[0] + n[0] - 1) / S; ++bi)
+        {
+          // part of grid block (bi, bj, bk) inside the patch
+          int first[3], last[3];
+          const int c[3] = { bi, bj, bk };
+          for (int a = 0; a < 3; ++a)
+          {
+            first[a] = std::max(c[a] * S, lo[a]);
+            last[a]  = std::min(c[a] * S + S, lo[a] + n[a]);
+          }
+
+          const int b = grid_.find_block(grid_.block_index(bi, bj, bk));
+          const Scalar tile = (b < 0) ? grid_.tile_value(bi, bj, bk) : Scalar(0);
+          const Scalar* values = (b < 0) ? NULL : grid_.block_values(b);
+          for (int k = first[2]; k < last[2]; ++k)
+          {
+            for (int j = first[1]; j < last[1]; ++j)
+            {
+              Scalar* row = patch + ((k - lo[2]) * BLOCK_POINTS + (j - lo[1])) * BLOCK_POINTS - lo[0];
+              if (values)
+              {
+                const Scalar* src = values + ((k - bk * S) * S + (j - bj * S)) * S - bi * S;
+                std::copy(src + first[0], src + last[0], row + first[0]);
+              }
+              else
+              {
+                std::fill(row + first[0], row + last[0], tile);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+private:
+  const SparseGrid& grid_;
+};
+
+
+template <class Source>
+bool extract(const Source& source, Scalar iso, PolygonMesh& mesh)
+{
+  int cells[3], blocks[3];
+  for (int a = 0; a < 3; ++a)
+  {
+    cells[a] = source.grid().size(a) - 1;
+    if (cells[a] < 1)
+    {
+      std::cerr << "marching_cubes: the grid needs at least 2 points per axis" << std::endl;
+      return false;
+    }
+    blocks[a] = (cells[a] + BLOCK - 1) / BLOCK;
+  }
+  const Case_table& table = case_table();
+
+  // Block b covers the cells [lo, lo + BLOCK) and owns the points [lo, hi)
+  // per axis, the last block of an axis also owns the last point. Its patch
+  // holds the points [lo, lo + n), including the first points of the next
+  // blocks.
+  auto block_range = [&](size_t b, int lo[3], int hi[3], int n[3])
+  {
+    const int index[3] = { int(b % blocks[0]), int((b / blocks[0]) % blocks[1]),
+                           int(b / (size_t(blocks[0]) * blocks[1])) };
+    for (int a = 0; a < 3; ++a)
+    {
+      lo[a] = index[a] * BLOCK;
+      hi[a] = (index[a] + 1 == blocks[a]) ? cells[a] + 1 : lo[a] + BLOCK;
+      n[a]  = std::min(BLOCK, cells[a] - lo[a]) + 1;
+    }
+  };
+
+  const int stride[3] = { 1, BLOCK_POINTS, BLOCK_POINTS * BLOCK_POINTS };
+
+  // case index of the cell with lower corner p in the patch
+  auto cell_case = [&](const Scalar* patch, int p)
+  {
+    int mask = 0;
+    for (int c = 0; c < 8; ++c)
+    {
+      const int q = p + ((c & 1) ? stride[0] : 0) + ((c & 2) ? stride[1] : 0) + ((c & 4) ? stride[2] : 0);
+      mask |= (patch[q] < iso) ? (1 << c) : 0;
+    }
+    return mask;
+  };
+
+  Thread_local_storage< std::vector<Scalar> > patches(std::vector<Scalar>(BLOCK_POINTS * BLOCK_POINTS * BLOCK_POINTS));
+
+  // skip the blocks whose value range (including the upper point layer) does
+  // not contain iso
+  std::vector<size_t> candidates;
+  source.candidates(blocks, candidates);
+  std::vector<unsigned char> active(candidates.size());
+  parallel_for(0, candidates.size(), 1, [&](size_t first, size_t last)
+  {
+    Scalar* patch = &patches.local()[0];
+    for (size_t c = first; c < last; ++c)
+    {
+      int lo[3], hi[3], n[3];
+      block_range(candidates[c], lo, hi, n);
+      source.load(lo, n, patch);
+      Scalar min = patch[0], max = patch[0];
+      for (int k = 0; k < n[2]; ++k)
+      {
+        for (int j = 0; j < n[1]; ++j)
+        {
+          const Scalar* row = patch + (k * BLOCK_POINTS + j) * BLOCK_POINTS;
+          for (int i = 0; i < n[0]; ++i)
+          {
+            min = std::min(min, row[i]);
+            max = std::max(max, row[i]);
+          }
+        }
+      }
+      active[c] = (min < iso && !(max < iso)) ? 1 : 0;
+    }
+  });
+
+  std::vector<size_t> active_blocks;
+  for (size_t c = 0; c < candidates.size(); ++c)
+  {
+    if (active[c])
+    {
+      active_blocks.push_back(candidates[c]);
+    }
+  }
+  const int n_active = (int)active_blocks.size();
+
+  // mark the crossed edges owned by every active block and count its
+  // vertices and triangles; word_rank is the number of crossed edges of the
+  // block before each mask word
+  std::vector<uint64_t> crossed(size_t(n_active) * BLOCK_WORDS, 0);
+  std::vector<int> word_rank(size_t(n_active) * BLOCK_WORDS);
+  std::vector<int> vertex_start(n_active + 1, 0), triangle_start(n_active + 1, 0);
+  parallel_for(0, n_active, 1, [&](size_t first, size_t last)
+  {
+    Scalar* patch = &patches.local()[0];
+    for (size_t s = first; s < last; ++s)
+    {
+      int lo[3], hi[3], n[3];
+      block_range(active_blocks[s], lo, hi, n);
+      source.load(lo, n, patch);
+      uint64_t* mask = &crossed[s * BLOCK_WORDS];
+      int* rank = &word_rank[s * BLOCK_WORDS];
+
+      int n_triangles = 0;
+      for (int k = 0; k < hi[2] - lo[2]; ++k)
+      {
+        for (int j = 0; j < hi[1] - lo[1]; ++j)
+        {
+          for (int i = 0; i < hi[0] - lo[0]; ++i)
+          {
+            const int l[3] = { i, j, k };
+            const int p = (k * BLOCK_POINTS + j) * BLOCK_POINTS + i;
+            const bool inside = patch[p] < iso;
+            for (int a = 0; a < 3; ++a)
+            {
+              if (l[a] + 1 < n[a] && (patch[p + stride[a]] < iso) != inside)
+              {
+                mask[(3 * p + a) >> 6] |= uint64_t(1) << ((3 * p + a) & 63);
+              }
+            }
+            if (i + 1 < n[0] && j + 1 < n[1] && k + 1 < n[2])
+            {
+              n_triangles += table.n_triangles[cell_case(patch, p)];
+            }
+          }
+        }
+      }
+
+      int n_vertices = 0;
+      for (int w = 0; w < BLOCK_WORDS; ++w)
+      {
+        rank[w] = n_vertices;
+        n_vertices += popcount(mask[w]);
+      }
+      vertex_start[s + 1]   = n_vertices;
+      triangle_start[s + 1] = n_triangles;
+    }
+  });
+  for (int s = 0; s < n_active; ++s)
+  {
+    vertex_start[s + 1]   += vertex_start[s];
+    triangle_start[s + 1] += triangle_start[s];
+  }
+
+  // index of the vertex on the edge from grid point g along axis a, the
+  // owner is usually the block s itself; -1 if the owner is not active
+  auto vertex_index = [&](size_t s, const int g[3], int a)
+  {
+    int owner[3], local[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      owner[i] = std::min(g[i] / BLOCK, blocks[i] - 1);
+      local[i] = g[i] - owner[i] * BLOCK;
+    }
+    const size_t b = (size_t(owner[2]) * blocks[1] + owner[1]) * blocks[0] + owner[0];
+    if (b != active_blocks[s])
+    {
+      s = std::lower_bound(active_blocks.begin(), active_blocks.end(), b) - active_blocks.begin();
+      if (s == active_blocks.size() || active_blocks[s] != b)
+      {
+        // the owner was not a candidate, should not happen
+        return -1;
+      }
+    }
+    const int key = ((local[2] * BLOCK_POINTS + local[1]) * BLOCK_POINTS + local[0]) * 3 + a;
+    const size_t w = s * BLOCK_WORDS + (key >> 6);
+    const uint64_t below = (uint64_t(1) << (key & 63)) - 1;
+    return vertex_start[s] + word_rank[w] + popcount(crossed[w] & below);
+  };
+
+  // interpolate the vertices in mask order and emit the triangles
+  std::vector<Vec3> points(vertex_start[n_active]);
+  std::vector<int> triangles(3 * size_t(triangle_start[n_active]));
+  parallel_for(0, n_active, 1, [&](size_t first, size_t last)
+  {
+    Scalar* patch = &patches.local()[0];
+    for (size_t s = first; s < last; ++s)
+    {
+      int lo[3], hi[3], n[3];
+      block_range(active_blocks[s], lo, hi, n);
+      source.load(lo, n, patch);
+      const uint64_t* mask = &crossed[s * BLOCK_WORDS];
+
+      int v = vertex_start[s];
+      for (int w = 0; w < BLOCK_WORDS; ++w)
+      {
+        uint64_t bits = mask[w];
+        for (int bit = 0; bits; ++bit, bits >>= 1)
+        {
+          if (!(bits & 1))
+          {
+            continue;
+          }
+          const int key = w * 64 + bit, a = key % 3, p = key / 3;
+          const int i = p % BLOCK_POINTS;
+          const int j = (p / BLOCK_POINTS) % BLOCK_POINTS;
+          const int k = p / (BLOCK_POINTS * BLOCK_POINTS);
+          // A value equal to iso counts as outside, its vertex would land on
+          // the grid point together with those of the other crossed edges
+          // through it. Treat the value as slightly above iso instead.
+          Scalar t = (iso - patch[p]) / (patch[p + stride[a]] - patch[p]);
+          t = std::min(std::max(t, ISO_NUDGE), 1 - ISO_NUDGE);
+          Vec3 point = source.grid().point(lo[0] + i, lo[1] + j, lo[2] + k);
+          point[a] += t * source.grid().spacing();
+          points[v++] = point;
+        }
+      }
+
+      int* t = &triangles[3 * size_t(triangle_start[s])];
+      for (int k = 0; k + 1 < n[2] && k < hi[2] - lo[2]; ++k)
+      {
+        for (int j = 0; j + 1 < n[1] && j < hi[1] - lo[1]; ++j)
+        {
+          for (int i = 0; i + 1 < n[0] && i < hi[0] - lo[0]; ++i)
+          {
+            const int c = cell_case(patch, (k * BLOCK_POINTS + j) * BLOCK_POINTS + i);
+            for (int e = 0; e < 3 * table.n_triangles[c]; ++e)
+            {
+              const int edge = table.triangles[c][e], corner = table.edge_corner[edge];
+              const int g[3] = { lo[0] + i + (corner & 1), lo[1] + j + ((corner >> 1) & 1),
+                                 lo[2] + k + ((corner >> 2) & 1) };
+              *t++ = vertex_index(s, g, table.edge_axis[edge]);
+            }
+          }
+        }
+      }
+    }
+  });
+
+  // drop the triangles on edges of inactive blocks
+  size_t n_triangles = 0;
+  for (size_t t = 0; t < triangles.size(); t += 3)
+  {
+    if (triangles[t] >= 0 && triangles[t + 1] >= 0 && triangles[t + 2] >= 0)
+    {
+      std::copy(&triangles[t], &triangles[t] + 3, &triangles[3 * n_triangles++]);
+    }
+  }
+  if (3 * n_triangles < triangles.size())
+  {
+    std::cerr << "marching_cubes: skipped " << triangles.size() / 3 - n_triangles
+              << " triangles with vertices in inactive blocks" << std::endl;
+    triangles.resize(3 * n_triangles);
+  }
+
+  return mesh.add_triangles(points, triangles);
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool marching_cubes(const ScalarGrid& grid, Scalar iso, PolygonMesh& mesh)
+{
+  return extract(Dense_source(grid), iso, mesh);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool marching_cubes(const SparseGrid& grid, Scalar iso, PolygonMesh& mesh)
+{
+  return extract(Sparse_source(grid), iso, mesh);
+}
+
+}
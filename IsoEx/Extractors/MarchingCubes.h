@@ -0,0 +1,50 @@
+#ifndef LGMESH_MARCHINGCUBES_H
+#define LGMESH_MARCHINGCUBES_H
+
+#include "PolygonMesh.h"
+#include "ScalarGrid.h"
+#include "SparseGrid.h"
+
+namespace LG {
+
+// Marching cubes isosurface extraction.
+//
+// Points with a value below iso are inside, the triangles are oriented with
+// their normals pointing towards larger values (outwards for a signed
+// distance field). Values equal to iso are treated as slightly above it, so
+// no vertex lands exactly on a grid point. The case table is generated from the cube faces instead
+// of being typed in: on every face the surface separates the inside corners,
+// so two cells sharing an ambiguous face always agree, and no triangle edge
+// runs across a cell face. The result is a closed manifold away from the
+// grid border.
+//
+// The grid is processed in blocks of cells in parallel, each block works on
+// a copy of its values. Blocks whose value range does not contain iso are
+// skipped after one min/max pass; for a sparse grid only the blocks next to
+// allocated grid blocks or to tiles of different value are looked at. Every
+// surface vertex lies on a grid edge and is owned by the block containing the
+// lower end of that edge; the blocks mark their crossed edges in a bitmask,
+// so after a prefix sum over the blocks any block can compute the index of a
+// vertex owned by a neighbour without locks or a shared hash map. The
+// triangles are finally added to the mesh at once with
+// PolygonMesh::add_triangles().
+
+// extract the iso level set of grid and append it to mesh
+bool marching_cubes(const ScalarGrid& grid, Scalar iso, PolygonMesh& mesh);
+
+bool marching_cubes(const SparseGrid& grid, Scalar iso, PolygonMesh& mesh);
+
+// extract the iso level set of the implicit function f (thread-safe,
+// Scalar f(const Vec3&)) sampled at points spacing apart over box
+template <class Function>
+bool marching_cubes(const Function& f, const BoundingBox& box, Scalar spacing, Scalar iso,
+                    PolygonMesh& mesh)
+{
+  ScalarGrid grid(box, spacing);
+  grid.sample(f);
+  return marching_cubes(grid, iso, mesh);
+}
+
+}
+
+#endif // !LGMESH_MARCHINGCUBES_H
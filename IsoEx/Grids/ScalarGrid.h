@@ -0,0 +1,112 @@
+#ifndef LGMESH_SCALARGRID_H
+#define LGMESH_SCALARGRID_H
+
+#include "LgMeshTypes.h"
+#include "BoundingBox.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace LG {
+
+// Scalar values sampled at the points of a regular grid.
+//
+// Point (i, j, k) lies at origin + spacing * (i, j, k), the values are stored
+// with i running fastest. The cells of the grid are the cubes between
+// neighbouring points, so a grid of n points per axis has n - 1 cells.
+class ScalarGrid
+{
+public:
+  ScalarGrid() : origin_(Vec3::Zero()), spacing_(1)
+  {
+    size_[0] = size_[1] = size_[2] = 0;
+  };
+
+  ScalarGrid(const Vec3& origin, Scalar spacing, int nx, int ny, int nz, Scalar value = 0)
+  {
+    resize(origin, spacing, nx, ny, nz, value);
+  };
+
+  // grid with points spacing apart covering box (at least 2 points per axis)
+  ScalarGrid(const BoundingBox& box, Scalar spacing, Scalar value = 0)
+  {
+    const Vec3 d = box.diagonal();
+    resize(box.min(), spacing,
+           std::max(2, (int)std::ceil(d[0] / spacing) + 1),
+           std::max(2, (int)std::ceil(d[1] / spacing) + 1),
+           std::max(2, (int)std::ceil(d[2] / spacing) + 1), value);
+  };
+
+  void resize(const Vec3& origin, Scalar spacing, int nx, int ny, int nz, Scalar value = 0)
+  {
+    origin_  = origin;
+    spacing_ = spacing;
+    size_[0] = nx;
+    size_[1] = ny;
+    size_[2] = nz;
+    values_.assign(size_t(nx) * ny * nz, value);
+  };
+
+  const Vec3& origin() const { return origin_; };
+  Scalar spacing() const { return spacing_; };
+
+  // number of points along axis
+  int size(int axis) const { return size_[axis]; };
+
+  size_t n_points() const { return values_.size(); };
+
+  size_t index(int i, int j, int k) const
+  {
+    return (size_t(k) * size_[1] + j) * size_[0] + i;
+  };
+
+  Vec3 point(int i, int j, int k) const
+  {
+    return origin_ + spacing_ * Vec3(Scalar(i), Scalar(j), Scalar(k));
+  };
+
+  Scalar& operator()(int i, int j, int k) { return values_[index(i, j, k)]; };
+  Scalar  operator()(int i, int j, int k) const { return values_[index(i, j, k)]; };
+
+  std::vector<Scalar>& values() { return values_; };
+  const std::vector<Scalar>& values() const { return values_; };
+
+  // set every point to f(position) in parallel, f has to be thread-safe
+  template <class Function>
+  void sample(const Function& f);
+
+private:
+  Vec3                 origin_;
+  Scalar               spacing_;
+  int                  size_[3];
+  std::vector<Scalar>  values_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Function>
+void ScalarGrid::sample(const Function& f)
+{
+  // one task per bundle of rows along x
+  const size_t rows = size_t(size_[1]) * size_[2];
+  parallel_for(0, rows, 16, [&](size_t first, size_t last)
+  {
+    for (size_t r = first; r < last; ++r)
+    {
+      const int j = int(r % size_[1]), k = int(r / size_[1]);
+      Scalar* row = &values_[r * size_[0]];
+      for (int i = 0; i < size_[0]; ++i)
+      {
+        row[i] = f(point(i, j, k));
+      }
+    }
+  });
+}
+
+}
+
+#endif // !LGMESH_SCALARGRID_H
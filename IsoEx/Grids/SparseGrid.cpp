@@ -0,0 +1,136 @@
+#include "SparseGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace LG {
+
+
+SparseGrid::SparseGrid() : origin_(Vec3::Zero()), spacing_(1), background_(0)
+{
+  size_[0] = size_[1] = size_[2] = 0;
+  blocks_[0] = blocks_[1] = blocks_[2] = 0;
+}
+
+
+SparseGrid::SparseGrid(const Vec3& origin, Scalar spacing, int nx, int ny, int nz, Scalar background)
+{
+  resize(origin, spacing, nx, ny, nz, background);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SparseGrid::resize(const Vec3& origin, Scalar spacing, int nx, int ny, int nz, Scalar background)
+{
+  origin_     = origin;
+  spacing_    = spacing;
+  background_ = background;
+  size_[0] = nx;
+  size_[1] = ny;
+  size_[2] = nz;
+  for (int a = 0; a < 3; ++a)
+  {
+    blocks_[a] = (size_[a] + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+  indices_.clear();
+  values_.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar SparseGrid::value(int i, int j, int k) const
+{
+  const int bi = i / BLOCK_SIZE, bj = j / BLOCK_SIZE, bk = k / BLOCK_SIZE;
+  const int b = find_block(block_index(bi, bj, bk));
+  if (b < 0)
+  {
+    return tile_value(bi, bj, bk);
+  }
+  const int li = i - bi * BLOCK_SIZE, lj = j - bj * BLOCK_SIZE, lk = k - bk * BLOCK_SIZE;
+  return values_[size_t(b) * BLOCK_POINTS + (lk * BLOCK_SIZE + lj) * BLOCK_SIZE + li];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar SparseGrid::tile_value(int bi, int bj, int bk) const
+{
+  // allocated neighbours in the row, the row is contiguous in indices_
+  const size_t row = block_index(0, bj, bk);
+  const size_t index = row + bi;
+  const size_t next = std::lower_bound(indices_.begin(), indices_.end(), index) - indices_.begin();
+  const Scalar magnitude = std::fabs(background_);
+
+  if (next > 0 && indices_[next - 1] >= row)
+  {
+    // +x face of the previous block
+    const Scalar v = values_[(next - 1) * BLOCK_POINTS + BLOCK_SIZE - 1];
+    return (v < 0) ? -magnitude : magnitude;
+  }
+  if (next < indices_.size() && indices_[next] < row + blocks_[0])
+  {
+    // -x face of the next block
+    const Scalar v = values_[next * BLOCK_POINTS];
+    return (v < 0) ? -magnitude : magnitude;
+  }
+  return background_;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SparseGrid::allocate(std::vector<size_t> indices)
+{
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+  // merge with the existing blocks, moving their values along
+  std::vector<size_t> merged;
+  merged.reserve(indices_.size() + indices.size());
+  std::set_union(indices_.begin(), indices_.end(), indices.begin(), indices.end(),
+                 std::back_inserter(merged));
+
+  std::vector<Scalar> values(merged.size() * BLOCK_POINTS, background_);
+  for (size_t b = 0, m = 0; b < indices_.size(); ++b)
+  {
+    while (merged[m] != indices_[b])
+    {
+      ++m;
+    }
+    std::copy(&values_[b * BLOCK_POINTS], &values_[b * BLOCK_POINTS] + BLOCK_POINTS, &values[m * BLOCK_POINTS]);
+  }
+
+  indices_.swap(merged);
+  values_.swap(values);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int SparseGrid::find_block(size_t index) const
+{
+  std::vector<size_t>::const_iterator it = std::lower_bound(indices_.begin(), indices_.end(), index);
+  return (it != indices_.end() && *it == index) ? int(it - indices_.begin()) : -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SparseGrid::block_coordinates(int b, int& bi, int& bj, int& bk) const
+{
+  const size_t index = indices_[b];
+  bi = int(index % blocks_[0]);
+  bj = int((index / blocks_[0]) % blocks_[1]);
+  bk = int(index / (size_t(blocks_[0]) * blocks_[1]));
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef LGMESH_SPARSEGRID_H
+#define LGMESH_SPARSEGRID_H
+
+#include "LgMeshTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace LG {
+
+// Scalar values on a regular grid, stored only in allocated blocks of
+// BLOCK_SIZE^3 points.
+//
+// The point layout matches ScalarGrid: point (i, j, k) lies at origin +
+// spacing * (i, j, k) and belongs to block (i, j, k) / BLOCK_SIZE. The blocks
+// are kept sorted by their linear index (x fastest), so the allocated blocks
+// of one row of blocks along x are contiguous and lookups are binary searches
+// without any hash table.
+//
+// Unallocated blocks are tiles of constant value: |background| with the sign
+// of the nearest allocated block of the same row, taken at its face towards
+// the tile, or background itself if the row has no allocated block. For a
+// narrow band distance field this is the sign flood fill along x: the band
+// separates the tiles from the surface, so a tile is inside exactly when the
+// face of its neighbour block is.
+class SparseGrid
+{
+public:
+  static const int BLOCK_SIZE   = 8;
+  static const int BLOCK_POINTS = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
+
+public:
+  SparseGrid();
+
+  SparseGrid(const Vec3& origin, Scalar spacing, int nx, int ny, int nz, Scalar background);
+
+  // drop all blocks and change the geometry of the grid
+  void resize(const Vec3& origin, Scalar spacing, int nx, int ny, int nz, Scalar background);
+
+  const Vec3& origin() const { return origin_; };
+  Scalar spacing() const { return spacing_; };
+  Scalar background() const { return background_; };
+
+  // number of points along axis
+  int size(int axis) const { return size_[axis]; };
+
+  // number of blocks along axis
+  int blocks(int axis) const { return blocks_[axis]; };
+
+  Vec3 point(int i, int j, int k) const
+  {
+    return origin_ + spacing_ * Vec3(Scalar(i), Scalar(j), Scalar(k));
+  };
+
+  // value of point (i, j, k), thread-safe
+  Scalar value(int i, int j, int k) const;
+
+  // value of all points of the unallocated block (bi, bj, bk)
+  Scalar tile_value(int bi, int bj, int bk) const;
+
+public: //--- allocated blocks
+
+  // linear index of block (bi, bj, bk)
+  size_t block_index(int bi, int bj, int bk) const
+  {
+    return (size_t(bk) * blocks_[1] + bj) * blocks_[0] + bi;
+  };
+
+  // allocate the blocks with the given linear indices (duplicates are
+  // ignored) in addition to the existing ones, new blocks are filled with
+  // background. Invalidates the block numbers returned by find_block().
+  void allocate(std::vector<size_t> indices);
+
+  size_t n_blocks() const { return indices_.size(); };
+
+  // slot of the allocated block with linear index, -1 if there is none
+  int find_block(size_t index) const;
+
+  // linear index and block coordinates of allocated block b
+  size_t block_index(int b) const { return indices_[b]; };
+  void block_coordinates(int b, int& bi, int& bj, int& bk) const;
+
+  // the BLOCK_POINTS values of block b, x fastest
+  Scalar* block_values(int b) { return &values_[size_t(b) * BLOCK_POINTS]; };
+  const Scalar* block_values(int b) const { return &values_[size_t(b) * BLOCK_POINTS]; };
+
+  // bytes used by the blocks
+  size_t memory() const
+  {
+    return values_.size() * sizeof(Scalar) + indices_.size() * sizeof(size_t);
+  };
+
+private:
+  Vec3                 origin_;
+  Scalar               spacing_;
+  Scalar               background_;
+  int                  size_[3];
+  int                  blocks_[3];
+
+  std::vector<size_t>  indices_;   // linear indices of the allocated blocks, sorted
+  std::vector<Scalar>  values_;
+};
+
+}
+
+#endif // !LGMESH_SPARSEGRID_H
@@ -0,0 +1,426 @@
+#include "SignedDistance.h"
+#include "ClosestPoint.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace LG {
+
+namespace {
+
+// triangles per task when collecting the blocks of a sparse grid
+const size_t TRIANGLE_GRAIN = 1024;
+
+// slack of the query bound derived from the previous point of a row
+const Scalar BOUND_SLACK = Scalar(1.001);
+
+// Counting sort of the items 0 .. n-1 by key(item) < n_buckets: the items of
+// bucket b are items[start[b]] .. items[start[b+1]-1]
+template <class Key>
+void bucket_sort(int n_buckets, int n, const Key& key, std::vector<int>& start, std::vector<int>& items)
+{
+  start.assign(n_buckets + 1, 0);
+  for (int i = 0; i < n; ++i)
+  {
+    ++start[key(i) + 1];
+  }
+  for (int b = 0; b < n_buckets; ++b)
+  {
+    start[b + 1] += start[b];
+  }
+  std::vector<int> fill(start.begin(), start.end() - 1);
+  items.resize(n);
+  for (int i = 0; i < n; ++i)
+  {
+    items[fill[key(i)]++] = i;
+  }
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+SignedDistance::SignedDistance(const BVH& bvh, Sign_method sign) : bvh_(bvh), sign_(sign)
+{
+  update();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SignedDistance::update()
+{
+  triangle_normals_.clear();
+  edge_normals_.clear();
+  vertex_normals_.clear();
+  winding_number_.reset();
+  if (bvh_.empty())
+  {
+    return;
+  }
+
+  if (sign_ == WINDING_NUMBER)
+  {
+    winding_number_.reset(new WindingNumber(bvh_));
+    return;
+  }
+
+  const std::vector<BVH::Triangle>& triangles = bvh_.triangles();
+  const std::vector<Vec3>& points = bvh_.mesh()->points();
+  const int n_triangles = (int)triangles.size();
+  const int n_corners = 3 * n_triangles;
+  const int n_vertices = (int)points.size();
+  auto corner_vertex = [&](int c) { return triangles[c / 3].vertices[c % 3].idx(); };
+  auto next_vertex   = [&](int c) { return triangles[c / 3].vertices[(c % 3 + 1) % 3].idx(); };
+
+  triangle_normals_.resize(n_triangles);
+  parallel_for(0, n_triangles, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t t = first; t < last; ++t)
+    {
+      const Vec3& a = points[triangles[t].vertices[0].idx()];
+      const Vec3& b = points[triangles[t].vertices[1].idx()];
+      const Vec3& c = points[triangles[t].vertices[2].idx()];
+      const Vec3 n = (b - a).cross(c - a);
+      const Scalar length = n.norm();
+      triangle_normals_[t] = (length > 0) ? Vec3(n / length) : Vec3(Vec3::Zero());
+    }
+  });
+
+  std::vector<int> start, corners;
+
+  // vertices: normals of the incident triangles weighted by their angle
+  bucket_sort(n_vertices, n_corners, corner_vertex, start, corners);
+  vertex_normals_.resize(n_vertices);
+  parallel_for(0, n_vertices, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t v = first; v < last; ++v)
+    {
+      Vec3 normal = Vec3::Zero();
+      for (int i = start[v]; i < start[v + 1]; ++i)
+      {
+        const int c = corners[i], t = c / 3, k = c % 3;
+        const Vec3& p = points[v];
+        const Vec3 e1 = points[triangles[t].vertices[(k + 1) % 3].idx()] - p;
+        const Vec3 e2 = points[triangles[t].vertices[(k + 2) % 3].idx()] - p;
+        normal += std::atan2(e1.cross(e2).norm(), e1.dot(e2)) * triangle_normals_[t];
+      }
+      vertex_normals_[v] = normal;
+    }
+  });
+
+  // edges: sum of the normals of the triangles sharing the edge, corner c
+  // stands for the edge from its vertex to the next one
+  bucket_sort(n_vertices, n_corners,
+              [&](int c) { return std::min(corner_vertex(c), next_vertex(c)); }, start, corners);
+  edge_normals_.resize(n_corners);
+  parallel_for(0, n_vertices, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t v = first; v < last; ++v)
+    {
+      for (int i = start[v]; i < start[v + 1]; ++i)
+      {
+        const int c = corners[i];
+        const int other = corner_vertex(c) + next_vertex(c) - (int)v;
+        Vec3 normal = Vec3::Zero();
+        for (int j = start[v]; j < start[v + 1]; ++j)
+        {
+          const int cc = corners[j];
+          if (corner_vertex(cc) + next_vertex(cc) - (int)v == other)
+          {
+            normal += triangle_normals_[cc / 3];
+          }
+        }
+        edge_normals_[c] = normal;
+      }
+    }
+  });
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool SignedDistance::is_inside(const Vec3& p, const BVH::Hit* hit) const
+{
+  if (sign_ == WINDING_NUMBER)
+  {
+    return winding_number_ && winding_number_->is_inside(p);
+  }
+
+  BVH::Hit closest;
+  if (!hit)
+  {
+    if (!bvh_.closest_point(p, closest))
+    {
+      return false;
+    }
+    hit = &closest;
+  }
+
+  // the closest point is exactly on a vertex or edge if its barycentric
+  // coordinates contain zeros
+  const Vec3& w = hit->barycentric;
+  const BVH::Triangle& triangle = bvh_.triangle(hit->triangle);
+  Vec3 normal;
+  if (w[1] == 0 && w[2] == 0)
+  {
+    normal = vertex_normals_[triangle.vertices[0].idx()];
+  }
+  else if (w[0] == 0 && w[2] == 0)
+  {
+    normal = vertex_normals_[triangle.vertices[1].idx()];
+  }
+  else if (w[0] == 0 && w[1] == 0)
+  {
+    normal = vertex_normals_[triangle.vertices[2].idx()];
+  }
+  else if (w[2] == 0)
+  {
+    normal = edge_normals_[3 * hit->triangle];
+  }
+  else if (w[0] == 0)
+  {
+    normal = edge_normals_[3 * hit->triangle + 1];
+  }
+  else if (w[1] == 0)
+  {
+    normal = edge_normals_[3 * hit->triangle + 2];
+  }
+  else
+  {
+    normal = triangle_normals_[hit->triangle];
+  }
+  return (p - hit->point).dot(normal) < 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar SignedDistance::distance(const Vec3& p, Scalar max_distance) const
+{
+  BVH::Hit hit;
+  if (bvh_.closest_point(p, hit, max_distance))
+  {
+    return is_inside(p, &hit) ? -hit.distance : hit.distance;
+  }
+  if (bvh_.empty())
+  {
+    return max_distance;
+  }
+  return is_inside(p, NULL) ? -max_distance : max_distance;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SignedDistance::fill_row(const Vec3& start, Scalar h, int n, Scalar band, int row_sign, Scalar* values) const
+{
+  // unsigned distances until the first sign is known
+  int sign = 0, first_signed = n;
+  Scalar previous = -1;
+  BVH::Hit hit;
+  for (int i = 0; i < n; ++i)
+  {
+    Vec3 p = start;
+    p[0] += i * h;
+
+    const Scalar bound = (previous >= 0) ? std::min(band, (previous + h) * BOUND_SLACK) : band;
+    bool found = bvh_.closest_point(p, hit, bound);
+    if (!found && bound < band)
+    {
+      found = bvh_.closest_point(p, hit, band);
+    }
+    const Scalar d = found ? hit.distance : band;
+    previous = found ? d : Scalar(-1);
+
+    if (found && (sign == 0 || !(d > h)))
+    {
+      sign = is_inside(p, &hit) ? -1 : 1;
+    }
+    if (sign != 0 && first_signed == n)
+    {
+      first_signed = i;
+    }
+    values[i] = (sign != 0) ? sign * d : d;
+  }
+
+  // the points before the first signed one are all outside the band
+  if (first_signed == n)
+  {
+    sign = (row_sign != 0) ? row_sign : (is_inside(start, NULL) ? -1 : 1);
+  }
+  else
+  {
+    sign = (values[first_signed] < 0) ? -1 : 1;
+  }
+  for (int i = 0; i < first_signed; ++i)
+  {
+    values[i] *= sign;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SignedDistance::fill_block(const Vec3& start, Scalar h, const int n[3], Scalar band, Scalar* values) const
+{
+  for (int k = 0; k < n[2]; ++k)
+  {
+    for (int j = 0; j < n[1]; ++j)
+    {
+      // a row without points near the surface has the sign of the first
+      // point of the previous row (or layer), one spacing away
+      Scalar* row = values + (size_t(k) * n[1] + j) * n[0];
+      int row_sign = 0;
+      if (j > 0)
+      {
+        row_sign = (row[-n[0]] < 0) ? -1 : 1;
+      }
+      else if (k > 0)
+      {
+        row_sign = (row[-n[0] * n[1]] < 0) ? -1 : 1;
+      }
+      fill_row(start + h * Vec3(0, Scalar(j), Scalar(k)), h, n[0], band, row_sign, row);
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool SignedDistance::voxelize(ScalarGrid& grid) const
+{
+  return voxelize(grid, std::numeric_limits<Scalar>::infinity());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool SignedDistance::voxelize(ScalarGrid& grid, Scalar band) const
+{
+  if (bvh_.empty())
+  {
+    std::cerr << "SignedDistance::voxelize: empty mesh" << std::endl;
+    return false;
+  }
+  if (!(band >= grid.spacing()))
+  {
+    std::cerr << "SignedDistance::voxelize: band is smaller than the grid spacing" << std::endl;
+    return false;
+  }
+
+  // one layer of rows per task
+  const int n[3] = { grid.size(0), grid.size(1), 1 };
+  parallel_for(0, grid.size(2), 1, [&](size_t first, size_t last)
+  {
+    for (size_t k = first; k < last; ++k)
+    {
+      fill_block(grid.point(0, 0, (int)k), grid.spacing(), n, band, &grid(0, 0, (int)k));
+    }
+  });
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool SignedDistance::voxelize(SparseGrid& grid, Scalar band) const
+{
+  if (bvh_.empty())
+  {
+    std::cerr << "SignedDistance::voxelize: empty mesh" << std::endl;
+    return false;
+  }
+  const Scalar h = grid.spacing();
+  if (!(band >= h) || band == std::numeric_limits<Scalar>::infinity())
+  {
+    std::cerr << "SignedDistance::voxelize: band has to be finite and at least the grid spacing" << std::endl;
+    return false;
+  }
+  grid.resize(grid.origin(), h, grid.size(0), grid.size(1), grid.size(2), band);
+
+  // the blocks with points within band of a triangle: of the blocks
+  // overlapping the box of the triangle grown by band, those whose center is
+  // not farther than band plus half their diagonal from it. Testing the box
+  // alone would allocate a volume around long skewed triangles.
+  const std::vector<Vec3>& points = bvh_.mesh()->points();
+  const int S = SparseGrid::BLOCK_SIZE;
+  const Scalar reach = band + Scalar(0.5) * std::sqrt(Scalar(3)) * (S - 1) * h;
+  Thread_local_storage< std::vector<size_t> > blocks;
+  parallel_for(0, bvh_.triangles().size(), TRIANGLE_GRAIN, [&](size_t first, size_t last)
+  {
+    std::vector<size_t>& result = blocks.local();
+    for (size_t t = first; t < last; ++t)
+    {
+      const BVH::Triangle& triangle = bvh_.triangle((int)t);
+      const Vec3& a = points[triangle.vertices[0].idx()];
+      const Vec3& b = points[triangle.vertices[1].idx()];
+      const Vec3& c = points[triangle.vertices[2].idx()];
+      BoundingBox box;
+      box.extend(a);
+      box.extend(b);
+      box.extend(c);
+      int lo[3], hi[3];
+      bool inside = true;
+      for (int a = 0; a < 3; ++a)
+      {
+        const Scalar min = (box.min()[a] - band - grid.origin()[a]) / h;
+        const Scalar max = (box.max()[a] + band - grid.origin()[a]) / h;
+        lo[a] = (int)std::max(std::ceil(min), Scalar(0)) / S;
+        hi[a] = (int)std::min(std::floor(max), Scalar(grid.size(a) - 1)) / S;
+        inside = inside && (max >= 0) && (min <= grid.size(a) - 1);
+      }
+      if (!inside)
+      {
+        continue;
+      }
+      for (int bk = lo[2]; bk <= hi[2]; ++bk)
+      {
+        for (int bj = lo[1]; bj <= hi[1]; ++bj)
+        {
+          for (int bi = lo[0]; bi <= hi[0]; ++bi)
+          {
+            const Vec3 center = grid.point(bi * S, bj * S, bk * S) + Vec3::Constant(Scalar(0.5) * (S - 1) * h);
+            const Vec3 w = closest_point_triangle(center, a, b, c);
+            if ((w[0] * a + w[1] * b + w[2] * c - center).squaredNorm() <= reach * reach)
+            {
+              result.push_back(grid.block_index(bi, bj, bk));
+            }
+          }
+        }
+      }
+    }
+  });
+  std::vector<size_t> indices;
+  blocks.for_each([&](std::vector<size_t>& result)
+  {
+    indices.insert(indices.end(), result.begin(), result.end());
+  });
+  grid.allocate(indices);
+
+  const int n[3] = { S, S, S };
+  parallel_for(0, grid.n_blocks(), 1, [&](size_t first, size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      int bi, bj, bk;
+      grid.block_coordinates((int)b, bi, bj, bk);
+      fill_block(grid.point(bi * S, bj * S, bk * S), h, n, band, grid.block_values((int)b));
+    }
+  });
+  return true;
+}
+
+}
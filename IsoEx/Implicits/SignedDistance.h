@@ -0,0 +1,93 @@
+#ifndef LGMESH_SIGNEDDISTANCE_H
+#define LGMESH_SIGNEDDISTANCE_H
+
+#include "BVH.h"
+#include "WindingNumber.h"
+#include "ScalarGrid.h"
+#include "SparseGrid.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace LG {
+
+// Signed distance to the triangles of a BVH, negative inside.
+//
+// The distance comes from closest point queries on the BVH. The sign comes
+// either from the angle weighted pseudo-normal of the closest feature
+// (Baerentzen and Aanaes 2005), which is exact for closed, consistently
+// oriented manifolds, or from the generalized winding number, which also
+// copes with holes, flipped parts and self-intersections.
+//
+// The grids are filled row by row along x in parallel. Every query is bounded
+// by the distance of the previous point plus the spacing. A point farther
+// from the surface than the spacing has the same sign as its predecessor in
+// the row, because the surface would have to pass within one spacing of it to
+// separate them. So the sign only has to be computed next to the surface.
+// In narrow band mode this is what gives the points outside the band their
+// sign, and for a sparse grid only the blocks within the band of a triangle
+// are allocated, so the memory scales with the surface area.
+class SignedDistance
+{
+public:
+  enum Sign_method
+  {
+    PSEUDO_NORMAL,   // closed manifold meshes, cheap
+    WINDING_NUMBER   // open or defective meshes
+  };
+
+public:
+  // distances to the mesh of bvh, which has to outlive this object
+  explicit SignedDistance(const BVH& bvh, Sign_method sign = PSEUDO_NORMAL);
+
+  // recompute the pseudo-normals / winding number expansions after the BVH
+  // was updated
+  void update();
+
+  Sign_method sign_method() const { return sign_; };
+
+  // signed distance at p, clamped to +-max_distance, thread-safe
+  Scalar distance(const Vec3& p, Scalar max_distance = std::numeric_limits<Scalar>::infinity()) const;
+
+  Scalar operator()(const Vec3& p) const { return distance(p); };
+
+  // signed distances at all points of grid
+  bool voxelize(ScalarGrid& grid) const;
+
+  // exact signed distances within band of the surface, +-band elsewhere.
+  // band has to be at least the grid spacing.
+  bool voxelize(ScalarGrid& grid, Scalar band) const;
+
+  // narrow band in a sparse grid: the blocks of grid are replaced by the ones
+  // within band of a triangle and the background is set to band, the other
+  // blocks become inside or outside tiles
+  bool voxelize(SparseGrid& grid, Scalar band) const;
+
+private:
+  // sign of p (true if inside), from the closest point hit if given
+  bool is_inside(const Vec3& p, const BVH::Hit* hit) const;
+
+  // signed distances of the n points start + i * h * x into values, clamped
+  // to band. row_sign is the sign of the row if no point of it lies within
+  // band and the spacing of the surface, 0 to compute it.
+  void fill_row(const Vec3& start, Scalar h, int n, Scalar band, int row_sign, Scalar* values) const;
+
+  // signed distances of the rows along x of a n[0] x n[1] x n[2] block of
+  // points starting at start, point (i, j, k) is values[(k * n[1] + j) * n[0] + i]
+  void fill_block(const Vec3& start, Scalar h, const int n[3], Scalar band, Scalar* values) const;
+
+private:
+  const BVH&    bvh_;
+  Sign_method   sign_;
+
+  std::vector<Vec3>  triangle_normals_;  // unit normal of every BVH triangle
+  std::vector<Vec3>  edge_normals_;      // edge k of triangle t from vertex k to k + 1 at 3 t + k
+  std::vector<Vec3>  vertex_normals_;    // by mesh vertex
+
+  std::unique_ptr<WindingNumber>  winding_number_;
+};
+
+}
+
+#endif // !LGMESH_SIGNEDDISTANCE_H
@@ -0,0 +1,92 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace LG {
+
+void report(const char* group, const char* name, double seconds, double items)
+{
+  std::printf("%-14s %-36s %10.4f s %12.2f M/s\n", group, name, seconds,
+              seconds > 0 ? items / seconds * 1e-6 : 0.0);
+}
+
+int torus_resolution(size_t faces)
+{
+  return std::max(8, (int)std::sqrt(double(faces)));
+}
+
+void make_torus(PolygonMesh& mesh, int n)
+{
+  const int m = std::max(4, n / 2);
+  const Scalar pi = Scalar(3.14159265358979);
+  std::vector<Vec3> points((size_t)n * m);
+  for (int i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < m; ++j)
+    {
+      const Scalar u = 2 * pi * i / n, v = 2 * pi * j / m;
+      const Scalar r = Scalar(0.35) + Scalar(0.01) * std::sin(7 * u) * std::cos(5 * v);
+      points[(size_t)i * m + j] = Vec3((1 + r * std::cos(v)) * std::cos(u),
+                                       (1 + r * std::cos(v)) * std::sin(u),
+                                       r * std::sin(v));
+    }
+  }
+
+  std::vector<int> triangles;
+  triangles.reserve((size_t)6 * n * m);
+  for (int i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < m; ++j)
+    {
+      const int a = i * m + j, b = ((i + 1) % n) * m + j;
+      const int c = ((i + 1) % n) * m + (j + 1) % m, d = i * m + (j + 1) % m;
+      const int t[6] = { a, b, c, a, c, d };
+      triangles.insert(triangles.end(), t, t + 6);
+    }
+  }
+  mesh.add_triangles(points, triangles);
+}
+
+void random_rays(const BoundingBox& box, size_t n, unsigned int seed, std::vector<BVH::Ray>& rays)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<Scalar> uniform(0, 1);
+  std::normal_distribution<Scalar> normal(0, 1);
+  const Vec3 center = box.center(), diagonal = box.diagonal();
+  const Scalar radius = diagonal.norm();
+
+  rays.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    Vec3 d(normal(rng), normal(rng), normal(rng));
+    const Vec3 origin = center + radius * d.normalized();
+    const Vec3 target = box.min() + Vec3(uniform(rng), uniform(rng), uniform(rng)).cwiseProduct(diagonal);
+    rays[i] = BVH::Ray(origin, target - origin);
+  }
+}
+
+void random_points(const PolygonMesh& mesh, Scalar offset, size_t n, unsigned int seed, std::vector<Vec3>& points)
+{
+  const std::vector<Vec3>& vertices = mesh.points();
+  BoundingBox box;
+  for (size_t i = 0; i < vertices.size(); ++i)
+  {
+    box.extend(vertices[i]);
+  }
+  const Scalar scale = offset * box.diagonal().norm();
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<size_t> vertex(0, vertices.size() - 1);
+  std::uniform_real_distribution<Scalar> uniform(-1, 1);
+  points.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    points[i] = vertices[vertex(rng)] + scale * Vec3(uniform(rng), uniform(rng), uniform(rng));
+  }
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef LGMESH_BENCHMARK_H
+#define LGMESH_BENCHMARK_H
+
+#include "PolygonMesh.h"
+#include "BVH.h"
+
+#include <chrono>
+
+namespace LG {
+
+// wall clock seconds of the fastest of runs calls of f
+template <class Function>
+double best_time(int runs, const Function& f)
+{
+  double best = 0;
+  for (int i = 0; i < runs; ++i)
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    f();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (i == 0 || seconds < best)
+    {
+      best = seconds;
+    }
+  }
+  return best;
+}
+
+// print one result line: time and millions of items per second
+void report(const char* group, const char* name, double seconds, double items);
+
+// closed torus of n x (n / 2) quads split into triangles, about n^2 faces,
+// with a small bump pattern so that no two faces are coplanar.
+// Built with add_triangles().
+void make_torus(PolygonMesh& mesh, int n);
+
+// number of torus rings for about the given number of faces
+int torus_resolution(size_t faces);
+
+// n rays from a sphere around box towards random points inside it, the
+// same rays for the same seed
+void random_rays(const BoundingBox& box, size_t n, unsigned int seed, std::vector<BVH::Ray>& rays);
+
+// n random points near the surface: vertices of mesh moved by up to
+// offset times the diagonal of its bounding box
+void random_points(const PolygonMesh& mesh, Scalar offset, size_t n, unsigned int seed, std::vector<Vec3>& points);
+
+
+// the benchmarks, faces is the size of the test meshes
+
+void benchmark_connectivity(size_t faces);
+void benchmark_bvh(size_t faces);
+void benchmark_rays(size_t faces);
+
+}
+
+#endif // !LGMESH_BENCHMARK_H
@@ -0,0 +1,69 @@
+#include "Benchmark.h"
+#include "BVH.h"
+#include "Parallel.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace LG {
+
+// Construction of the BVH and its three query types, the queries are
+// spread over the thread pool. Closest points are queried near the surface,
+// as for projections.
+void benchmark_bvh(size_t faces)
+{
+  const char* group = "bvh";
+  const int RUNS = 3;
+  const size_t QUERIES = 1 << 20;
+
+  PolygonMesh mesh;
+  make_torus(mesh, torus_resolution(faces));
+  std::printf("%s: %zu faces, %zu queries\n", group, mesh.faces_size(), QUERIES);
+
+  BVH bvh;
+  report(group, "build", best_time(RUNS, [&]() { bvh.build(mesh); }), double(mesh.faces_size()));
+  std::printf("%s: %zu nodes, SAH cost %.2f\n", group, bvh.nodes().size(), double(bvh.sah_cost()));
+
+  std::vector<BVH::Ray> rays;
+  random_rays(bvh.bounds(), QUERIES, 1, rays);
+  std::vector<Vec3> points;
+  random_points(mesh, Scalar(0.001), QUERIES, 2, points);
+  std::vector<int> results(QUERIES);
+
+  report(group, "intersect (closest hit)", best_time(RUNS, [&]()
+  {
+    parallel_for(0, QUERIES, 1024, [&](size_t first, size_t last)
+    {
+      BVH::Hit hit;
+      for (size_t i = first; i < last; ++i)
+      {
+        results[i] = bvh.intersect(rays[i], hit) ? hit.triangle : -1;
+      }
+    });
+  }), double(QUERIES));
+
+  report(group, "occluded (any hit)", best_time(RUNS, [&]()
+  {
+    parallel_for(0, QUERIES, 1024, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        results[i] = bvh.occluded(rays[i]) ? 1 : 0;
+      }
+    });
+  }), double(QUERIES));
+
+  report(group, "closest point", best_time(RUNS, [&]()
+  {
+    parallel_for(0, QUERIES, 1024, [&](size_t first, size_t last)
+    {
+      BVH::Hit hit;
+      for (size_t i = first; i < last; ++i)
+      {
+        results[i] = bvh.closest_point(points[i], hit) ? hit.triangle : -1;
+      }
+    });
+  }), double(QUERIES));
+}
+
+}
@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+#include "Parallel.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace LG {
+
+// Kernels whose speed depends on the halfedge connectivity layout
+// (LGMESH_HALFEDGE_SOA): normals and one-ring gathers.
+void benchmark_connectivity(size_t faces)
+{
+#ifdef LGMESH_HALFEDGE_SOA
+  const char* group = "halfedge SoA";
+#else
+  const char* group = "halfedge AoS";
+#endif
+  const int RUNS = 3;
+
+  PolygonMesh mesh;
+  make_torus(mesh, torus_resolution(faces));
+  const size_t nv = mesh.vertices_size(), nf = mesh.faces_size();
+  std::printf("%s: %zu vertices, %zu faces\n", group, nv, nf);
+
+  report(group, "face normals", best_time(RUNS, [&]() { mesh.update_face_normals(); }), double(nf));
+  report(group, "vertex normals", best_time(RUNS, [&]() { mesh.update_vertex_normals(); }), double(nv));
+
+  // sum of the neighbour positions of every vertex, to_vertex() and the
+  // opposite/next links per step
+  const PolygonMesh& m = mesh;
+  const std::vector<Vec3>& points = m.points();
+  std::vector<Vec3> sums(nv);
+  report(group, "one-ring position gather", best_time(RUNS, [&]()
+  {
+    parallel_for(0, nv, 4096, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        Vec3 sum(0, 0, 0);
+        PolygonMesh::Halfedge_around_vertex_circulator hc = m.halfedges(PolygonMesh::Vertex((int)i)), hc_end = hc;
+        if (hc)
+        {
+          do
+          {
+            sum += points[m.to_vertex(*hc).idx()];
+          } while (++hc != hc_end);
+        }
+        sums[i] = sum;
+      }
+    });
+  }), double(nv));
+
+  // walk of the next links around every face, touches nothing but
+  // next_halfedge() and to_vertex()
+  std::vector<int> corners(nf);
+  report(group, "face loop walk", best_time(RUNS, [&]()
+  {
+    parallel_for(0, nf, 4096, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        const PolygonMesh::Halfedge h0 = m.halfedge(PolygonMesh::Face((int)i));
+        PolygonMesh::Halfedge h = h0;
+        int key = 0;
+        do
+        {
+          key += m.to_vertex(h).idx();
+          h = m.next_halfedge(h);
+        } while (h != h0);
+        corners[i] = key;
+      }
+    });
+  }), double(nf));
+}
+
+}
@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include "BVH.h"
+#include "Parallel.h"
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace LG {
+
+namespace {
+
+// primary rays of a pinhole camera looking at box from the side, ordered in
+// tiles of 4 x 2 pixels so that consecutive packets are coherent
+void camera_rays(const BoundingBox& box, size_t n, std::vector<BVH::Ray>& rays)
+{
+  const int width = std::max(4, (int)std::sqrt(double(n)) / 4 * 4);
+  const int height = std::max(2, (int)(n / width) / 2 * 2);
+  const Vec3 center = box.center();
+  const Scalar size = box.diagonal().norm();
+  const Vec3 eye = center + Vec3(0, -2 * size, size);
+  const Vec3 forward = (center - eye).normalized();
+  const Vec3 right = forward.cross(Vec3::UnitZ()).normalized();
+  const Vec3 up = right.cross(forward);
+
+  rays.clear();
+  rays.reserve((size_t)width * height);
+  for (int ty = 0; ty < height; ty += 2)
+  {
+    for (int tx = 0; tx < width; tx += 4)
+    {
+      for (int k = 0; k < 8; ++k)
+      {
+        const Scalar x = Scalar(tx + k % 4 + 0.5) / width - Scalar(0.5);
+        const Scalar y = Scalar(ty + k / 4 + 0.5) / height - Scalar(0.5);
+        rays.push_back(BVH::Ray(eye, forward + Scalar(0.5) * (x * right + y * up)));
+      }
+    }
+  }
+}
+
+// time the closest or any hits of rays traced one by one, in packets of
+// consecutive rays and as a stream
+void benchmark_ray_set(const char* group, const char* set, const BVH& bvh,
+                       const std::vector<BVH::Ray>& rays, bool any_hit)
+{
+  const int RUNS = 3;
+  const size_t n = rays.size();
+  const size_t n_packets = (n + Ray_packet::SIZE - 1) / Ray_packet::SIZE;
+  const char* query = any_hit ? "any hit" : "closest hit";
+  char name[64];
+
+  std::vector<int> faces(n);
+  std::snprintf(name, sizeof(name), "%s, %s, single rays", set, query);
+  report(group, name, best_time(RUNS, [&]()
+  {
+    parallel_for(0, n, 1024, [&](size_t first, size_t last)
+    {
+      BVH::Hit hit;
+      for (size_t i = first; i < last; ++i)
+      {
+        const bool found = any_hit ? bvh.occluded(rays[i], &hit) : bvh.intersect(rays[i], hit);
+        faces[i] = found ? hit.face.idx() : -1;
+      }
+    });
+  }), double(n));
+
+  std::vector<Ray_packet> packets(n_packets);
+  for (size_t i = 0; i < n; ++i)
+  {
+    Ray_packet& packet = packets[i / Ray_packet::SIZE];
+    packet.set(packet.n_rays++, rays[i]);
+  }
+  std::vector<Packet_hits> packet_hits(n_packets);
+  std::snprintf(name, sizeof(name), "%s, %s, packets of %d", set, query, (int)Ray_packet::SIZE);
+  report(group, name, best_time(RUNS, [&]()
+  {
+    parallel_for(0, n_packets, 128, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        if (any_hit)
+        {
+          occluded(bvh, packets[i], packet_hits[i]);
+        }
+        else
+        {
+          intersect(bvh, packets[i], packet_hits[i]);
+        }
+      }
+    });
+  }), double(n));
+
+  Ray_stream stream;
+  stream.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    stream.set(i, rays[i]);
+  }
+  std::snprintf(name, sizeof(name), "%s, %s, stream", set, query);
+  report(group, name, best_time(RUNS, [&]()
+  {
+    if (any_hit)
+    {
+      occluded(bvh, stream);
+    }
+    else
+    {
+      intersect(bvh, stream);
+    }
+  }), double(n));
+}
+
+}
+
+// Rays per second of the scalar BVH queries, the packets and the streams
+// of RayPacket.h, for coherent camera rays and incoherent random rays.
+void benchmark_rays(size_t faces)
+{
+  const char* group = "rays";
+  const size_t RAYS = 1 << 20;
+
+  PolygonMesh mesh;
+  make_torus(mesh, torus_resolution(faces));
+  BVH bvh(mesh);
+  std::printf("%s: %zu faces, %zu rays per set\n", group, mesh.faces_size(), RAYS);
+
+  std::vector<BVH::Ray> rays;
+  camera_rays(bvh.bounds(), RAYS, rays);
+  benchmark_ray_set(group, "camera", bvh, rays, false);
+
+  random_rays(bvh.bounds(), RAYS, 1, rays);
+  benchmark_ray_set(group, "random", bvh, rays, false);
+  benchmark_ray_set(group, "random", bvh, rays, true);
+}
+
+}
@@ -0,0 +1,67 @@
+// Throughput benchmarks of the mesh data structures.
+//
+//   LgMeshBenchmark [-f faces] [-t threads] [benchmark ...]
+//
+// faces is the size of the test meshes (default 2M), threads the size of the
+// thread pool (default: the "thread_count" parameter). The benchmarks are
+// selected by name, all run if none is given. Build in Release mode, once
+// with and once without LGMESH_HALFEDGE_SOA to compare the connectivity
+// layouts.
+
+#include "Benchmark.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+  using namespace LG;
+
+  size_t faces = 2000000;
+  std::vector<const char*> names;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "-f") && i + 1 < argc)
+    {
+      faces = (size_t)std::atof(argv[++i]);
+    }
+    else if (!std::strcmp(argv[i], "-t") && i + 1 < argc)
+    {
+      ThreadPool::GetInstance()->set_thread_count((unsigned int)std::atoi(argv[++i]));
+    }
+    else
+    {
+      names.push_back(argv[i]);
+    }
+  }
+
+  struct Entry
+  {
+    const char* name;
+    void (*run)(size_t);
+  };
+  const Entry benchmarks[] =
+  {
+    { "connectivity", benchmark_connectivity },
+    { "bvh",          benchmark_bvh },
+    { "rays",         benchmark_rays }
+  };
+
+  std::printf("%u threads, %zu faces\n", ThreadPool::GetInstance()->thread_count(), faces);
+  for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); ++b)
+  {
+    bool selected = names.empty();
+    for (size_t k = 0; k < names.size(); ++k)
+    {
+      selected |= !std::strcmp(names[k], benchmarks[b].name);
+    }
+    if (selected)
+    {
+      benchmarks[b].run(faces);
+    }
+  }
+  return 0;
+}
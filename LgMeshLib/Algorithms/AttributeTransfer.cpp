@@ -0,0 +1,389 @@
+#include "AttributeTransfer.h"
+#include "BVH.h"
+#include "ClosestPoint.h"
+#include "FrozenConnectivity.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+
+namespace LG {
+
+namespace {
+
+typedef PolygonMesh::Vertex   Vertex;
+typedef PolygonMesh::Halfedge Halfedge;
+typedef PolygonMesh::Face     Face;
+
+// target elements per task
+const size_t TRANSFER_GRAIN = 1024;
+
+// corners are looked up this fraction of the way towards their face centroid
+const Scalar CORNER_SHIFT = Scalar(0.05);
+
+enum Value_type { UNSUPPORTED, FLOAT, DOUBLE, VEC2, VEC3, INT, UNSIGNED_INT, BOOL };
+
+// closest source point of one target element: a triangle of the fan of a
+// source face and the weights of its corners
+struct Sample
+{
+  Sample() : face(-1) {};
+
+  int      face;          // -1 if nothing was found
+  Vertex   vertices[3];
+  Halfedge corners[3];    // source halfedges of the corners, for halfedge attributes
+  Vec3     weights;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+// the typed attribute accessors of PolygonMesh selected by handle type
+template <class T>
+PolygonMesh::Vertex_attribute<T> get_attribute(const PolygonMesh& mesh, const std::string& name, Vertex)
+{
+  return mesh.get_vertex_attribute<T>(name);
+}
+
+template <class T>
+PolygonMesh::Halfedge_attribute<T> get_attribute(const PolygonMesh& mesh, const std::string& name, Halfedge)
+{
+  return mesh.get_halfedge_attribute<T>(name);
+}
+
+template <class T>
+PolygonMesh::Vertex_attribute<T> add_attribute(PolygonMesh& mesh, const std::string& name, Vertex)
+{
+  return mesh.vertex_attribute<T>(name);
+}
+
+template <class T>
+PolygonMesh::Halfedge_attribute<T> add_attribute(PolygonMesh& mesh, const std::string& name, Halfedge)
+{
+  return mesh.halfedge_attribute<T>(name);
+}
+
+std::vector<std::string> attribute_names(const PolygonMesh& mesh, Vertex)   { return mesh.vertex_attributes(); }
+std::vector<std::string> attribute_names(const PolygonMesh& mesh, Halfedge) { return mesh.halfedge_attributes(); }
+
+Vertex   corner(const Sample& s, int k, Vertex)   { return s.vertices[k]; }
+Halfedge corner(const Sample& s, int k, Halfedge) { return s.corners[k]; }
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Handle>
+Value_type value_type(const PolygonMesh& mesh, const std::string& name)
+{
+  if (get_attribute<float>(mesh, name, Handle()))        return FLOAT;
+  if (get_attribute<double>(mesh, name, Handle()))       return DOUBLE;
+  if (get_attribute<Vec2>(mesh, name, Handle()))         return VEC2;
+  if (get_attribute<Vec3>(mesh, name, Handle()))         return VEC3;
+  if (get_attribute<int>(mesh, name, Handle()))          return INT;
+  if (get_attribute<unsigned int>(mesh, name, Handle())) return UNSIGNED_INT;
+  if (get_attribute<bool>(mesh, name, Handle()))         return BOOL;
+  return UNSUPPORTED;
+}
+
+// can target store attribute name with values of type t?
+template <class Handle>
+bool is_compatible(const PolygonMesh& target, const std::string& name, Value_type t)
+{
+  const std::vector<std::string> names = attribute_names(target, Handle());
+  return std::find(names.begin(), names.end(), name) == names.end() || value_type<Handle>(target, name) == t;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// barycentric interpolation for real values, nearest corner for labels
+template <class T>
+T evaluate(const T values[3], const Vec3& w, std::false_type)
+{
+  return T(w[0] * values[0] + w[1] * values[1] + w[2] * values[2]);
+}
+
+template <class T>
+T evaluate(const T values[3], const Vec3& w, std::true_type)
+{
+  const int k = (w[0] >= w[1] && w[0] >= w[2]) ? 0 : (w[1] >= w[2] ? 1 : 2);
+  return values[k];
+}
+
+template <class T, class Handle>
+void write(const PolygonMesh& source, PolygonMesh& target, const std::string& name,
+           const std::vector<Sample>& samples)
+{
+  typename std::conditional<std::is_same<Handle, Vertex>::value,
+                            PolygonMesh::Vertex_attribute<T>,
+                            PolygonMesh::Halfedge_attribute<T> >::type
+    from = get_attribute<T>(source, name, Handle()),
+    to   = add_attribute<T>(target, name, Handle());
+
+  // neighbouring values of a bool attribute share a word
+  const size_t grain = std::is_same<T, bool>::value ? samples.size() : TRANSFER_GRAIN;
+  parallel_for(0, samples.size(), grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      const Sample& s = samples[i];
+      if (s.face < 0)
+      {
+        continue;
+      }
+      T values[3];
+      for (int k = 0; k < 3; ++k)
+      {
+        values[k] = from[corner(s, k, Handle())];
+      }
+      to[Handle((int)i)] = evaluate(values, s.weights, std::is_integral<T>());
+    }
+  });
+}
+
+template <class Handle>
+void write(const PolygonMesh& source, PolygonMesh& target, const std::string& name, Value_type type,
+           const std::vector<Sample>& samples)
+{
+  switch (type)
+  {
+    case FLOAT:        write<float, Handle>(source, target, name, samples); break;
+    case DOUBLE:       write<double, Handle>(source, target, name, samples); break;
+    case VEC2:         write<Vec2, Handle>(source, target, name, samples); break;
+    case VEC3:         write<Vec3, Handle>(source, target, name, samples); break;
+    case INT:          write<int, Handle>(source, target, name, samples); break;
+    case UNSIGNED_INT: write<unsigned int, Handle>(source, target, name, samples); break;
+    case BOOL:         write<bool, Handle>(source, target, name, samples); break;
+    default: break;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// closest point to p on the fan triangulation of source face f, returns the
+// squared distance
+Scalar closest_on_face(const PolygonMesh& source, const FrozenConnectivity& fc, Face f,
+                       const Vec3& p, Sample& sample)
+{
+  const std::vector<Vec3>& points = source.points();
+  const FrozenConnectivity::Vertex_range fv = fc.vertices(f);
+  Scalar best = std::numeric_limits<Scalar>::max();
+  for (size_t k = 2; k < fv.size(); ++k)
+  {
+    const Vec3& a = points[fv[0].idx()];
+    const Vec3& b = points[fv[k - 1].idx()];
+    const Vec3& c = points[fv[k].idx()];
+    const Vec3 w = closest_point_triangle(p, a, b, c);
+    const Scalar d2 = (w[0] * a + w[1] * b + w[2] * c - p).squaredNorm();
+    if (d2 < best)
+    {
+      best = d2;
+      sample.vertices[0] = fv[0];
+      sample.vertices[1] = fv[k - 1];
+      sample.vertices[2] = fv[k];
+      sample.weights = w;
+    }
+  }
+  sample.face = f.idx();
+  return best;
+}
+
+// Sample the source surface for every active element: the closest face to
+// lookup[i] is searched in the BVH, the sample is the closest point to at[i]
+// on that face. Consecutive elements are usually close to each other, so the
+// distance to the previous face bounds the search.
+void find_samples(const BVH& bvh, const FrozenConnectivity& fc,
+                  const std::vector<Vec3>& lookup, const std::vector<Vec3>& at,
+                  const std::vector<bool>& active, bool corners, Scalar max_distance,
+                  std::vector<Sample>& samples)
+{
+  const PolygonMesh& source = *bvh.mesh();
+  samples.assign(lookup.size(), Sample());
+  parallel_for(0, lookup.size(), TRANSFER_GRAIN, [&](size_t first, size_t last)
+  {
+    int previous = -1;
+    for (size_t i = first; i < last; ++i)
+    {
+      if (!active[i])
+      {
+        continue;
+      }
+
+      Scalar bound = max_distance;
+      if (previous >= 0)
+      {
+        Sample s;
+        const Scalar d2 = closest_on_face(source, fc, Face(previous), lookup[i], s);
+        bound = std::min(bound, std::sqrt(d2) * Scalar(1.0001));
+      }
+
+      BVH::Hit hit;
+      bool found = bvh.closest_point(lookup[i], hit, bound);
+      if (!found && bound < max_distance)
+      {
+        found = bvh.closest_point(lookup[i], hit, max_distance);
+      }
+      if (!found)
+      {
+        continue;
+      }
+      previous = hit.face.idx();
+
+      Sample& sample = samples[i];
+      closest_on_face(source, fc, hit.face, at[i], sample);
+      if (corners)
+      {
+        Halfedge h = source.halfedge(hit.face), hend = h;
+        do
+        {
+          for (int k = 0; k < 3; ++k)
+          {
+            if (source.to_vertex(h) == sample.vertices[k])
+            {
+              sample.corners[k] = h;
+            }
+          }
+          h = source.next_halfedge(h);
+        } while (h != hend);
+      }
+    }
+  });
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool transfer_attributes(const PolygonMesh& source, PolygonMesh& target,
+                         const std::vector<std::string>& names, Scalar max_distance)
+{
+  const BVH bvh(source);
+  return transfer_attributes(bvh, target, names, max_distance);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool transfer_attributes(const BVH& bvh, PolygonMesh& target,
+                         const std::vector<std::string>& names, Scalar max_distance)
+{
+  const PolygonMesh* source = bvh.mesh();
+  if (!source || !bvh.is_current(*source))
+  {
+    std::cerr << "transfer_attributes: the BVH does not match its mesh" << std::endl;
+    return false;
+  }
+
+  // check all names before anything is written
+  std::vector<Value_type> types(names.size());
+  std::vector<bool> on_halfedges(names.size(), false);
+  bool any_vertex = false, any_halfedge = false;
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    if (names[i] == "v:point" || names[i] == "v:deleted")
+    {
+      std::cerr << "transfer_attributes: \"" << names[i] << "\" cannot be transferred" << std::endl;
+      return false;
+    }
+
+    types[i] = value_type<Vertex>(*source, names[i]);
+    if (types[i] == UNSUPPORTED)
+    {
+      types[i] = value_type<Halfedge>(*source, names[i]);
+      on_halfedges[i] = true;
+    }
+    if (types[i] == UNSUPPORTED)
+    {
+      std::cerr << "transfer_attributes: \"" << names[i]
+                << "\" is no vertex or halfedge attribute of a supported type" << std::endl;
+      return false;
+    }
+
+    const bool compatible = on_halfedges[i] ? is_compatible<Halfedge>(target, names[i], types[i])
+                                            : is_compatible<Vertex>(target, names[i], types[i]);
+    if (!compatible)
+    {
+      std::cerr << "transfer_attributes: \"" << names[i]
+                << "\" exists on the target with a different type" << std::endl;
+      return false;
+    }
+    any_vertex   = any_vertex || !on_halfedges[i];
+    any_halfedge = any_halfedge || on_halfedges[i];
+  }
+
+  const PolygonMesh& to = target;
+  const FrozenConnectivity& source_fc = source->freeze();
+
+  std::vector<Sample> vertex_samples;
+  if (any_vertex)
+  {
+    std::vector<bool> active(to.vertices_size());
+    for (size_t v = 0; v < active.size(); ++v)
+    {
+      active[v] = !to.is_deleted(Vertex((int)v));
+    }
+    find_samples(bvh, source_fc, to.points(), to.points(), active, false, max_distance, vertex_samples);
+  }
+
+  std::vector<Sample> halfedge_samples;
+  if (any_halfedge)
+  {
+    // face centroids of the target
+    const FrozenConnectivity& target_fc = to.freeze();
+    const std::vector<Vec3>& points = to.points();
+    std::vector<Vec3> centroids(to.faces_size(), Vec3::Zero());
+    parallel_for(0, centroids.size(), TRANSFER_GRAIN, [&](size_t first, size_t last)
+    {
+      for (size_t f = first; f < last; ++f)
+      {
+        const FrozenConnectivity::Vertex_range fv = target_fc.vertices(Face((int)f));
+        for (size_t k = 0; k < fv.size(); ++k)
+        {
+          centroids[f] += points[fv[k].idx()];
+        }
+        centroids[f] /= Scalar(std::max<size_t>(fv.size(), 1));
+      }
+    });
+
+    // corners and their lookup points, shifted into the face
+    const size_t n = to.halfedges_size();
+    std::vector<Vec3> lookup(n, Vec3::Zero()), at(n, Vec3::Zero());
+    std::vector<bool> active(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      const Halfedge h((int)i);
+      active[i] = !to.is_deleted(h) && !to.is_boundary(h);
+      if (active[i])
+      {
+        at[i]     = points[to.to_vertex(h).idx()];
+        lookup[i] = at[i] + CORNER_SHIFT * (centroids[to.face(h).idx()] - at[i]);
+      }
+    }
+    find_samples(bvh, source_fc, lookup, at, active, true, max_distance, halfedge_samples);
+  }
+
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    if (on_halfedges[i])
+    {
+      write<Halfedge>(*source, target, names[i], types[i], halfedge_samples);
+    }
+    else
+    {
+      write<Vertex>(*source, target, names[i], types[i], vertex_samples);
+    }
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef LGMESH_ATTRIBUTETRANSFER_H
+#define LGMESH_ATTRIBUTETRANSFER_H
+
+#include "PolygonMesh.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace LG {
+
+class BVH;
+
+// Copy vertex and halfedge attributes from the surface of source to target.
+//
+// Every target vertex is projected to its closest point on source (in
+// parallel, with a BVH over source) and the named attributes are evaluated
+// there: Scalar, double, Vec2 and Vec3 attributes are interpolated with the
+// barycentric weights of the closest point, int, unsigned int and bool
+// attributes (labels) take the value of the nearest triangle corner.
+//
+// Halfedge attributes hold per-corner values such as UVs with seams
+// (halfedge h is the corner of to_vertex(h) in face(h)). They are looked up
+// from a point moved slightly into face(h), so the source face on the
+// matching side of a seam is found, and evaluated at the corner itself.
+//
+// Attributes are created on target if necessary. Elements with no source
+// surface within max_distance keep their values. Returns false if a name is
+// not a vertex or halfedge attribute of a supported type on source, or
+// exists on target with a different type; nothing is transferred then.
+bool transfer_attributes(const PolygonMesh& source, PolygonMesh& target,
+                         const std::vector<std::string>& names,
+                         Scalar max_distance = std::numeric_limits<Scalar>::infinity());
+
+// The same, reusing a BVH over the current faces of the source mesh
+bool transfer_attributes(const BVH& source, PolygonMesh& target,
+                         const std::vector<std::string>& names,
+                         Scalar max_distance = std::numeric_limits<Scalar>::infinity());
+
+}
+
+#endif // !LGMESH_ATTRIBUTETRANSFER_H
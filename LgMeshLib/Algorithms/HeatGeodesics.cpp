@@ -0,0 +1,236 @@
+#include "HeatGeodesics.h"
+#include "FrozenConnectivity.h"
+#include "Parallel.h"
+
+#include <iostream>
+#include <limits>
+
+namespace LG {
+
+HeatGeodesics::HeatGeodesics(PolygonMesh& mesh, Scalar time_factor)
+  : mesh_(mesh), time_factor_(time_factor), timestep_(0),
+    topology_generation_(0), geometry_generation_(0), valid_(false)
+{
+}
+
+bool HeatGeodesics::update()
+{
+  if (valid_ && topology_generation_ == mesh_.topology_generation() &&
+      geometry_generation_ == mesh_.geometry_generation())
+  {
+    return true;
+  }
+
+  const PolygonMesh& mesh = mesh_;
+  const FrozenConnectivity& fc = mesh.freeze();
+  const std::vector<int>& offsets = fc.face_vertex_offsets();
+  const std::vector<PolygonMesh::Vertex>& fv = fc.face_vertices();
+  const std::vector<Vec3>& points = mesh.points();
+  const size_t nf = mesh.faces_size();
+
+  for (size_t f = 0; f < nf; ++f)
+  {
+    const int valence = offsets[f + 1] - offsets[f];
+    if (valence != 0 && valence != 3)
+    {
+      std::cerr << "HeatGeodesics: the mesh has non-triangular faces" << std::endl;
+      valid_ = false;
+      return false;
+    }
+  }
+
+  face_vertices_.assign(3 * nf, -1);
+  hat_gradients_.assign(3 * nf, Vec3(0, 0, 0));
+  cotangents_.assign(3 * nf, Scalar(0));
+
+  parallel_for(0, nf, 2048, [&](size_t first, size_t last)
+  {
+    for (size_t f = first; f < last; ++f)
+    {
+      if (offsets[f + 1] == offsets[f])
+      {
+        continue;
+      }
+      const Vec3 p[3] = { points[fv[offsets[f]].idx()], points[fv[offsets[f] + 1].idx()], points[fv[offsets[f] + 2].idx()] };
+
+      Vec3 n = (p[1] - p[0]).cross(p[2] - p[0]);
+      const Scalar double_area = n.norm();
+      for (int a = 0; a < 3; ++a)
+      {
+        face_vertices_[3 * f + a] = fv[offsets[f] + a].idx();
+      }
+      if (double_area <= Scalar(0))
+      {
+        continue;
+      }
+      n /= double_area;
+
+      for (int a = 0; a < 3; ++a)
+      {
+        const Vec3& pa = p[a];
+        const Vec3& pb = p[(a + 1) % 3];
+        const Vec3& pc = p[(a + 2) % 3];
+        // gradient of the hat function of corner a: rotated opposite edge over 2A
+        hat_gradients_[3 * f + a] = n.cross(pc - pb) / double_area;
+        // cot of the angle at a = (b - a).(c - a) / |(b - a) x (c - a)|, the cross product is 2A
+        cotangents_[3 * f + a] = (pb - pa).dot(pc - pa) / double_area;
+      }
+    }
+  });
+
+  // time step from the mean edge length
+  std::pair<double, size_t> length = parallel_reduce(0, mesh.edges_size(), 4096, std::make_pair(0.0, size_t(0)),
+    [&](size_t first, size_t last, std::pair<double, size_t> sum)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        PolygonMesh::Edge e((int)i);
+        if (!mesh.is_deleted(e))
+        {
+          sum.first += (points[mesh.vertex(e, 1).idx()] - points[mesh.vertex(e, 0).idx()]).norm();
+          ++sum.second;
+        }
+      }
+      return sum;
+    },
+    [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b)
+    {
+      return std::make_pair(a.first + b.first, a.second + b.second);
+    });
+  const Scalar h = length.second ? Scalar(length.first / length.second) : Scalar(1);
+  timestep_ = time_factor_ * h * h;
+
+  topology_generation_ = mesh_.topology_generation();
+  geometry_generation_ = mesh_.geometry_generation();
+  valid_ = true;
+  return true;
+}
+
+bool HeatGeodesics::compute(const std::vector< std::vector<Vertex> >& source_sets, Dense_matrix& distances)
+{
+  if (!update())
+  {
+    return false;
+  }
+
+  const PolygonMesh& mesh = mesh_;
+  const size_t nv = mesh.vertices_size();
+  const size_t nf = mesh.faces_size();
+  const int k = (int)source_sets.size();
+  LaplacianSolverCache& cache = laplacian_solver_cache(mesh_);
+
+  // 1. heat flow from all source sets at once. The heat decays over many
+  // orders of magnitude away from the sources, which needs double precision.
+  Eigen::MatrixXd u0 = Eigen::MatrixXd::Zero(nv, k), u;
+  for (int c = 0; c < k; ++c)
+  {
+    for (size_t s = 0; s < source_sets[c].size(); ++s)
+    {
+      u0(source_sets[c][s].idx(), c) = 1.0;
+    }
+  }
+  if (!cache.solve(mesh, COTAN_LAPLACIAN, Scalar(1), timestep_, u0, u))
+  {
+    return false;
+  }
+
+  // 2. integrated divergence of the normalized gradient field, the Poisson
+  // system below is (eps M - L) phi = -div X
+  const FrozenConnectivity& fc = mesh.freeze();
+  const std::vector<Vec3>& points = mesh.points();
+  const double* U = u.data();
+  Dense_matrix divergence(nv, k);
+  std::vector<Vec3> field(nf);
+
+  for (int c = 0; c < k; ++c)
+  {
+    const double* uc = U + (size_t)c * nv;
+    parallel_for(0, nf, 2048, [&](size_t first, size_t last)
+    {
+      for (size_t f = first; f < last; ++f)
+      {
+        if (face_vertices_[3 * f] < 0)
+        {
+          field[f] = Vec3(0, 0, 0);
+          continue;
+        }
+        Eigen::Vector3d g = uc[face_vertices_[3 * f]] * hat_gradients_[3 * f].cast<double>()
+                          + uc[face_vertices_[3 * f + 1]] * hat_gradients_[3 * f + 1].cast<double>()
+                          + uc[face_vertices_[3 * f + 2]] * hat_gradients_[3 * f + 2].cast<double>();
+        const double norm = g.norm();
+        field[f] = norm > 0.0 ? Vec3((-g / norm).cast<Scalar>()) : Vec3(0, 0, 0);
+      }
+    });
+
+    parallel_for(0, nv, 2048, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        Scalar sum = 0;
+        FrozenConnectivity::Face_range faces = fc.faces(Vertex((int)i));
+        for (const PolygonMesh::Face* f = faces.begin(); f != faces.end(); ++f)
+        {
+          const size_t base = 3 * f->idx();
+          const int a = face_vertices_[base] == (int)i ? 0 : (face_vertices_[base + 1] == (int)i ? 1 : 2);
+          const int b = (a + 1) % 3, d = (a + 2) % 3;
+          const Vec3& pa = points[i];
+          const Vec3& X = field[f->idx()];
+          sum += cotangents_[base + d] * (points[face_vertices_[base + b]] - pa).dot(X)
+               + cotangents_[base + b] * (points[face_vertices_[base + d]] - pa).dot(X);
+        }
+        divergence(i, c) = Scalar(0.5) * sum;
+      }
+    });
+  }
+
+  // 3. L is singular on closed meshes, a tiny mass shift keeps it definite
+  const Scalar eps = Scalar(1e-6) * time_factor_ / timestep_;
+  if (!cache.solve(mesh, COTAN_LAPLACIAN, eps, Scalar(1), -divergence, distances))
+  {
+    return false;
+  }
+
+  // distances start at zero
+  parallel_for(0, k, 1, [&](size_t first, size_t last)
+  {
+    for (size_t c = first; c < last; ++c)
+    {
+      Scalar minimum = std::numeric_limits<Scalar>::max();
+      for (size_t i = 0; i < nv; ++i)
+      {
+        if (!mesh.is_deleted(Vertex((int)i)))
+        {
+          minimum = std::min(minimum, distances((int)i, (int)c));
+        }
+      }
+      distances.col(c).array() -= minimum;
+    }
+  });
+
+  return true;
+}
+
+bool HeatGeodesics::compute(const std::vector<Vertex>& sources, PolygonMesh::Vertex_attribute<Scalar> distance)
+{
+  Dense_matrix d;
+  if (!compute(std::vector< std::vector<Vertex> >(1, sources), d))
+  {
+    return false;
+  }
+  std::vector<Scalar>& values = distance.vector();
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = d((int)i, 0);
+  }
+  return true;
+}
+
+
+bool geodesic_distance_heat(PolygonMesh& mesh, const std::vector<PolygonMesh::Vertex>& sources,
+                            PolygonMesh::Vertex_attribute<Scalar> distance, Scalar time_factor)
+{
+  HeatGeodesics heat(mesh, time_factor);
+  return heat.compute(sources, distance);
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef LGMESH_HEATGEODESICS_H
+#define LGMESH_HEATGEODESICS_H
+
+#include "LaplacianSolver.h"
+
+namespace LG {
+
+// Geodesic distances by the heat method (Crane et al. 2013) on triangle meshes:
+//
+//   1. diffuse heat from the sources:  (M - t L) u = u0
+//   2. normalize the gradient:         X = -grad u / |grad u|   (per face)
+//   3. recover the distance:           L phi = div X
+//
+// Both systems are factorized once through the mesh's LaplacianSolverCache
+// and reused by every later query on the same mesh state, so a query costs
+// two back-substitutions. Batched queries solve all right-hand sides
+// together, in parallel.
+class HeatGeodesics
+{
+public:
+  typedef PolygonMesh::Vertex Vertex;
+
+  // t = time_factor * (mean edge length)^2
+  explicit HeatGeodesics(PolygonMesh& mesh, Scalar time_factor = 1);
+
+  // distance from the set of source vertices, written to distance
+  bool compute(const std::vector<Vertex>& sources, PolygonMesh::Vertex_attribute<Scalar> distance);
+
+  // one column of distances (rows are vertex indices) per source set
+  bool compute(const std::vector< std::vector<Vertex> >& source_sets, Dense_matrix& distances);
+
+private:
+  // refresh per-face data after the mesh changed, false if it has non-triangles
+  bool update();
+
+private:
+  PolygonMesh&        mesh_;
+  Scalar              time_factor_;
+  Scalar              timestep_;
+
+  unsigned long       topology_generation_;
+  unsigned long       geometry_generation_;
+  bool                valid_;
+
+  // per face: vertex indices, gradient of the three hat functions and the
+  // cotangents of the three corners
+  std::vector<int>    face_vertices_;
+  std::vector<Vec3>   hat_gradients_;
+  std::vector<Scalar> cotangents_;
+};
+
+// Heat method distance from sources, see HeatGeodesics
+bool geodesic_distance_heat(PolygonMesh& mesh, const std::vector<PolygonMesh::Vertex>& sources,
+                            PolygonMesh::Vertex_attribute<Scalar> distance, Scalar time_factor = 1);
+
+}
+
+#endif // !LGMESH_HEATGEODESICS_H
@@ -0,0 +1,269 @@
+#include "Laplacian.h"
+#include "FrozenConnectivity.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace LG {
+
+namespace {
+
+typedef PolygonMesh::Vertex   Vertex;
+typedef PolygonMesh::Halfedge Halfedge;
+typedef PolygonMesh::Face     Face;
+
+// Corner quantities of every halfedge h = (a -> b) of a face, with c the
+// vertex before a in that face:
+//   cot[h]      cotangent of the angle at c, which is opposite to h
+//   tan_half[h] tangent of half the angle at a
+// Boundary and deleted halfedges get 0.
+void compute_corner_weights(const PolygonMesh& mesh, bool need_tan_half,
+                            std::vector<Scalar>& cot, std::vector<Scalar>& tan_half)
+{
+  const std::vector<Vec3>& points = mesh.points();
+  const size_t nh = mesh.halfedges_size();
+
+  cot.assign(nh, Scalar(0));
+  tan_half.assign(need_tan_half ? nh : 0, Scalar(0));
+
+  parallel_for(0, nh, 2048, [&](size_t first, size_t last)
+  {
+    // halfedges are gathered into blocks of edge vectors (structure of arrays),
+    // the dot and cross products are then computed in plain loops that vectorize
+    const size_t BLOCK = 64;
+    Scalar ux[BLOCK], uy[BLOCK], uz[BLOCK], vx[BLOCK], vy[BLOCK], vz[BLOCK];
+    Scalar wx[BLOCK], wy[BLOCK], wz[BLOCK];
+    Scalar cot_out[BLOCK], tan_out[BLOCK];
+    size_t index[BLOCK];
+
+    size_t i = first;
+    while (i < last)
+    {
+      size_t n = 0;
+      for (; i < last && n < BLOCK; ++i)
+      {
+        Halfedge h((int)i);
+        if (mesh.is_deleted(mesh.edge(h)) || mesh.is_boundary(h))
+        {
+          continue;
+        }
+        const Vec3& a = points[mesh.from_vertex(h).idx()];
+        const Vec3& b = points[mesh.to_vertex(h).idx()];
+        const Vec3& c = points[mesh.from_vertex(mesh.prev_halfedge(h)).idx()];
+        // u = a - c, v = b - c span the angle at c, w = b - a
+        ux[n] = a[0] - c[0]; uy[n] = a[1] - c[1]; uz[n] = a[2] - c[2];
+        vx[n] = b[0] - c[0]; vy[n] = b[1] - c[1]; vz[n] = b[2] - c[2];
+        wx[n] = b[0] - a[0]; wy[n] = b[1] - a[1]; wz[n] = b[2] - a[2];
+        index[n] = i;
+        ++n;
+      }
+
+      for (size_t k = 0; k < n; ++k)
+      {
+        Scalar cx = uy[k] * vz[k] - uz[k] * vy[k];
+        Scalar cy = uz[k] * vx[k] - ux[k] * vz[k];
+        Scalar cz = ux[k] * vy[k] - uy[k] * vx[k];
+        Scalar cross = std::sqrt(cx * cx + cy * cy + cz * cz);
+        Scalar dot = ux[k] * vx[k] + uy[k] * vy[k] + uz[k] * vz[k];
+        Scalar lu = std::sqrt(ux[k] * ux[k] + uy[k] * uy[k] + uz[k] * uz[k]);
+        Scalar lv = std::sqrt(vx[k] * vx[k] + vy[k] * vy[k] + vz[k] * vz[k]);
+        Scalar lw = std::sqrt(wx[k] * wx[k] + wy[k] * wy[k] + wz[k] * wz[k]);
+
+        // keep weights of degenerate corners finite
+        Scalar denom = std::max(cross, Scalar(1e-6) * lu * lv + std::numeric_limits<Scalar>::min());
+        cot_out[k] = dot / denom;
+
+        // angle at a between w = b - a and -u = c - a:
+        // tan(alpha / 2) = (|w| |u| - w.(-u)) / |w x (-u)|, and |w x u| = |u x v|
+        Scalar dot_a = -(wx[k] * ux[k] + wy[k] * uy[k] + wz[k] * uz[k]);
+        Scalar denom_a = std::max(cross, Scalar(1e-6) * lw * lu + std::numeric_limits<Scalar>::min());
+        tan_out[k] = (lw * lu - dot_a) / denom_a;
+      }
+
+      for (size_t k = 0; k < n; ++k)
+      {
+        cot[index[k]] = cot_out[k];
+      }
+      if (need_tan_half)
+      {
+        for (size_t k = 0; k < n; ++k)
+        {
+          tan_half[index[k]] = tan_out[k];
+        }
+      }
+    }
+  });
+}
+
+// Weight w_ij of the halfedge h = (i -> j)
+inline Scalar halfedge_weight(const PolygonMesh& mesh, Laplacian_weighting weighting, Halfedge h,
+                              const std::vector<Scalar>& cot, const std::vector<Scalar>& tan_half)
+{
+  switch (weighting)
+  {
+  case COTAN_LAPLACIAN:
+    return Scalar(0.5) * (cot[h.idx()] + cot[mesh.opposite_halfedge(h).idx()]);
+  case MEAN_VALUE_LAPLACIAN:
+    {
+      // angles at i in the faces on both sides of the edge
+      Scalar t = tan_half[h.idx()] + tan_half[mesh.next_halfedge(mesh.opposite_halfedge(h)).idx()];
+      Scalar length = (mesh.position(mesh.to_vertex(h)) - mesh.position(mesh.from_vertex(h))).norm();
+      return length > Scalar(0) ? t / length : Scalar(0);
+    }
+  default:
+    return Scalar(1);
+  }
+}
+
+}
+
+
+void laplacian_matrix(const PolygonMesh& mesh, Laplacian_weighting weighting, Sparse_matrix& L)
+{
+  const int nv = (int)mesh.vertices_size();
+
+  std::vector<Scalar> cot, tan_half;
+  if (weighting != UNIFORM_LAPLACIAN)
+  {
+    compute_corner_weights(mesh, weighting == MEAN_VALUE_LAPLACIAN, cot, tan_half);
+  }
+
+  // column j holds the neighbours of j plus the diagonal
+  const std::vector<int>& valence_offsets = mesh.freeze().vertex_vertex_offsets();
+  const int nnz = valence_offsets[nv] + nv;
+
+  L.resize(nv, nv);
+  L.resizeNonZeros(nnz);
+  int*    outer = L.outerIndexPtr();
+  int*    inner = L.innerIndexPtr();
+  Scalar* value = L.valuePtr();
+
+  for (int j = 0; j <= nv; ++j)
+  {
+    outer[j] = valence_offsets[j] + j;
+  }
+
+  parallel_for(0, nv, 1024, [&](size_t first, size_t last)
+  {
+    std::vector< std::pair<int, Scalar> > column;
+
+    for (size_t j = first; j < last; ++j)
+    {
+      Vertex v((int)j);
+      column.clear();
+
+      // column j: L(i, j) = w_ij for the neighbours i, reached through the
+      // outgoing halfedges h = (j -> i); the diagonal sums the row weights w_jk
+      Scalar diagonal = 0;
+      if (!mesh.is_deleted(v))
+      {
+        PolygonMesh::Halfedge_around_vertex_circulator hc = mesh.halfedges(v), hc_end = hc;
+        if (hc)
+        {
+          do
+          {
+            Halfedge h = *hc;
+            column.push_back(std::make_pair(mesh.to_vertex(h).idx(),
+                                            halfedge_weight(mesh, weighting, mesh.opposite_halfedge(h), cot, tan_half)));
+            diagonal -= halfedge_weight(mesh, weighting, h, cot, tan_half);
+          } while (++hc != hc_end);
+        }
+      }
+      column.push_back(std::make_pair((int)j, diagonal));
+
+      // compressed storage needs increasing row indices, columns are short
+      std::sort(column.begin(), column.end());
+
+      int k = outer[j];
+      for (size_t c = 0; c < column.size(); ++c, ++k)
+      {
+        inner[k] = column[c].first;
+        value[k] = column[c].second;
+      }
+    }
+  });
+}
+
+void cotan_weights(const PolygonMesh& mesh, std::vector<Scalar>& weights)
+{
+  std::vector<Scalar> cot, tan_half;
+  compute_corner_weights(mesh, false, cot, tan_half);
+
+  // boundary halfedges have cot 0, so boundary edges get half a weight
+  const size_t ne = mesh.edges_size();
+  weights.resize(ne);
+  parallel_for(0, ne, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t e = first; e < last; ++e)
+    {
+      weights[e] = Scalar(0.5) * (cot[2 * e] + cot[2 * e + 1]);
+    }
+  });
+}
+
+void mass_matrix(const PolygonMesh& mesh, Sparse_matrix& M)
+{
+  const int nv = (int)mesh.vertices_size();
+  const size_t nf = mesh.faces_size();
+  const std::vector<Vec3>& points = mesh.points();
+
+  // area share of every corner of a face
+  std::vector<Scalar> corner_area(nf, Scalar(0));
+  parallel_for(0, nf, 1024, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Face f((int)i);
+      if (mesh.is_deleted(f))
+      {
+        continue;
+      }
+      // fan around the first corner
+      Halfedge h = mesh.halfedge(f), hend = mesh.prev_halfedge(h);
+      const Vec3& o = points[mesh.from_vertex(h).idx()];
+      Vec3 n(0, 0, 0);
+      int n_corners = 1;
+      for (h = mesh.next_halfedge(h); h != hend; h = mesh.next_halfedge(h), ++n_corners)
+      {
+        n += (points[mesh.from_vertex(h).idx()] - o).cross(points[mesh.to_vertex(h).idx()] - o);
+      }
+      ++n_corners;
+      corner_area[i] = Scalar(0.5) * n.norm() / n_corners;
+    }
+  });
+
+  const FrozenConnectivity& fc = mesh.freeze();
+
+  M.resize(nv, nv);
+  M.resizeNonZeros(nv);
+  int*    outer = M.outerIndexPtr();
+  int*    inner = M.innerIndexPtr();
+  Scalar* value = M.valuePtr();
+
+  parallel_for(0, nv, 2048, [&](size_t first, size_t last)
+  {
+    for (size_t j = first; j < last; ++j)
+    {
+      Scalar area = 0;
+      FrozenConnectivity::Face_range faces = fc.faces(Vertex((int)j));
+      for (const Face* f = faces.begin(); f != faces.end(); ++f)
+      {
+        area += corner_area[f->idx()];
+      }
+      outer[j] = (int)j;
+      inner[j] = (int)j;
+      value[j] = area > Scalar(0) ? area : Scalar(1);
+    }
+  });
+  outer[nv] = nv;
+}
+
+void laplacian_matrix(const PolygonMesh& mesh, Laplacian_weighting weighting, Sparse_matrix& L, Sparse_matrix& M)
+{
+  laplacian_matrix(mesh, weighting, L);
+  mass_matrix(mesh, M);
+}
+
+}
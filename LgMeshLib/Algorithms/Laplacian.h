@@ -0,0 +1,47 @@
+#ifndef LGMESH_LAPLACIAN_H
+#define LGMESH_LAPLACIAN_H
+
+#include "PolygonMesh.h"
+
+#include "Eigen/Sparse"
+
+namespace LG {
+
+typedef Eigen::SparseMatrix<Scalar>              Sparse_matrix;
+typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Dense_vector;
+
+enum Laplacian_weighting
+{
+  UNIFORM_LAPLACIAN,    // w_ij = 1 (graph Laplacian)
+  COTAN_LAPLACIAN,      // w_ij = (cot(alpha_ij) + cot(beta_ij)) / 2
+  MEAN_VALUE_LAPLACIAN  // w_ij = (tan(gamma_ij / 2) + tan(delta_ij / 2)) / |x_j - x_i|, not symmetric
+};
+
+// Assemble the Laplacian of mesh into a compressed column matrix,
+//
+//   (L x)_i = sum_j w_ij (x_j - x_i),
+//
+// so off-diagonal entries are w_ij and the diagonal is -sum_j w_ij.
+// Rows and columns are vertex indices (deleted vertices included, their
+// columns only hold a zero diagonal). The sparsity pattern is known from the
+// vertex valences, so the columns are written in place and in parallel
+// without going through triplets. Cotan and mean-value weights assume
+// triangle faces; other polygons use the corner before each halfedge.
+void laplacian_matrix(const PolygonMesh& mesh, Laplacian_weighting weighting, Sparse_matrix& L);
+
+// Cotan weights w_ij = (cot(alpha_ij) + cot(beta_ij)) / 2 of all edges, by
+// edge index, as used by laplacian_matrix(). The cotangents keep their sign
+// and stay finite on degenerate triangles; deleted edges get 0.
+void cotan_weights(const PolygonMesh& mesh, std::vector<Scalar>& weights);
+
+// Diagonal lumped mass matrix: every vertex gets an equal share of the area of
+// its incident faces (barycentric cells). Isolated and deleted vertices get
+// mass 1, which keeps systems like M - t L invertible.
+void mass_matrix(const PolygonMesh& mesh, Sparse_matrix& M);
+
+// Laplacian and matching mass matrix in one call
+void laplacian_matrix(const PolygonMesh& mesh, Laplacian_weighting weighting, Sparse_matrix& L, Sparse_matrix& M);
+
+}
+
+#endif // !LGMESH_LAPLACIAN_H
@@ -0,0 +1,137 @@
+#include "LaplacianOperator.h"
+#include "Parallel.h"
+
+#include "Eigen/IterativeLinearSolvers"
+
+namespace LG {
+
+LaplacianOperator::LaplacianOperator(PolygonMesh& mesh, Scalar mass_coeff, Scalar laplace_coeff)
+  : mesh_(mesh), mass_coeff_(mass_coeff), laplace_coeff_(laplace_coeff),
+    topology_generation_(0), geometry_generation_(0), valid_(false)
+{
+  update();
+}
+
+void LaplacianOperator::update()
+{
+  if (valid_ && topology_generation_ == mesh_.topology_generation() &&
+      geometry_generation_ == mesh_.geometry_generation())
+  {
+    return;
+  }
+
+  const PolygonMesh& mesh = mesh_;
+  cotan_weights(mesh, weight_);
+
+  const size_t nv = mesh.vertices_size();
+  const std::vector<Vec3>& points = mesh.points();
+  mass_.resize(nv);
+  diagonal_.resize(nv);
+
+  parallel_for(0, nv, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      PolygonMesh::Vertex v((int)i);
+      Scalar area = 0, weight_sum = 0;
+      if (!mesh.is_deleted(v))
+      {
+        PolygonMesh::Halfedge_around_vertex_circulator hc = mesh.halfedges(v), hc_end = hc;
+        if (hc)
+        {
+          do
+          {
+            weight_sum += weight_[mesh.edge(*hc).idx()];
+
+            // equal share of the incident face, fan around this corner
+            if (!mesh.is_boundary(*hc))
+            {
+              PolygonMesh::Halfedge h = mesh.next_halfedge(*hc), hend = mesh.prev_halfedge(*hc);
+              const Vec3& o = points[i];
+              Vec3 n(0, 0, 0);
+              int n_corners = 2;
+              for (; h != hend; h = mesh.next_halfedge(h), ++n_corners)
+              {
+                n += (points[mesh.from_vertex(h).idx()] - o).cross(points[mesh.to_vertex(h).idx()] - o);
+              }
+              area += Scalar(0.5) * n.norm() / n_corners;
+            }
+          } while (++hc != hc_end);
+        }
+      }
+      // isolated and deleted vertices get mass 1, as in mass_matrix()
+      mass_[i] = area > Scalar(0) ? area : Scalar(1);
+      diagonal_[i] = mass_coeff_ * mass_[i] + laplace_coeff_ * weight_sum;
+    }
+  });
+
+  topology_generation_ = mesh_.topology_generation();
+  geometry_generation_ = mesh_.geometry_generation();
+  valid_ = true;
+}
+
+void LaplacianOperator::apply(const Dense_vector& x, Dense_vector& y) const
+{
+  const PolygonMesh& mesh = mesh_;
+  const size_t nv = mass_.size();
+  assert((size_t)x.size() == nv);
+  y.resize(nv);
+
+  parallel_for(0, nv, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      PolygonMesh::Vertex v((int)i);
+      const Scalar xi = x[i];
+      // (L x)_i = sum_j w_ij (x_j - x_i)
+      Scalar lx = 0;
+      PolygonMesh::Halfedge_around_vertex_circulator hc = mesh.halfedges(v), hc_end = hc;
+      if (hc && !mesh.is_deleted(v))
+      {
+        do
+        {
+          lx += weight_[mesh.edge(*hc).idx()] * (x[mesh.to_vertex(*hc).idx()] - xi);
+        } while (++hc != hc_end);
+      }
+      y[i] = mass_coeff_ * mass_[i] * xi - laplace_coeff_ * lx;
+    }
+  });
+}
+
+
+Jacobi_preconditioner::Jacobi_preconditioner(const LaplacianOperator& op)
+{
+  const Dense_vector& d = op.diagonal();
+  inverse_diagonal_.resize(d.size());
+  for (int i = 0; i < d.size(); ++i)
+  {
+    inverse_diagonal_[i] = d[i] != Scalar(0) ? Scalar(1) / d[i] : Scalar(1);
+  }
+}
+
+
+bool solve_cg(const LaplacianOperator& A, const Dense_vector& b, Dense_vector& x,
+              int max_iterations, Scalar tolerance, int* iterations, Scalar* error)
+{
+  if (x.size() != b.size())
+  {
+    x.setZero(b.size());
+  }
+
+  Jacobi_preconditioner preconditioner(A);
+  int    n_iterations = max_iterations;
+  Scalar residual     = tolerance;
+  Eigen::internal::conjugate_gradient(A, b, x, preconditioner, n_iterations, residual);
+
+  if (iterations)
+  {
+    *iterations = n_iterations;
+  }
+  if (error)
+  {
+    *error = residual;
+  }
+  return residual <= tolerance;
+}
+
+}
@@ -0,0 +1,85 @@
+#ifndef LGMESH_LAPLACIANOPERATOR_H
+#define LGMESH_LAPLACIANOPERATOR_H
+
+#include "Laplacian.h"
+
+namespace LG {
+
+// Matrix-free form of the system  A = mass_coeff * M - laplace_coeff * L
+// with the cotan Laplacian L and the lumped mass matrix M of Laplacian.h.
+//
+// A x is evaluated by circulating the halfedges of every vertex, reading
+// the edge weights of cotan_weights(), so besides the mesh only one scalar
+// per edge and two per vertex (mass and diagonal) are stored. This scales to
+// meshes whose assembled matrix or factorization does not fit in memory.
+// The operator provides what Eigen's iterative solver kernels need
+// (cols(), operator*), see solve_cg() below.
+class LaplacianOperator
+{
+public:
+  LaplacianOperator(PolygonMesh& mesh, Scalar mass_coeff, Scalar laplace_coeff);
+
+  // Recompute edge weights and masses if the mesh changed since the last update
+  void update();
+
+  int rows() const { return (int)mass_.size(); };
+  int cols() const { return (int)mass_.size(); };
+
+  // y = A x, in parallel over the vertices
+  void apply(const Dense_vector& x, Dense_vector& y) const;
+
+  Dense_vector operator*(const Dense_vector& x) const
+  {
+    Dense_vector y;
+    apply(x, y);
+    return y;
+  }
+
+  // diagonal of A
+  const Dense_vector& diagonal() const { return diagonal_; };
+
+  // lumped vertex masses
+  const Dense_vector& mass() const { return mass_; };
+
+private:
+  PolygonMesh&                          mesh_;
+  Scalar                                mass_coeff_;
+  Scalar                                laplace_coeff_;
+  std::vector<Scalar>                   weight_;      // by edge
+
+  unsigned long                         topology_generation_;
+  unsigned long                         geometry_generation_;
+  bool                                  valid_;
+
+  Dense_vector                          mass_;
+  Dense_vector                          diagonal_;
+};
+
+
+// Diagonal (Jacobi) preconditioner of a LaplacianOperator. Incomplete
+// factorizations need the assembled matrix and are not available here.
+class Jacobi_preconditioner
+{
+public:
+  explicit Jacobi_preconditioner(const LaplacianOperator& op);
+
+  Dense_vector solve(const Dense_vector& r) const
+  {
+    return inverse_diagonal_.cwiseProduct(r);
+  }
+
+private:
+  Dense_vector inverse_diagonal_;
+};
+
+
+// Solve A x = b with Jacobi preconditioned conjugate gradients, x holds the
+// initial guess. Returns whether the relative residual dropped below
+// tolerance; the iterations done and the residual reached are optional outputs.
+bool solve_cg(const LaplacianOperator& A, const Dense_vector& b, Dense_vector& x,
+              int max_iterations = 1000, Scalar tolerance = Scalar(1e-6),
+              int* iterations = NULL, Scalar* error = NULL);
+
+}
+
+#endif // !LGMESH_LAPLACIANOPERATOR_H
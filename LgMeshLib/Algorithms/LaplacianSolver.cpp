@@ -0,0 +1,193 @@
+#include "LaplacianSolver.h"
+#include "Parallel.h"
+
+#include <iostream>
+
+namespace LG {
+
+bool LaplacianSolver::solve(const Dense_matrix& B, Dense_matrix& X) const
+{
+  Eigen::MatrixXd x;
+  if (!solve(Eigen::MatrixXd(B.cast<double>()), x))
+  {
+    return false;
+  }
+  X = x.cast<Scalar>();
+  return true;
+}
+
+bool LaplacianSolver::solve(const Eigen::MatrixXd& B, Eigen::MatrixXd& X) const
+{
+  if (!valid_ || B.rows() != factorization_.rows())
+  {
+    std::cerr << "LaplacianSolver::solve: no factorization for this system" << std::endl;
+    return false;
+  }
+
+  Eigen::MatrixXd x(B.rows(), B.cols());
+
+#ifdef LGMESH_USE_CHOLMOD
+  // CHOLMOD keeps workspace in its common object, solve all columns at once
+  x = factorization_.solve(B);
+#else
+  parallel_for(0, B.cols(), 1, [&](size_t first, size_t last)
+  {
+    for (size_t c = first; c < last; ++c)
+    {
+      x.col(c) = factorization_.solve(B.col(c));
+    }
+  });
+#endif
+
+  if (factorization_.info() != Eigen::Success)
+  {
+    return false;
+  }
+  X.swap(x);
+  return true;
+}
+
+
+const Sparse_matrix& LaplacianSolverCache::laplacian(const PolygonMesh& mesh, Laplacian_weighting weighting)
+{
+  bind(mesh);
+  Matrix_entry& entry = laplacians_[weighting];
+  if (!is_current(entry, mesh))
+  {
+    laplacian_matrix(mesh, weighting, entry.matrix);
+    entry.topology_generation = mesh.topology_generation();
+    entry.geometry_generation = mesh.geometry_generation();
+    entry.valid = true;
+  }
+  return entry.matrix;
+}
+
+const Sparse_matrix& LaplacianSolverCache::mass(const PolygonMesh& mesh)
+{
+  bind(mesh);
+  if (!is_current(mass_, mesh))
+  {
+    mass_matrix(mesh, mass_.matrix);
+    mass_.topology_generation = mesh.topology_generation();
+    mass_.geometry_generation = mesh.geometry_generation();
+    mass_.valid = true;
+  }
+  return mass_.matrix;
+}
+
+const LaplacianSolver* LaplacianSolverCache::solver(const PolygonMesh& mesh, Laplacian_weighting weighting,
+                                                    Scalar mass_coeff, Scalar laplace_coeff)
+{
+  if (weighting == MEAN_VALUE_LAPLACIAN)
+  {
+    std::cerr << "LaplacianSolverCache: mean-value Laplacian is not symmetric" << std::endl;
+    return NULL;
+  }
+
+  bind(mesh);
+
+  // look up the entry and move it to the front
+  std::shared_ptr<LaplacianSolver> entry;
+  for (size_t i = 0; i < solvers_.size(); ++i)
+  {
+    const LaplacianSolver& s = *solvers_[i];
+    if (s.weighting_ == weighting && s.mass_coeff_ == mass_coeff && s.laplace_coeff_ == laplace_coeff)
+    {
+      entry = solvers_[i];
+      solvers_.erase(solvers_.begin() + i);
+      break;
+    }
+  }
+  if (!entry)
+  {
+    entry.reset(new LaplacianSolver(weighting, mass_coeff, laplace_coeff));
+    if (solvers_.size() >= MAX_SOLVERS)
+    {
+      solvers_.pop_back();
+    }
+  }
+  solvers_.insert(solvers_.begin(), entry);
+
+  LaplacianSolver& s = *entry;
+  const bool same_topology = s.valid_ && s.topology_generation_ == mesh.topology_generation();
+  if (same_topology && s.geometry_generation_ == mesh.geometry_generation())
+  {
+    return &s;
+  }
+
+  // the sparsity pattern only depends on the topology
+  LaplacianSolver::Matrix_type A = (mass_coeff * mass(mesh) - laplace_coeff * laplacian(mesh, weighting)).cast<double>();
+  if (!same_topology)
+  {
+    s.factorization_.analyzePattern(A);
+    ++n_symbolic_;
+  }
+  s.factorization_.factorize(A);
+  ++n_numeric_;
+
+  s.valid_ = (s.factorization_.info() == Eigen::Success);
+  s.topology_generation_ = mesh.topology_generation();
+  s.geometry_generation_ = mesh.geometry_generation();
+  if (!s.valid_)
+  {
+    std::cerr << "LaplacianSolverCache: factorization failed" << std::endl;
+    return NULL;
+  }
+  return &s;
+}
+
+bool LaplacianSolverCache::solve(const PolygonMesh& mesh, Laplacian_weighting weighting,
+                                 Scalar mass_coeff, Scalar laplace_coeff, const Dense_matrix& B, Dense_matrix& X)
+{
+  const LaplacianSolver* s = solver(mesh, weighting, mass_coeff, laplace_coeff);
+  if (!s)
+  {
+    return false;
+  }
+  ++n_solves_;
+  return s->solve(B, X);
+}
+
+bool LaplacianSolverCache::solve(const PolygonMesh& mesh, Laplacian_weighting weighting,
+                                 Scalar mass_coeff, Scalar laplace_coeff, const Eigen::MatrixXd& B, Eigen::MatrixXd& X)
+{
+  const LaplacianSolver* s = solver(mesh, weighting, mass_coeff, laplace_coeff);
+  if (!s)
+  {
+    return false;
+  }
+  ++n_solves_;
+  return s->solve(B, X);
+}
+
+void LaplacianSolverCache::clear()
+{
+  mesh_ = NULL;
+  for (int i = 0; i < 3; ++i)
+  {
+    laplacians_[i] = Matrix_entry();
+  }
+  mass_ = Matrix_entry();
+  solvers_.clear();
+}
+
+void LaplacianSolverCache::bind(const PolygonMesh& mesh)
+{
+  if (mesh_ != &mesh)
+  {
+    clear();
+    mesh_ = &mesh;
+  }
+}
+
+
+LaplacianSolverCache& laplacian_solver_cache(PolygonMesh& mesh)
+{
+  if (!mesh.has_attribute("g:laplacian_solver_cache"))
+  {
+    return mesh.add_attribute<LaplacianSolverCache>("g:laplacian_solver_cache");
+  }
+  return mesh.get_attribute<LaplacianSolverCache>("g:laplacian_solver_cache");
+}
+
+}
@@ -0,0 +1,146 @@
+#ifndef LGMESH_LAPLACIANSOLVER_H
+#define LGMESH_LAPLACIANSOLVER_H
+
+#include "Laplacian.h"
+
+#include <memory>
+#include <vector>
+
+#ifdef LGMESH_USE_CHOLMOD
+#include "Eigen/CholmodSupport"
+#else
+#include "Eigen/SparseCholesky"
+#endif
+
+namespace LG {
+
+typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Dense_matrix;
+
+// Factorization of the system  mass_coeff * M - laplace_coeff * L  for one
+// mesh state, as handed out by LaplacianSolverCache. Factorization and
+// solves run in double precision.
+class LaplacianSolver
+{
+public:
+  typedef Eigen::SparseMatrix<double> Matrix_type;
+#ifdef LGMESH_USE_CHOLMOD
+  typedef Eigen::CholmodDecomposition<Matrix_type> Factorization;
+#else
+  typedef Eigen::SimplicialLDLT<Matrix_type>       Factorization;
+#endif
+
+  LaplacianSolver(Laplacian_weighting weighting, Scalar mass_coeff, Scalar laplace_coeff)
+    : weighting_(weighting), mass_coeff_(mass_coeff), laplace_coeff_(laplace_coeff),
+      topology_generation_(0), geometry_generation_(0), valid_(false) {};
+
+  Laplacian_weighting weighting() const { return weighting_; };
+  Scalar mass_coeff() const { return mass_coeff_; };
+  Scalar laplace_coeff() const { return laplace_coeff_; };
+
+  // Solve the system for every column of B, columns are solved in parallel
+  bool solve(const Dense_matrix& B, Dense_matrix& X) const;
+
+  // Same in double precision, e.g. for solutions spanning many orders of magnitude
+  bool solve(const Eigen::MatrixXd& B, Eigen::MatrixXd& X) const;
+
+private:
+  friend class LaplacianSolverCache;
+
+  Laplacian_weighting  weighting_;
+  Scalar               mass_coeff_;
+  Scalar               laplace_coeff_;
+
+  // mesh state the numeric factorization belongs to
+  unsigned long        topology_generation_;
+  unsigned long        geometry_generation_;
+  bool                 valid_;
+
+  Factorization        factorization_;
+};
+
+
+// Per-mesh cache of Laplacian and mass matrices and of factorizations of
+// mass_coeff * M - laplace_coeff * L, keyed by weighting and coefficients.
+//
+// Entries are checked against the topology and geometry generations of the
+// mesh: a topology change redoes the symbolic analysis, a geometry change
+// only the numeric factorization, and an unchanged mesh costs just the
+// back-substitution. The cache is not thread-safe. Copying a cache yields an
+// empty one, so copied meshes never share factorizations.
+class LaplacianSolverCache
+{
+public:
+  LaplacianSolverCache() : mesh_(NULL), n_symbolic_(0), n_numeric_(0), n_solves_(0) {};
+  LaplacianSolverCache(const LaplacianSolverCache&) : mesh_(NULL), n_symbolic_(0), n_numeric_(0), n_solves_(0) {};
+  LaplacianSolverCache& operator=(const LaplacianSolverCache&) { clear(); return *this; };
+
+  // Laplacian of the current mesh state
+  const Sparse_matrix& laplacian(const PolygonMesh& mesh, Laplacian_weighting weighting);
+
+  // Lumped mass matrix of the current mesh state
+  const Sparse_matrix& mass(const PolygonMesh& mesh);
+
+  // Factorization of mass_coeff * M - laplace_coeff * L for the current mesh
+  // state, NULL if the system cannot be factorized (e.g. mean-value weights,
+  // which are not symmetric). The pointer stays valid until the next call.
+  const LaplacianSolver* solver(const PolygonMesh& mesh, Laplacian_weighting weighting,
+                                Scalar mass_coeff, Scalar laplace_coeff);
+
+  // Solve (mass_coeff * M - laplace_coeff * L) X = B for all columns of B
+  bool solve(const PolygonMesh& mesh, Laplacian_weighting weighting,
+             Scalar mass_coeff, Scalar laplace_coeff, const Dense_matrix& B, Dense_matrix& X);
+
+  bool solve(const PolygonMesh& mesh, Laplacian_weighting weighting,
+             Scalar mass_coeff, Scalar laplace_coeff, const Eigen::MatrixXd& B, Eigen::MatrixXd& X);
+
+  // Drop all matrices and factorizations
+  void clear();
+
+  // statistics
+  size_t n_symbolic_factorizations() const { return n_symbolic_; };
+  size_t n_numeric_factorizations() const { return n_numeric_; };
+  size_t n_solves() const { return n_solves_; };
+
+private:
+  struct Matrix_entry
+  {
+    Matrix_entry() : topology_generation(0), geometry_generation(0), valid(false) {};
+    unsigned long  topology_generation;
+    unsigned long  geometry_generation;
+    bool           valid;
+    Sparse_matrix  matrix;
+  };
+
+  // forget everything if the cache is used with another mesh
+  void bind(const PolygonMesh& mesh);
+
+  static bool is_current(const Matrix_entry& entry, const PolygonMesh& mesh)
+  {
+    return entry.valid && entry.topology_generation == mesh.topology_generation() &&
+      entry.geometry_generation == mesh.geometry_generation();
+  }
+
+  // number of factorizations kept, the least recently used one is dropped
+  static const size_t MAX_SOLVERS = 8;
+
+private:
+  const PolygonMesh*  mesh_;
+
+  Matrix_entry        laplacians_[3];
+  Matrix_entry        mass_;
+
+  // most recently used first
+  std::vector< std::shared_ptr<LaplacianSolver> > solvers_;
+
+  size_t              n_symbolic_;
+  size_t              n_numeric_;
+  size_t              n_solves_;
+};
+
+// The cache attached to mesh as the global attribute "g:laplacian_solver_cache",
+// created on first use
+LaplacianSolverCache& laplacian_solver_cache(PolygonMesh& mesh);
+
+}
+
+#endif // !LGMESH_LAPLACIANSOLVER_H
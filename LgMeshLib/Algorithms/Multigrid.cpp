@@ -0,0 +1,501 @@
+#include "Multigrid.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdint.h>
+#include <unordered_map>
+
+namespace LG {
+
+namespace {
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// scratch of one thread in a sparse matrix product
+struct Product_scratch
+{
+  std::vector<int>                        position;  // slot of a column in entries, -1 if unused
+  std::vector< std::pair<int, Scalar> >   entries;
+};
+
+// 1 / diagonal of A, 0 for empty rows
+void inverse_diagonal(const MultigridSolver::Matrix_type& A, Dense_vector& d)
+{
+  d.resize(A.rows());
+  parallel_for(0, A.rows(), 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Scalar a = A.coeff((int)i, (int)i);
+      d[i] = a != Scalar(0) ? Scalar(1) / a : Scalar(0);
+    }
+  });
+}
+
+}
+
+
+bool MultigridSolver::setup(const PolygonMesh& mesh, Laplacian_weighting weighting, Scalar mass_coeff, Scalar laplace_coeff)
+{
+  if (weighting == MEAN_VALUE_LAPLACIAN)
+  {
+    std::cerr << "MultigridSolver: mean-value Laplacian is not symmetric" << std::endl;
+    return false;
+  }
+
+  Sparse_matrix L, M;
+  laplacian_matrix(mesh, weighting, L, M);
+  Sparse_matrix A = mass_coeff * M - laplace_coeff * L;
+  return setup(A, mesh.points());
+}
+
+bool MultigridSolver::setup(const Sparse_matrix& A, const std::vector<Vec3>& points)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  ready_ = false;
+  levels_.clear();
+  statistics_ = Multigrid_statistics();
+
+  if (A.rows() != A.cols() || A.rows() != (int)points.size())
+  {
+    std::cerr << "MultigridSolver: matrix and points do not match" << std::endl;
+    return false;
+  }
+
+  // levels hold large matrices, avoid copying them when the vector grows
+  levels_.reserve(32);
+  levels_.push_back(Level());
+  levels_[0].A = A;
+
+  // start with cells of about two edge lengths
+  const Matrix_type& A0 = levels_[0].A;
+  std::pair<double, size_t> length = parallel_reduce(0, (size_t)A0.rows(), 4096, std::make_pair(0.0, size_t(0)),
+    [&](size_t first, size_t last, std::pair<double, size_t> sum)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        for (Matrix_type::InnerIterator it(A0, (int)i); it; ++it)
+        {
+          if (it.col() != (int)i)
+          {
+            sum.first += (points[it.col()] - points[i]).norm();
+            ++sum.second;
+          }
+        }
+      }
+      return sum;
+    },
+    [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b)
+    {
+      return std::make_pair(a.first + b.first, a.second + b.second);
+    });
+  Scalar cell_size = length.second ? Scalar(2 * length.first / length.second) : Scalar(1);
+
+  inverse_diagonal(levels_[0].A, levels_[0].inverse_diagonal);
+
+  std::vector<Vec3> level_points(points), coarse_points;
+  std::vector<int>  cluster;
+  while (levels_.back().A.rows() > settings_.coarsest_size && levels_.size() < levels_.capacity())
+  {
+    Level& fine = levels_.back();
+    const int n_fine = (int)fine.A.rows();
+
+    // grow the cells until the level shrinks noticeably
+    int n_coarse = aggregate(level_points, cell_size, cluster, coarse_points);
+    for (int attempt = 0; attempt < 8 && n_coarse > 0.85 * n_fine; ++attempt)
+    {
+      cell_size *= 2;
+      n_coarse = aggregate(level_points, cell_size, cluster, coarse_points);
+    }
+    if (n_coarse >= n_fine)
+    {
+      break;
+    }
+
+    // Galerkin operator R A P
+    prolongation(fine, cluster, n_coarse);
+    Matrix_type AP, coarse_A;
+    multiply(fine.A, fine.P, AP);
+    multiply(fine.R, AP, coarse_A);
+
+    levels_.push_back(Level());
+    levels_.back().A.swap(coarse_A);
+    inverse_diagonal(levels_.back().A, levels_.back().inverse_diagonal);
+    level_points.swap(coarse_points);
+    cell_size *= 2;
+  }
+
+  for (size_t l = 0; l < levels_.size(); ++l)
+  {
+    Level& level = levels_[l];
+    const int n = (int)level.A.rows();
+    level.x.setZero(n);
+    level.b.setZero(n);
+    level.r.setZero(n);
+
+    statistics_.level_sizes.push_back(n);
+    statistics_.level_nonzeros.push_back((int)level.A.nonZeros());
+  }
+
+  Eigen::SparseMatrix<double> coarsest = levels_.back().A.cast<double>();
+  coarsest_.compute(coarsest);
+  if (coarsest_.info() != Eigen::Success)
+  {
+    std::cerr << "MultigridSolver: factorization of the coarsest level failed" << std::endl;
+    return false;
+  }
+
+  statistics_.setup_time = seconds_since(start);
+  ready_ = true;
+  return true;
+}
+
+int MultigridSolver::aggregate(const std::vector<Vec3>& points, Scalar cell_size,
+                               std::vector<int>& cluster, std::vector<Vec3>& coarse_points)
+{
+  const size_t n = points.size();
+
+  Vec3 origin = points.empty() ? Vec3(0, 0, 0) : points[0];
+  for (size_t i = 1; i < n; ++i)
+  {
+    origin = origin.cwiseMin(points[i]);
+  }
+
+  // 21 bits per cell coordinate
+  std::vector<uint64_t> keys(n);
+  parallel_for(0, n, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Vec3 c = (points[i] - origin) / cell_size;
+      uint64_t x = std::min<uint64_t>((uint64_t)c[0], 0x1fffff);
+      uint64_t y = std::min<uint64_t>((uint64_t)c[1], 0x1fffff);
+      uint64_t z = std::min<uint64_t>((uint64_t)c[2], 0x1fffff);
+      keys[i] = (x << 42) | (y << 21) | z;
+    }
+  });
+
+  std::unordered_map<uint64_t, int> cells;
+  cells.reserve(n / 2 + 1);
+  cluster.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    std::pair<std::unordered_map<uint64_t, int>::iterator, bool> it = cells.insert(std::make_pair(keys[i], (int)cells.size()));
+    cluster[i] = it.first->second;
+  }
+  const int n_coarse = (int)cells.size();
+
+  // cluster centroids
+  std::vector<int> count(n_coarse, 0);
+  coarse_points.assign(n_coarse, Vec3(0, 0, 0));
+  for (size_t i = 0; i < n; ++i)
+  {
+    coarse_points[cluster[i]] += points[i];
+    ++count[cluster[i]];
+  }
+  for (int c = 0; c < n_coarse; ++c)
+  {
+    coarse_points[c] /= Scalar(count[c]);
+  }
+
+  return n_coarse;
+}
+
+void MultigridSolver::prolongation(Level& level, const std::vector<int>& cluster, int n_coarse)
+{
+  const int n = (int)level.A.rows();
+
+  // piecewise constant interpolation T: one entry per row
+  Matrix_type T(n, n_coarse);
+  T.resizeNonZeros(n);
+  for (int i = 0; i < n; ++i)
+  {
+    T.outerIndexPtr()[i] = i;
+    T.innerIndexPtr()[i] = cluster[i];
+    T.valuePtr()[i] = Scalar(1);
+  }
+  T.outerIndexPtr()[n] = n;
+
+  if (!settings_.smooth_prolongation)
+  {
+    level.P.swap(T);
+  }
+  else
+  {
+    // estimate the spectral radius of D^-1 A by power iteration
+    Dense_vector v(n), w;
+    for (int i = 0; i < n; ++i)
+    {
+      v[i] = Scalar(1) + Scalar(0.5) * std::sin(Scalar(i));
+    }
+    Scalar rho = 1;
+    for (int it = 0; it < 10; ++it)
+    {
+      multiply(level.A, v, w);
+      w = level.inverse_diagonal.cwiseProduct(w);
+      rho = w.norm() / v.norm();
+      v = w / w.norm();
+    }
+
+    // P = (I - omega D^-1 A) T, the pattern is the one of A T
+    const Scalar omega = Scalar(4) / (Scalar(3) * rho);
+    multiply(level.A, T, level.P);
+    Matrix_type& P = level.P;
+    parallel_for(0, n, 4096, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        const Scalar s = -omega * level.inverse_diagonal[i];
+        for (Matrix_type::InnerIterator it(P, (int)i); it; ++it)
+        {
+          it.valueRef() = s * it.value() + (it.col() == cluster[i] ? Scalar(1) : Scalar(0));
+        }
+      }
+    });
+  }
+
+  level.R = level.P.transpose();
+}
+
+void MultigridSolver::multiply(const Matrix_type& X, const Matrix_type& Y, Matrix_type& C)
+{
+  const int n = (int)X.rows();
+  const int m = (int)Y.cols();
+
+  Product_scratch prototype;
+  prototype.position.assign(m, -1);
+  Thread_local_storage<Product_scratch> scratch(prototype);
+
+  // collect the entries of row i of C into s.entries, sorted by column
+  auto gather_row = [&](Product_scratch& s, int i)
+  {
+    s.entries.clear();
+    for (Matrix_type::InnerIterator xt(X, i); xt; ++xt)
+    {
+      for (Matrix_type::InnerIterator yt(Y, xt.col()); yt; ++yt)
+      {
+        const int j = yt.col();
+        const Scalar value = xt.value() * yt.value();
+        if (s.position[j] < 0)
+        {
+          s.position[j] = (int)s.entries.size();
+          s.entries.push_back(std::make_pair(j, value));
+        }
+        else
+        {
+          s.entries[s.position[j]].second += value;
+        }
+      }
+    }
+    for (size_t e = 0; e < s.entries.size(); ++e)
+    {
+      s.position[s.entries[e].first] = -1;
+    }
+    std::sort(s.entries.begin(), s.entries.end());
+  };
+
+  // first pass counts the entries of every row, the second one writes them
+  std::vector<int> offsets(n + 1, 0);
+  parallel_for(0, n, 256, [&](size_t first, size_t last)
+  {
+    Product_scratch& s = scratch.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      gather_row(s, (int)i);
+      offsets[i + 1] = (int)s.entries.size();
+    }
+  });
+  for (int i = 0; i < n; ++i)
+  {
+    offsets[i + 1] += offsets[i];
+  }
+
+  C.resize(n, m);
+  C.resizeNonZeros(offsets[n]);
+  std::copy(offsets.begin(), offsets.end(), C.outerIndexPtr());
+  int*    inner = C.innerIndexPtr();
+  Scalar* value = C.valuePtr();
+
+  parallel_for(0, n, 256, [&](size_t first, size_t last)
+  {
+    Product_scratch& s = scratch.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      gather_row(s, (int)i);
+      int k = offsets[i];
+      for (size_t e = 0; e < s.entries.size(); ++e, ++k)
+      {
+        inner[k] = s.entries[e].first;
+        value[k] = s.entries[e].second;
+      }
+    }
+  });
+}
+
+void MultigridSolver::multiply(const Matrix_type& A, const Dense_vector& x, Dense_vector& y)
+{
+  y.resize(A.rows());
+  parallel_for(0, A.rows(), 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Scalar sum = 0;
+      for (Matrix_type::InnerIterator it(A, (int)i); it; ++it)
+      {
+        sum += it.value() * x[it.col()];
+      }
+      y[i] = sum;
+    }
+  });
+}
+
+void MultigridSolver::jacobi(Level& level, int sweeps)
+{
+  const Scalar w = settings_.jacobi_weight;
+  for (int s = 0; s < sweeps; ++s)
+  {
+    multiply(level.A, level.x, level.r);
+    parallel_for(0, level.A.rows(), 4096, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        level.x[i] += w * level.inverse_diagonal[i] * (level.b[i] - level.r[i]);
+      }
+    });
+  }
+}
+
+void MultigridSolver::v_cycle(size_t l)
+{
+  Level& level = levels_[l];
+  if (l + 1 == levels_.size())
+  {
+    level.x = coarsest_.solve(level.b.cast<double>()).cast<Scalar>();
+    return;
+  }
+
+  level.x.setZero();
+  jacobi(level, settings_.pre_smoothing);
+
+  // restrict the residual, solve for the coarse correction and prolongate it
+  multiply(level.A, level.x, level.r);
+  level.r = level.b - level.r;
+  Level& coarse = levels_[l + 1];
+  multiply(level.R, level.r, coarse.b);
+
+  v_cycle(l + 1);
+
+  multiply(level.P, coarse.x, level.r);
+  level.x += level.r;
+
+  jacobi(level, settings_.post_smoothing);
+}
+
+bool MultigridSolver::solve(const Dense_vector& b, Dense_vector& x)
+{
+  if (!ready_)
+  {
+    std::cerr << "MultigridSolver: setup() has not succeeded" << std::endl;
+    return false;
+  }
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Level& finest = levels_[0];
+  const int n = (int)finest.A.rows();
+  if (x.size() != n)
+  {
+    x.setZero(n);
+  }
+
+  statistics_.iterations = 0;
+  statistics_.residual_history.clear();
+
+  const Scalar b_norm = b.norm();
+  if (b_norm == Scalar(0))
+  {
+    x.setZero();
+    statistics_.residual = 0;
+    statistics_.solve_time = seconds_since(start);
+    return true;
+  }
+
+  Dense_vector r, ax;
+  multiply(finest.A, x, ax);
+  r = b - ax;
+  Scalar residual = r.norm() / b_norm;
+
+  // V-cycle as approximate inverse of A: z = B r
+  auto precondition = [&](const Dense_vector& rhs, Dense_vector& z)
+  {
+    finest.b = rhs;
+    v_cycle(0);
+    z = finest.x;
+  };
+
+  if (settings_.use_cg)
+  {
+    // the updated residual r -= alpha q drifts away from b - A x in single
+    // precision, so convergence is confirmed with the true residual and the
+    // iteration restarts from it if that is still too large
+    Dense_vector z, p, q;
+    precondition(r, z);
+    p = z;
+    Scalar rz = r.dot(z);
+    for (int it = 0; it < settings_.max_iterations && residual > settings_.tolerance; ++it)
+    {
+      multiply(finest.A, p, q);
+      const Scalar alpha = rz / p.dot(q);
+      x += alpha * p;
+      r -= alpha * q;
+      residual = r.norm() / b_norm;
+      ++statistics_.iterations;
+      if (residual <= settings_.tolerance || it + 1 == settings_.max_iterations)
+      {
+        multiply(finest.A, x, ax);
+        r = b - ax;
+        residual = r.norm() / b_norm;
+        statistics_.residual_history.push_back(residual);
+        if (residual <= settings_.tolerance)
+        {
+          break;
+        }
+        precondition(r, z);
+        p = z;
+        rz = r.dot(z);
+        continue;
+      }
+      statistics_.residual_history.push_back(residual);
+      precondition(r, z);
+      const Scalar rz_new = r.dot(z);
+      p = z + (rz_new / rz) * p;
+      rz = rz_new;
+    }
+  }
+  else
+  {
+    Dense_vector z;
+    for (int it = 0; it < settings_.max_iterations && residual > settings_.tolerance; ++it)
+    {
+      precondition(r, z);
+      x += z;
+      multiply(finest.A, x, ax);
+      r = b - ax;
+      residual = r.norm() / b_norm;
+      statistics_.residual_history.push_back(residual);
+      ++statistics_.iterations;
+    }
+  }
+
+  statistics_.residual = residual;
+  statistics_.solve_time = seconds_since(start);
+  return residual <= settings_.tolerance;
+}
+
+}
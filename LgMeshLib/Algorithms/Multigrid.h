@@ -0,0 +1,112 @@
+#ifndef LGMESH_MULTIGRID_H
+#define LGMESH_MULTIGRID_H
+
+#include "Laplacian.h"
+
+#include "Eigen/SparseCholesky"
+
+#include <vector>
+
+namespace LG {
+
+// Convergence and timing of the last MultigridSolver setup and solve
+struct Multigrid_statistics
+{
+  Multigrid_statistics() : setup_time(0), solve_time(0), iterations(0), residual(0) {};
+
+  std::vector<int>     level_sizes;       // unknowns per level, finest first
+  std::vector<int>     level_nonzeros;    // matrix entries per level
+  double               setup_time;        // seconds
+  double               solve_time;        // seconds
+  int                  iterations;        // outer iterations of the last solve
+  Scalar               residual;          // relative residual reached
+  std::vector<Scalar>  residual_history;  // relative residual after every iteration
+};
+
+
+// Geometric multigrid for symmetric positive definite systems on meshes,
+// e.g.  A = mass_coeff * M - laplace_coeff * L  with mass_coeff > 0.
+//
+// The hierarchy clusters vertices into grid cells whose size doubles from
+// level to level and the clusters become the coarse unknowns. Prolongation
+// is the piecewise constant interpolation of the clusters, smoothed by one
+// damped Jacobi step (smoothed aggregation), and coarse operators are the
+// Galerkin products P^T A P. V-cycles smooth with parallel weighted Jacobi
+// sweeps and solve the coarsest level directly. By default the V-cycle preconditions
+// conjugate gradients, which keeps the iteration count low and bounded.
+class MultigridSolver
+{
+public:
+  typedef Eigen::SparseMatrix<Scalar, Eigen::RowMajor> Matrix_type;
+
+  struct Settings
+  {
+    Settings() : coarsest_size(2000), pre_smoothing(2), post_smoothing(2), jacobi_weight(Scalar(2) / 3),
+      max_iterations(200), tolerance(Scalar(1e-6)), use_cg(true), smooth_prolongation(true) {};
+
+    int     coarsest_size;   // stop coarsening below this many unknowns
+    int     pre_smoothing;   // Jacobi sweeps before the coarse correction
+    int     post_smoothing;  // Jacobi sweeps after the coarse correction
+    Scalar  jacobi_weight;
+    int     max_iterations;
+    Scalar  tolerance;       // relative residual
+    bool    use_cg;          // V-cycle preconditioned CG instead of plain V-cycles
+    bool    smooth_prolongation;  // smoothed instead of piecewise constant prolongation
+  };
+
+public:
+  MultigridSolver() : ready_(false) {};
+
+  Settings& settings() { return settings_; };
+  const Multigrid_statistics& statistics() const { return statistics_; };
+
+  // Build the hierarchy for  mass_coeff * M - laplace_coeff * L  of mesh
+  bool setup(const PolygonMesh& mesh, Laplacian_weighting weighting, Scalar mass_coeff, Scalar laplace_coeff);
+
+  // Build the hierarchy for any symmetric positive definite matrix whose
+  // unknowns live at the given points (one point per row)
+  bool setup(const Sparse_matrix& A, const std::vector<Vec3>& points);
+
+  // Solve A x = b, x holds the initial guess. Returns whether the tolerance was reached.
+  bool solve(const Dense_vector& b, Dense_vector& x);
+
+  int n_levels() const { return (int)levels_.size(); };
+
+private:
+  struct Level
+  {
+    Matrix_type        A;
+    Matrix_type        P;                  // prolongation from the next coarser level
+    Matrix_type        R;                  // restriction P^T
+    Dense_vector       inverse_diagonal;
+    Dense_vector       x, b, r;            // work vectors of the cycle
+  };
+
+  // cluster points into cells, returns the number of clusters
+  static int aggregate(const std::vector<Vec3>& points, Scalar cell_size,
+                       std::vector<int>& cluster, std::vector<Vec3>& coarse_points);
+
+  // prolongation of level l to the clusters
+  void prolongation(Level& level, const std::vector<int>& cluster, int n_coarse);
+
+  // C = X Y, rows in parallel
+  static void multiply(const Matrix_type& X, const Matrix_type& Y, Matrix_type& C);
+
+  void v_cycle(size_t l);
+
+  void jacobi(Level& level, int sweeps);
+
+  static void multiply(const Matrix_type& A, const Dense_vector& x, Dense_vector& y);
+
+private:
+  Settings              settings_;
+  Multigrid_statistics  statistics_;
+  std::vector<Level>    levels_;
+  bool                  ready_;
+
+  Eigen::SimplicialLDLT< Eigen::SparseMatrix<double> > coarsest_;
+};
+
+}
+
+#endif // !LGMESH_MULTIGRID_H
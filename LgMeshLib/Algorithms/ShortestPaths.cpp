@@ -0,0 +1,293 @@
+#include "ShortestPaths.h"
+
+#include <cmath>
+
+namespace LG {
+
+ShortestPaths::ShortestPaths(const PolygonMesh& mesh, Method method)
+  : mesh_(&mesh), topology_generation_(0), geometry_generation_(0), method_(method),
+    radius_(std::numeric_limits<Scalar>::infinity()), run_(0)
+{
+  update();
+}
+
+ShortestPaths::ShortestPaths(const ShortestPaths& rhs)
+  : mesh_(rhs.mesh_), edge_lengths_(rhs.edge_lengths_), topology_generation_(rhs.topology_generation_),
+    geometry_generation_(rhs.geometry_generation_), method_(rhs.method_), radius_(rhs.radius_),
+    targets_(rhs.targets_), run_(0)
+{
+}
+
+void ShortestPaths::update()
+{
+  const PolygonMesh& mesh = *mesh_;
+  if (edge_lengths_ && topology_generation_ == mesh.topology_generation() &&
+      geometry_generation_ == mesh.geometry_generation())
+  {
+    return;
+  }
+
+  // a new array, copies of this object keep sharing the old one
+  std::shared_ptr< std::vector<Scalar> > lengths(new std::vector<Scalar>(mesh.edges_size()));
+  std::vector<Scalar>& l = *lengths;
+  parallel_for(0, mesh.edges_size(), 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      PolygonMesh::Edge e((int)i);
+      l[i] = mesh.is_deleted(e) ? Scalar(0) : mesh.edge_length(e);
+    }
+  });
+  edge_lengths_ = lengths;
+
+  topology_generation_ = mesh.topology_generation();
+  geometry_generation_ = mesh.geometry_generation();
+}
+
+void ShortestPaths::next_run()
+{
+  update();
+
+  const size_t nv = mesh_->vertices_size();
+  if (nodes_.size() != nv)
+  {
+    // first run, or the mesh grew: the only O(n) work, done once
+    Node empty;
+    empty.distance = std::numeric_limits<Scalar>::infinity();
+    empty.predecessor = -1;
+    empty.heap_position = UNSEEN;
+    empty.run = 0;
+    empty.target_run = 0;
+    nodes_.assign(nv, empty);
+    run_ = 0;
+  }
+
+  if (++run_ == 0)
+  {
+    // the run counter wrapped around, old tags could match again
+    for (size_t i = 0; i < nodes_.size(); ++i)
+    {
+      nodes_[i].run = 0;
+      nodes_[i].target_run = 0;
+    }
+    run_ = 1;
+  }
+
+  heap_.clear();
+  settled_.clear();
+}
+
+size_t ShortestPaths::run(const std::vector<Vertex>& sources)
+{
+  next_run();
+
+  const PolygonMesh& mesh = *mesh_;
+  const std::vector<Scalar>& lengths = *edge_lengths_;
+
+  size_t remaining_targets = 0;
+  for (size_t i = 0; i < targets_.size(); ++i)
+  {
+    Node& n = nodes_[targets_[i].idx()];
+    if (n.target_run != run_)
+    {
+      n.target_run = run_;
+      ++remaining_targets;
+    }
+  }
+  const bool has_targets = remaining_targets > 0;
+
+  for (size_t i = 0; i < sources.size(); ++i)
+  {
+    relax(sources[i].idx(), Scalar(0), -1);
+  }
+
+  while (!heap_.empty())
+  {
+    const int v = heap_pop();
+    Node& nv = nodes_[v];
+    if (nv.distance > radius_)
+    {
+      // leave it tentative, everything else in the heap is farther
+      nv.heap_position = UNSEEN;
+      break;
+    }
+    nv.heap_position = SETTLED;
+    settled_.push_back(Vertex(v));
+
+    if (has_targets && nv.target_run == run_ && --remaining_targets == 0)
+    {
+      break;
+    }
+
+    const Scalar dv = nv.distance;
+    PolygonMesh::Halfedge_around_vertex_circulator hc = mesh.halfedges(Vertex(v)), hc_end = hc;
+    if (!hc)
+    {
+      continue;
+    }
+    do
+    {
+      const PolygonMesh::Halfedge h = *hc;
+      const int w = mesh.to_vertex(h).idx();
+      const bool w_settled = node(w).heap_position == SETTLED;
+      if (!w_settled)
+      {
+        relax(w, dv + lengths[mesh.edge(h).idx()], v);
+      }
+
+      if (method_ == FAST_MARCHING && !mesh.is_boundary(h) && mesh.next_halfedge(mesh.next_halfedge(mesh.next_halfedge(h))) == h)
+      {
+        // triangle (v, w, u): update the unsettled one of w and u from the other two
+        const int u = mesh.to_vertex(mesh.next_halfedge(h)).idx();
+        const bool u_settled = node(u).heap_position == SETTLED;
+        if (!w_settled && u_settled)
+        {
+          relax(w, triangle_update(w, v, u), v);
+        }
+        else if (w_settled && !u_settled)
+        {
+          relax(u, triangle_update(u, v, w), v);
+        }
+      }
+    } while (++hc != hc_end);
+  }
+
+  return settled_.size();
+}
+
+void ShortestPaths::relax(int v, Scalar d, int predecessor)
+{
+  Node& n = node(v);
+  if (n.heap_position == SETTLED || !(d < n.distance))
+  {
+    return;
+  }
+  n.distance = d;
+  n.predecessor = predecessor;
+  if (n.heap_position == UNSEEN)
+  {
+    heap_push(v);
+  }
+  else
+  {
+    sift_up(n.heap_position);
+  }
+}
+
+Scalar ShortestPaths::triangle_update(int c, int a, int b) const
+{
+  const std::vector<Vec3>& points = mesh_->points();
+  const Scalar da = nodes_[a].distance, db = nodes_[b].distance;
+
+  // unfold into the plane: a = (0, 0), b = (l, 0), c above the x axis and
+  // the virtual source s, at distance da from a and db from b, below it
+  const Vec3 ab = points[b] - points[a];
+  const Scalar l = ab.norm();
+  const Scalar ca = (points[c] - points[a]).norm();
+  const Scalar cb = (points[c] - points[b]).norm();
+  const Scalar edge_update = std::min(da + ca, db + cb);
+  if (l <= Scalar(0))
+  {
+    return edge_update;
+  }
+
+  const Scalar cx = (ca * ca - cb * cb + l * l) / (2 * l);
+  const Scalar cy = std::sqrt(std::max(ca * ca - cx * cx, Scalar(0)));
+  const Scalar sx = (da * da - db * db + l * l) / (2 * l);
+  const Scalar sy2 = da * da - sx * sx;
+  if (sy2 < Scalar(0))
+  {
+    return edge_update;
+  }
+  const Scalar sy = -std::sqrt(sy2);
+
+  // the ray from s to c has to cross the edge ab inside the triangle
+  const Scalar t = -sy / (cy - sy);
+  const Scalar x = sx + t * (cx - sx);
+  if (x < Scalar(0) || x > l)
+  {
+    return edge_update;
+  }
+
+  const Scalar dx = cx - sx, dy = cy - sy;
+  return std::min(edge_update, std::sqrt(dx * dx + dy * dy));
+}
+
+void ShortestPaths::heap_push(int v)
+{
+  heap_.push_back(v);
+  nodes_[v].heap_position = (int)heap_.size() - 1;
+  sift_up((int)heap_.size() - 1);
+}
+
+int ShortestPaths::heap_pop()
+{
+  const int top = heap_[0];
+  const int last = heap_.back();
+  heap_.pop_back();
+  if (!heap_.empty())
+  {
+    heap_[0] = last;
+    nodes_[last].heap_position = 0;
+    sift_down(0);
+  }
+  return top;
+}
+
+void ShortestPaths::sift_up(int position)
+{
+  const int v = heap_[position];
+  const Scalar d = nodes_[v].distance;
+  while (position > 0)
+  {
+    const int parent = (position - 1) / 4;
+    const int p = heap_[parent];
+    if (!(d < nodes_[p].distance))
+    {
+      break;
+    }
+    heap_[position] = p;
+    nodes_[p].heap_position = position;
+    position = parent;
+  }
+  heap_[position] = v;
+  nodes_[v].heap_position = position;
+}
+
+void ShortestPaths::sift_down(int position)
+{
+  const int n = (int)heap_.size();
+  const int v = heap_[position];
+  const Scalar d = nodes_[v].distance;
+  for (;;)
+  {
+    const int first_child = 4 * position + 1;
+    if (first_child >= n)
+    {
+      break;
+    }
+    int best = first_child;
+    Scalar best_distance = nodes_[heap_[first_child]].distance;
+    const int last_child = std::min(first_child + 4, n);
+    for (int child = first_child + 1; child < last_child; ++child)
+    {
+      const Scalar dc = nodes_[heap_[child]].distance;
+      if (dc < best_distance)
+      {
+        best = child;
+        best_distance = dc;
+      }
+    }
+    if (!(best_distance < d))
+    {
+      break;
+    }
+    heap_[position] = heap_[best];
+    nodes_[heap_[position]].heap_position = position;
+    position = best;
+  }
+  heap_[position] = v;
+  nodes_[v].heap_position = position;
+}
+
+}
@@ -0,0 +1,182 @@
+#ifndef LGMESH_SHORTESTPATHS_H
+#define LGMESH_SHORTESTPATHS_H
+
+#include "PolygonMesh.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace LG {
+
+// Single-source / multi-source shortest paths on a mesh:
+//
+//   DIJKSTRA       graph distances along the edges (PolygonMesh::edge_length)
+//   FAST_MARCHING  approximate geodesic distances, triangles are crossed
+//                  with the planar update of Kimmel and Sethian
+//
+// All per-vertex buffers are allocated once and tagged with the number of
+// the run that wrote them, so a run only touches the vertices it reaches:
+// no allocation and no clearing per query. A run stops early once the
+// radius is exceeded or all targets are settled.
+//
+// The edge lengths are cached and recomputed by the next run after the
+// topology or geometry generation of the mesh changed.
+//
+// An object is not thread-safe; run_parallel() gives every thread its own
+// copy of the buffers while the edge lengths are shared.
+class ShortestPaths
+{
+public:
+  typedef PolygonMesh::Vertex Vertex;
+
+  enum Method { DIJKSTRA, FAST_MARCHING };
+
+  explicit ShortestPaths(const PolygonMesh& mesh, Method method = DIJKSTRA);
+
+  // copies settings and shares the edge lengths, the buffers start empty
+  ShortestPaths(const ShortestPaths& rhs);
+
+  void set_method(Method method) { method_ = method; };
+  Method method() const { return method_; };
+
+  // stop settling vertices farther than radius (default: no limit)
+  void set_radius(Scalar radius) { radius_ = radius; };
+  Scalar radius() const { return radius_; };
+
+  // stop as soon as all targets are settled (empty: no targets)
+  void set_targets(const std::vector<Vertex>& targets) { targets_ = targets; };
+  const std::vector<Vertex>& targets() const { return targets_; };
+
+  // Run from the sources (all at distance 0), returns the number of settled vertices
+  size_t run(const std::vector<Vertex>& sources);
+
+  // Results of the last run. Vertices that were not settled report the
+  // tentative distance or infinity.
+  Scalar distance(Vertex v) const
+  {
+    const Node* n = result(v);
+    return n ? n->distance : std::numeric_limits<Scalar>::infinity();
+  }
+
+  bool is_settled(Vertex v) const
+  {
+    const Node* n = result(v);
+    return n && n->heap_position == SETTLED;
+  }
+
+  // vertex the shortest path to v comes from (Dijkstra; for fast marching
+  // the closest contributing vertex), invalid for sources
+  Vertex predecessor(Vertex v) const
+  {
+    const Node* n = result(v);
+    return Vertex(n ? n->predecessor : -1);
+  }
+
+  // settled vertices in order of increasing distance
+  const std::vector<Vertex>& settled() const { return settled_; };
+
+  // Run every source set in parallel and call fn(i, result) for set i from
+  // the thread that computed it; result is only valid during the call
+  template <class Function>
+  void run_parallel(const std::vector< std::vector<Vertex> >& source_sets, const Function& fn) const;
+
+private:
+  static const int SETTLED = -2;
+  static const int UNSEEN  = -1;
+
+  struct Node
+  {
+    Scalar        distance;
+    int           predecessor;
+    int           heap_position;  // UNSEEN, SETTLED or index in heap_
+    unsigned int  run;            // run that wrote this node
+    unsigned int  target_run;     // run in which the vertex is a target
+  };
+
+  // node of v if the last run reached it
+  const Node* result(Vertex v) const
+  {
+    const size_t i = v.idx();
+    return (i < nodes_.size() && nodes_[i].run == run_ && run_ != 0) ? &nodes_[i] : NULL;
+  }
+
+  // recompute the edge lengths if the mesh changed since they were computed
+  void update();
+
+  // start a new run, buffers of older runs become invalid
+  void next_run();
+
+  Node& node(int v)
+  {
+    Node& n = nodes_[v];
+    if (n.run != run_)
+    {
+      n.distance      = std::numeric_limits<Scalar>::infinity();
+      n.predecessor   = -1;
+      n.heap_position = UNSEEN;
+      n.run           = run_;
+    }
+    return n;
+  }
+
+  // lower the tentative distance of v
+  void relax(int v, Scalar d, int predecessor);
+
+  // planar triangle update of c from the settled vertices a and b
+  Scalar triangle_update(int c, int a, int b) const;
+
+  // 4-ary min-heap on the tentative distances
+  void heap_push(int v);
+  int  heap_pop();
+  void sift_up(int position);
+  void sift_down(int position);
+
+private:
+  ShortestPaths& operator=(const ShortestPaths&);
+
+private:
+  const PolygonMesh*                          mesh_;
+  std::shared_ptr< const std::vector<Scalar> > edge_lengths_;
+  unsigned long                               topology_generation_;
+  unsigned long                               geometry_generation_;
+  Method                                      method_;
+  Scalar                                      radius_;
+  std::vector<Vertex>                         targets_;
+
+  unsigned int                                run_;
+  std::vector<Node>                           nodes_;
+  std::vector<int>                            heap_;
+  std::vector<Vertex>                         settled_;
+};
+
+}
+
+#include "ThreadPool.h"
+#include "Parallel.h"
+
+namespace LG {
+
+template <class Function>
+void ShortestPaths::run_parallel(const std::vector< std::vector<Vertex> >& source_sets, const Function& fn) const
+{
+  // every thread clones the settings and shares the edge lengths, its
+  // buffers are allocated on first use and reused for all its runs. The
+  // lengths are brought up to date once, not by every thread.
+  ShortestPaths prototype(*this);
+  prototype.update();
+  Thread_local_storage<ShortestPaths> workspaces(prototype);
+  parallel_for(0, source_sets.size(), 1, [&](size_t first, size_t last)
+  {
+    ShortestPaths& paths = workspaces.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      paths.run(source_sets[i]);
+      fn(i, static_cast<const ShortestPaths&>(paths));
+    }
+  });
+}
+
+}
+
+#endif // !LGMESH_SHORTESTPATHS_H
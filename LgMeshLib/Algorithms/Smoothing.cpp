@@ -0,0 +1,86 @@
+#include "Smoothing.h"
+#include "AttributeMatrix.h"
+
+namespace LG {
+
+bool implicit_smoothing(PolygonMesh& mesh, Scalar timestep, unsigned int iterations, Laplacian_weighting weighting)
+{
+  // one row per vertex
+  Dense_matrix x = points_matrix(static_cast<const PolygonMesh&>(mesh)).transpose();
+  if (!diffuse(mesh, x, timestep, iterations, weighting))
+  {
+    return false;
+  }
+
+  // write back once, the positions of deleted vertices are left alone
+  PolygonMesh::Vertex_iterator vit, vend = mesh.vertices_end();
+  for (vit = mesh.vertices_begin(); vit != vend; ++vit)
+  {
+    mesh.set_position(*vit, x.row((*vit).idx()).transpose());
+  }
+  return true;
+}
+
+bool implicit_smoothing_cg(PolygonMesh& mesh, Scalar timestep, unsigned int iterations,
+                           int max_cg_iterations, Scalar tolerance)
+{
+  LaplacianOperator A(mesh, Scalar(1), timestep);
+  const Dense_vector& m = A.mass();
+
+  Attribute_matrix<Vec3>::Const_map p = points_matrix(static_cast<const PolygonMesh&>(mesh));
+  Dense_matrix x = p.transpose();
+
+  bool converged = true;
+  for (unsigned int i = 0; i < iterations; ++i)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      Dense_vector rhs = m.cwiseProduct(x.col(c));
+      Dense_vector xc = x.col(c);
+      converged &= solve_cg(A, rhs, xc, max_cg_iterations, tolerance);
+      x.col(c) = xc;
+    }
+  }
+
+  PolygonMesh::Vertex_iterator vit, vend = mesh.vertices_end();
+  for (vit = mesh.vertices_begin(); vit != vend; ++vit)
+  {
+    mesh.set_position(*vit, x.row((*vit).idx()).transpose());
+  }
+  return converged;
+}
+
+bool diffuse(PolygonMesh& mesh, Dense_matrix& values, Scalar timestep, unsigned int steps, Laplacian_weighting weighting)
+{
+  LaplacianSolverCache& cache = laplacian_solver_cache(mesh);
+  const LaplacianSolver* solver = cache.solver(mesh, weighting, Scalar(1), timestep);
+  if (!solver)
+  {
+    return false;
+  }
+
+  const Dense_vector m = cache.mass(mesh).diagonal();
+  for (unsigned int i = 0; i < steps; ++i)
+  {
+    Dense_matrix rhs = m.asDiagonal() * values;
+    if (!solver->solve(rhs, values))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool diffuse(PolygonMesh& mesh, PolygonMesh::Vertex_attribute<Scalar> values, Scalar timestep,
+             unsigned int steps, Laplacian_weighting weighting)
+{
+  Dense_matrix u = attribute_matrix(values).transpose();
+  if (!diffuse(mesh, u, timestep, steps, weighting))
+  {
+    return false;
+  }
+  attribute_matrix(values) = u.transpose();
+  return true;
+}
+
+}
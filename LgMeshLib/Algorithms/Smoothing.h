@@ -0,0 +1,38 @@
+#ifndef LGMESH_SMOOTHING_H
+#define LGMESH_SMOOTHING_H
+
+#include "LaplacianSolver.h"
+#include "LaplacianOperator.h"
+
+namespace LG {
+
+// Implicit Laplacian smoothing: `iterations` backward Euler steps
+//
+//   (M - timestep L) x' = M x
+//
+// of the vertex positions. All steps use the operator of the input mesh, so
+// they share one factorization from the mesh's LaplacianSolverCache and only
+// cost a back-substitution each.
+bool implicit_smoothing(PolygonMesh& mesh, Scalar timestep, unsigned int iterations = 1,
+                        Laplacian_weighting weighting = COTAN_LAPLACIAN);
+
+// Implicit cotan smoothing for meshes too large for a direct factorization:
+// the same backward Euler steps, every coordinate solved with the
+// matrix-free LaplacianOperator and preconditioned CG, warm started from
+// the current positions.
+bool implicit_smoothing_cg(PolygonMesh& mesh, Scalar timestep, unsigned int iterations = 1,
+                           int max_cg_iterations = 1000, Scalar tolerance = Scalar(1e-6));
+
+// Diffuse per-vertex values (one column per signal) by backward Euler steps
+//
+//   (M - timestep L) u' = M u
+bool diffuse(PolygonMesh& mesh, Dense_matrix& values, Scalar timestep, unsigned int steps = 1,
+             Laplacian_weighting weighting = COTAN_LAPLACIAN);
+
+// Diffuse a scalar vertex attribute
+bool diffuse(PolygonMesh& mesh, PolygonMesh::Vertex_attribute<Scalar> values, Scalar timestep,
+             unsigned int steps = 1, Laplacian_weighting weighting = COTAN_LAPLACIAN);
+
+}
+
+#endif // !LGMESH_SMOOTHING_H
@@ -0,0 +1,1214 @@
+#include "BVH.h"
+#include "ClosestPoint.h"
+#include "FrozenConnectivity.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace LG {
+
+namespace {
+
+// binary subtrees below this size are built serially
+const int PARALLEL_SUBTREE_SIZE = 4096;
+
+// ranges above this size are binned in parallel
+const int PARALLEL_BINNING_SIZE = 65536;
+
+// deeper ranges are split at the object median, which bounds the depth of
+// the tree and thus the traversal stacks below
+const int MAX_SAH_DEPTH = 96;
+
+const int STACK_SIZE = 512;
+
+const int MAX_BINS = 32;
+
+}
+
+
+//== BUILD ======================================================================
+
+
+struct BVH::Build_ref
+{
+  BoundingBox box;
+  Vec3        centroid;
+  int         triangle;
+};
+
+struct BVH::Build_node
+{
+  BoundingBox box;
+  int         left;
+  int         right;
+  int         first;
+  int         count;  // > 0 for leaves
+};
+
+// top-down binned SAH build of the binary tree, subtrees are built as tasks
+class BVH::Builder
+{
+public:
+  Builder(const Settings& settings, std::vector<Build_ref>& refs, std::vector<Build_node>& nodes)
+    : settings_(settings), refs_(refs), nodes_(nodes), next_node_(1)
+  {
+    settings_.n_bins = std::max(2, std::min(settings_.n_bins, MAX_BINS));
+    settings_.max_leaf_size = std::max(1, settings_.max_leaf_size);
+  }
+
+  void build()
+  {
+    TaskGroup group;
+    build(0, 0, (int)refs_.size(), 0, group);
+    group.wait();
+  }
+
+  int n_nodes() const { return next_node_; };
+
+private:
+  struct Bounds
+  {
+    BoundingBox box;
+    BoundingBox centroids;
+  };
+
+  struct Bins
+  {
+    BoundingBox box[3][MAX_BINS];
+    int         count[3][MAX_BINS];
+
+    Bins() { std::fill(&count[0][0], &count[0][0] + 3 * MAX_BINS, 0); };
+  };
+
+  Bounds compute_bounds(int begin, int end) const
+  {
+    const std::vector<Build_ref>& refs = refs_;
+    auto fn = [&](size_t first, size_t last, Bounds b)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        b.box.extend(refs[i].box);
+        b.centroids.extend(refs[i].centroid);
+      }
+      return b;
+    };
+    if (end - begin < PARALLEL_BINNING_SIZE)
+    {
+      return fn(begin, end, Bounds());
+    }
+    return parallel_reduce(begin, end, PARALLEL_BINNING_SIZE / 4, Bounds(), fn,
+      [](Bounds a, const Bounds& b) { a.box.extend(b.box); a.centroids.extend(b.centroids); return a; });
+  }
+
+  Bins compute_bins(int begin, int end, const Vec3& origin, const Vec3& scale) const
+  {
+    const std::vector<Build_ref>& refs = refs_;
+    const int n_bins = settings_.n_bins;
+    auto fn = [&](size_t first, size_t last, Bins bins)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+          const int b = bin(refs[i].centroid[axis], origin[axis], scale[axis], n_bins);
+          bins.box[axis][b].extend(refs[i].box);
+          ++bins.count[axis][b];
+        }
+      }
+      return bins;
+    };
+    if (end - begin < PARALLEL_BINNING_SIZE)
+    {
+      return fn(begin, end, Bins());
+    }
+    return parallel_reduce(begin, end, PARALLEL_BINNING_SIZE / 4, Bins(), fn, [n_bins](Bins a, const Bins& b)
+    {
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        for (int i = 0; i < n_bins; ++i)
+        {
+          a.box[axis][i].extend(b.box[axis][i]);
+          a.count[axis][i] += b.count[axis][i];
+        }
+      }
+      return a;
+    });
+  }
+
+  static int bin(Scalar c, Scalar origin, Scalar scale, int n_bins)
+  {
+    const int b = int((c - origin) * scale);
+    return std::max(0, std::min(b, n_bins - 1));
+  }
+
+  void make_leaf(Build_node& node, int begin, int end)
+  {
+    node.left  = node.right = -1;
+    node.first = begin;
+    node.count = end - begin;
+  }
+
+  void build(int index, int begin, int end, int depth, TaskGroup& group)
+  {
+    const Bounds bounds = compute_bounds(begin, end);
+    Build_node& node = nodes_[index];
+    node.box = bounds.box;
+
+    const int n = end - begin;
+    if (n == 1)
+    {
+      make_leaf(node, begin, end);
+      return;
+    }
+
+    const Vec3 extent = bounds.centroids.diagonal();
+    int split_axis = -1, split_bin = -1;
+    if (depth < MAX_SAH_DEPTH && extent.maxCoeff() > 0)
+    {
+      // SAH: cost of a split relative to the area of this node
+      const int n_bins = settings_.n_bins;
+      Vec3 scale;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        scale[axis] = extent[axis] > 0 ? Scalar(n_bins) * Scalar(0.99999) / extent[axis] : 0;
+      }
+      const Bins bins = compute_bins(begin, end, bounds.centroids.min(), scale);
+
+      Scalar best_cost = std::numeric_limits<Scalar>::max();
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        if (extent[axis] <= 0)
+        {
+          continue;
+        }
+        // right_area[i] * right_count[i] for the bins i..n_bins-1
+        Scalar right_cost[MAX_BINS];
+        BoundingBox box;
+        int count = 0;
+        for (int i = n_bins - 1; i > 0; --i)
+        {
+          box.extend(bins.box[axis][i]);
+          count += bins.count[axis][i];
+          right_cost[i] = box.area() * count;
+        }
+        box = BoundingBox();
+        count = 0;
+        for (int i = 0; i < n_bins - 1; ++i)
+        {
+          box.extend(bins.box[axis][i]);
+          count += bins.count[axis][i];
+          if (count == 0 || count == n)
+          {
+            continue;
+          }
+          const Scalar cost = box.area() * count + right_cost[i + 1];
+          if (cost < best_cost)
+          {
+            best_cost  = cost;
+            split_axis = axis;
+            split_bin  = i;
+          }
+        }
+      }
+
+      if (split_axis >= 0)
+      {
+        const Scalar area = bounds.box.area();
+        const Scalar split_cost = settings_.traversal_cost +
+          settings_.intersection_cost * (area > 0 ? best_cost / area : Scalar(n));
+        if (n <= settings_.max_leaf_size && split_cost >= settings_.intersection_cost * n)
+        {
+          make_leaf(node, begin, end);
+          return;
+        }
+
+        const Scalar origin = bounds.centroids.min()[split_axis], s = scale[split_axis];
+        const int axis = split_axis, last_bin = split_bin, nb = n_bins;
+        Build_ref* mid = std::partition(&refs_[0] + begin, &refs_[0] + end, [=](const Build_ref& r)
+        {
+          return bin(r.centroid[axis], origin, s, nb) <= last_bin;
+        });
+        split(node, begin, int(mid - &refs_[0]), end, depth, group);
+        return;
+      }
+    }
+
+    if (n <= settings_.max_leaf_size)
+    {
+      make_leaf(node, begin, end);
+      return;
+    }
+
+    // no useful SAH split: object median along the longest centroid axis
+    const int axis = bounds.centroids.is_empty() ? 0 : bounds.centroids.longest_axis();
+    const int mid = begin + n / 2;
+    std::nth_element(&refs_[0] + begin, &refs_[0] + mid, &refs_[0] + end, [axis](const Build_ref& a, const Build_ref& b)
+    {
+      return a.centroid[axis] < b.centroid[axis];
+    });
+    split(node, begin, mid, end, depth, group);
+  }
+
+  void split(Build_node& node, int begin, int mid, int end, int depth, TaskGroup& group)
+  {
+    const int left = next_node_.fetch_add(2);
+    node.left  = left;
+    node.right = left + 1;
+    node.first = begin;
+    node.count = 0;
+
+    if (end - begin > PARALLEL_SUBTREE_SIZE)
+    {
+      group.run([this, left, mid, end, depth, &group]() { build(left + 1, mid, end, depth + 1, group); });
+    }
+    else
+    {
+      build(left + 1, mid, end, depth + 1, group);
+    }
+    build(left, begin, mid, depth + 1, group);
+  }
+
+private:
+  Settings                  settings_;
+  std::vector<Build_ref>&   refs_;
+  std::vector<Build_node>&  nodes_;
+  std::atomic<int>          next_node_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+BVH::BVH() : mesh_(NULL), topology_generation_(0), geometry_generation_(0), garbage_nodes_(0) {}
+
+
+//-----------------------------------------------------------------------------
+
+
+BVH::BVH(const PolygonMesh& mesh, const Settings& settings)
+  : mesh_(NULL), topology_generation_(0), geometry_generation_(0), garbage_nodes_(0)
+{
+  build(mesh, settings);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::clear()
+{
+  mesh_ = NULL;
+  topology_generation_ = 0;
+  bounds_ = BoundingBox();
+  std::vector<Triangle>().swap(triangles_);
+  std::vector<Node>().swap(nodes_);
+
+  geometry_generation_ = 0;
+  garbage_nodes_ = 0;
+  std::vector<int>().swap(parents_);
+  std::vector<int>().swap(level_offsets_);
+  std::vector<int>().swap(level_nodes_);
+  std::vector<int>().swap(leaf_lanes_);
+  std::vector<int>().swap(face_offsets_);
+  std::vector<int>().swap(face_triangles_);
+  std::vector<int>().swap(subtree_first_);
+  std::vector<int>().swap(subtree_size_);
+  std::vector<Scalar>().swap(costs_);
+  std::vector<Scalar>().swap(build_quality_);
+  std::vector<unsigned char>().swap(dirty_);
+  std::vector<unsigned char>().swap(changed_);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::build(const PolygonMesh& mesh, const Settings& settings)
+{
+  clear();
+  mesh_ = &mesh;
+  topology_generation_ = mesh.topology_generation();
+  geometry_generation_ = mesh.geometry_generation();
+  settings_ = settings;
+
+  // fan triangulation of the faces
+  const FrozenConnectivity& fc = mesh.freeze();
+  const size_t n_faces = mesh.faces_size();
+  std::vector<int>& offsets = face_offsets_;
+  offsets.assign(n_faces + 1, 0);
+  for (size_t f = 0; f < n_faces; ++f)
+  {
+    const int n = mesh.is_deleted(Face((int)f)) ? 0 : (int)fc.vertices(Face((int)f)).size();
+    offsets[f + 1] = offsets[f] + std::max(n - 2, 0);
+  }
+
+  const int n_triangles = offsets[n_faces];
+  if (n_triangles == 0)
+  {
+    return;
+  }
+
+  std::vector<Triangle> triangles(n_triangles);
+  std::vector<Build_ref> refs(n_triangles);
+  const std::vector<Vec3>& points = mesh.points();
+  parallel_for(0, n_faces, 1024, [&](size_t first, size_t last)
+  {
+    for (size_t f = first; f < last; ++f)
+    {
+      const FrozenConnectivity::Vertex_range fv = fc.vertices(Face((int)f));
+      for (int t = offsets[f], i = 1; t < offsets[f + 1]; ++t, ++i)
+      {
+        Triangle& tri = triangles[t];
+        tri.vertices[0] = fv[0];
+        tri.vertices[1] = fv[i];
+        tri.vertices[2] = fv[i + 1];
+        tri.face = Face((int)f);
+
+        Build_ref& ref = refs[t];
+        ref.box = BoundingBox();
+        for (int k = 0; k < 3; ++k)
+        {
+          ref.box.extend(points[tri.vertices[k].idx()]);
+        }
+        ref.centroid = ref.box.center();
+        ref.triangle = t;
+      }
+    }
+  });
+
+  std::vector<Build_node> binary(2 * n_triangles - 1);
+  Builder builder(settings_, refs, binary);
+  builder.build();
+  bounds_ = binary[0].box;
+
+  triangles_.resize(n_triangles);
+  parallel_for(0, n_triangles, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      triangles_[i] = triangles[refs[i].triangle];
+    }
+  });
+
+  // a 4-wide tree has about a third of the binary nodes
+  nodes_.reserve(builder.n_nodes() / 3 + 1);
+  nodes_.push_back(Node());
+  if (binary[0].count > 0)
+  {
+    Node& root = nodes_[0];
+    for (int i = 0; i < 4; ++i)
+    {
+      root.min_x[i] = root.min_y[i] = root.min_z[i] = std::numeric_limits<Scalar>::max();
+      root.max_x[i] = root.max_y[i] = root.max_z[i] = -std::numeric_limits<Scalar>::max();
+      root.child[i] = EMPTY;
+      root.count[i] = 0;
+    }
+    root.min_x[0] = bounds_.min()[0]; root.min_y[0] = bounds_.min()[1]; root.min_z[0] = bounds_.min()[2];
+    root.max_x[0] = bounds_.max()[0]; root.max_y[0] = bounds_.max()[1]; root.max_z[0] = bounds_.max()[2];
+    root.child[0] = 0;
+    root.count[0] = n_triangles;
+  }
+  else
+  {
+    collapse(binary, 0, 0, 0);
+  }
+
+  index_tree();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::collapse(const std::vector<Build_node>& binary, int b, int n, int offset)
+{
+  // open the inner child of largest area until there are four children
+  int children[4] = { binary[b].left, binary[b].right, -1, -1 };
+  int n_children = 2;
+  while (n_children < 4)
+  {
+    int best = -1;
+    Scalar best_area = -1;
+    for (int i = 0; i < n_children; ++i)
+    {
+      const Build_node& c = binary[children[i]];
+      if (c.count == 0 && c.box.area() > best_area)
+      {
+        best = i;
+        best_area = c.box.area();
+      }
+    }
+    if (best < 0)
+    {
+      break;
+    }
+    const Build_node& c = binary[children[best]];
+    children[best] = c.left;
+    children[n_children++] = c.right;
+  }
+
+  Node node;
+  for (int i = 0; i < 4; ++i)
+  {
+    if (i < n_children)
+    {
+      const Build_node& c = binary[children[i]];
+      node.min_x[i] = c.box.min()[0]; node.min_y[i] = c.box.min()[1]; node.min_z[i] = c.box.min()[2];
+      node.max_x[i] = c.box.max()[0]; node.max_y[i] = c.box.max()[1]; node.max_z[i] = c.box.max()[2];
+      node.count[i] = c.count;
+      if (c.count > 0)
+      {
+        node.child[i] = offset + c.first;
+      }
+      else
+      {
+        node.child[i] = (int)nodes_.size();
+        nodes_.push_back(Node());
+      }
+    }
+    else
+    {
+      node.min_x[i] = node.min_y[i] = node.min_z[i] = std::numeric_limits<Scalar>::max();
+      node.max_x[i] = node.max_y[i] = node.max_z[i] = -std::numeric_limits<Scalar>::max();
+      node.child[i] = EMPTY;
+      node.count[i] = 0;
+    }
+  }
+  nodes_[n] = node;
+
+  for (int i = 0; i < n_children; ++i)
+  {
+    if (node.count[i] == 0)
+    {
+      collapse(binary, children[i], node.child[i], offset);
+    }
+  }
+}
+
+
+//== DEFORMING MESHES ===========================================================
+
+
+template <class Function>
+void BVH::for_each_node_bottom_up(const Function& fn)
+{
+  for (int level = (int)level_offsets_.size() - 2; level >= 0; --level)
+  {
+    parallel_for(level_offsets_[level], level_offsets_[level + 1], 256, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        fn(level_nodes_[i]);
+      }
+    });
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::index_tree()
+{
+  const size_t n_nodes = nodes_.size();
+  parents_.assign(n_nodes, -1);
+  subtree_first_.resize(n_nodes, 0);
+  subtree_size_.resize(n_nodes, 0);
+  costs_.resize(n_nodes, 0);
+  build_quality_.resize(n_nodes, -1);
+  dirty_.assign(n_nodes, 0);
+  changed_.resize(n_nodes, 1);
+  leaf_lanes_.resize(triangles_.size());
+
+  // reachable nodes level by level
+  level_offsets_.assign(1, 0);
+  level_nodes_.assign(1, 0);
+  for (int begin = 0; begin < (int)level_nodes_.size(); )
+  {
+    const int end = (int)level_nodes_.size();
+    for (int i = begin; i < end; ++i)
+    {
+      const int n = level_nodes_[i];
+      const Node& node = nodes_[n];
+      for (int lane = 0; lane < 4; ++lane)
+      {
+        if (node.child[lane] != EMPTY && node.count[lane] == 0)
+        {
+          parents_[node.child[lane]] = 4 * n + lane;
+          level_nodes_.push_back(node.child[lane]);
+        }
+      }
+    }
+    level_offsets_.push_back(end);
+    begin = end;
+  }
+
+  for_each_node_bottom_up([this](int n)
+  {
+    const Node& node = nodes_[n];
+    int first = std::numeric_limits<int>::max(), size = 0;
+    for (int lane = 0; lane < 4; ++lane)
+    {
+      const int c = node.child[lane];
+      if (c == EMPTY)
+      {
+        continue;
+      }
+      if (node.count[lane] > 0)
+      {
+        for (int t = c; t < c + node.count[lane]; ++t)
+        {
+          leaf_lanes_[t] = 4 * n + lane;
+        }
+        first = std::min(first, c);
+        size += node.count[lane];
+      }
+      else
+      {
+        first = std::min(first, subtree_first_[c]);
+        size += subtree_size_[c];
+      }
+    }
+    subtree_first_[n] = first;
+    subtree_size_[n]  = size;
+    update_cost(n);
+    if (build_quality_[n] < 0)
+    {
+      build_quality_[n] = quality(n);
+    }
+  });
+
+  // slot of every triangle in the fan of its face
+  const FrozenConnectivity& fc = mesh_->freeze();
+  face_triangles_.resize(triangles_.size());
+  parallel_for(0, triangles_.size(), 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      const Triangle& tri = triangles_[i];
+      const FrozenConnectivity::Vertex_range fv = fc.vertices(tri.face);
+      int k = 1;
+      while (fv[k] != tri.vertices[1])
+      {
+        ++k;
+      }
+      face_triangles_[face_offsets_[tri.face.idx()] + k - 1] = (int)i;
+    }
+  });
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::update_cost(int n)
+{
+  const Node& node = nodes_[n];
+  Scalar cost = 0;
+  for (int lane = 0; lane < 4; ++lane)
+  {
+    if (node.child[lane] == EMPTY)
+    {
+      continue;
+    }
+    const Scalar area = node.box(lane).area();
+    if (node.count[lane] > 0)
+    {
+      cost += settings_.intersection_cost * node.count[lane] * area;
+    }
+    else
+    {
+      cost += settings_.traversal_cost * area + costs_[node.child[lane]];
+    }
+  }
+  costs_[n] = cost;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar BVH::quality(int n) const
+{
+  const Node& node = nodes_[n];
+  BoundingBox box;
+  for (int lane = 0; lane < 4; ++lane)
+  {
+    if (node.child[lane] != EMPTY)
+    {
+      box.extend(node.box(lane));
+    }
+  }
+  const Scalar area = box.area();
+  return area > 0 ? costs_[n] / area : 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar BVH::sah_cost() const
+{
+  return nodes_.empty() ? 0 : settings_.traversal_cost + quality(0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool BVH::refit_node(int n)
+{
+  Node& node = nodes_[n];
+  const std::vector<Vec3>& points = mesh_->points();
+  bool changed = false;
+  for (int lane = 0; lane < 4; ++lane)
+  {
+    const int c = node.child[lane];
+    if (c == EMPTY)
+    {
+      continue;
+    }
+
+    BoundingBox box;
+    if (node.count[lane] > 0)
+    {
+      for (int t = c; t < c + node.count[lane]; ++t)
+      {
+        for (int k = 0; k < 3; ++k)
+        {
+          box.extend(points[triangles_[t].vertices[k].idx()]);
+        }
+      }
+    }
+    else
+    {
+      const Node& child = nodes_[c];
+      for (int l = 0; l < 4; ++l)
+      {
+        if (child.child[l] != EMPTY)
+        {
+          box.extend(child.box(l));
+        }
+      }
+    }
+
+    if (box.min() != Vec3(node.min_x[lane], node.min_y[lane], node.min_z[lane]) ||
+        box.max() != Vec3(node.max_x[lane], node.max_y[lane], node.max_z[lane]))
+    {
+      node.min_x[lane] = box.min()[0]; node.min_y[lane] = box.min()[1]; node.min_z[lane] = box.min()[2];
+      node.max_x[lane] = box.max()[0]; node.max_y[lane] = box.max()[1]; node.max_z[lane] = box.max()[2];
+      changed = true;
+    }
+  }
+
+  if (changed)
+  {
+    changed_[n] = 1;
+  }
+  update_cost(n);
+  return changed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::refit()
+{
+  if (!mesh_)
+  {
+    return;
+  }
+  // the triangles, leaves and face offsets belong to the old connectivity
+  if (mesh_->topology_generation() != topology_generation_)
+  {
+    build(*mesh_, settings_);
+    return;
+  }
+  if (nodes_.empty())
+  {
+    return;
+  }
+  const PolygonMesh& mesh = *mesh_;
+  std::fill(changed_.begin(), changed_.end(), 0);
+
+  // mark the leaves of the moved vertices and their ancestors, or everything
+  // if the moves are unknown or too many to be worth it
+  std::vector<Vertex> moved;
+  if (!mesh.moved_vertices(geometry_generation_, moved) || moved.size() > triangles_.size() / 8)
+  {
+    std::fill(dirty_.begin(), dirty_.end(), 1);
+  }
+  else
+  {
+    const FrozenConnectivity& fc = mesh.freeze();
+    for (size_t i = 0; i < moved.size(); ++i)
+    {
+      for (Face f : fc.faces(moved[i]))
+      {
+        for (int k = face_offsets_[f.idx()]; k < face_offsets_[f.idx() + 1]; ++k)
+        {
+          int n = leaf_lanes_[face_triangles_[k]] >> 2;
+          while (n >= 0 && !dirty_[n])
+          {
+            dirty_[n] = 1;
+            n = parents_[n] < 0 ? -1 : (parents_[n] >> 2);
+          }
+        }
+      }
+    }
+  }
+
+  for_each_node_bottom_up([this](int n)
+  {
+    if (dirty_[n])
+    {
+      refit_node(n);
+      dirty_[n] = 0;
+    }
+  });
+
+  bounds_ = BoundingBox();
+  for (int lane = 0; lane < 4; ++lane)
+  {
+    if (nodes_[0].child[lane] != EMPTY)
+    {
+      bounds_.extend(nodes_[0].box(lane));
+    }
+  }
+  geometry_generation_ = mesh.geometry_generation();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BVH::rebuild_subtree(int n, int lane)
+{
+  const int c = nodes_[n].child[lane];
+  const int first = subtree_first_[c], size = subtree_size_[c];
+
+  // the old nodes stay in place but become unreachable
+  std::vector<int> stack(1, c);
+  while (!stack.empty())
+  {
+    const Node& node = nodes_[stack.back()];
+    stack.pop_back();
+    ++garbage_nodes_;
+    for (int l = 0; l < 4; ++l)
+    {
+      if (node.child[l] != EMPTY && node.count[l] == 0)
+      {
+        stack.push_back(node.child[l]);
+      }
+    }
+  }
+
+  std::vector<Build_ref> refs(size);
+  const std::vector<Vec3>& points = mesh_->points();
+  parallel_for(0, size, 4096, [&](size_t b, size_t e)
+  {
+    for (size_t i = b; i < e; ++i)
+    {
+      Build_ref& ref = refs[i];
+      ref.box = BoundingBox();
+      for (int k = 0; k < 3; ++k)
+      {
+        ref.box.extend(points[triangles_[first + i].vertices[k].idx()]);
+      }
+      ref.centroid = ref.box.center();
+      ref.triangle = first + (int)i;
+    }
+  });
+
+  std::vector<Build_node> binary(2 * size - 1);
+  Builder builder(settings_, refs, binary);
+  builder.build();
+
+  std::vector<Triangle> reordered(size);
+  for (int i = 0; i < size; ++i)
+  {
+    reordered[i] = triangles_[refs[i].triangle];
+  }
+  std::copy(reordered.begin(), reordered.end(), triangles_.begin() + first);
+
+  if (binary[0].count > 0)
+  {
+    nodes_[n].child[lane] = first;
+    nodes_[n].count[lane] = size;
+  }
+  else
+  {
+    const int root = (int)nodes_.size();
+    nodes_.push_back(Node());
+    nodes_[n].child[lane] = root;
+    collapse(binary, 0, root, first);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+BVH::Update_result BVH::update()
+{
+  if (!mesh_)
+  {
+    return UNCHANGED;
+  }
+  if (mesh_->topology_generation() != topology_generation_)
+  {
+    build(*mesh_, settings_);
+    return REBUILT;
+  }
+  if (mesh_->geometry_generation() == geometry_generation_)
+  {
+    return UNCHANGED;
+  }
+
+  refit();
+  if (nodes_.empty())
+  {
+    return REFITTED;
+  }
+
+  const Scalar threshold = settings_.rebuild_threshold;
+  if (garbage_nodes_ > nodes_.size() / 2 || quality(0) > threshold * build_quality_[0])
+  {
+    build(*mesh_, settings_);
+    return REBUILT;
+  }
+
+  // topmost subtrees that degraded, as 4 * parent + lane
+  std::vector<int> degraded;
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+  {
+    const int n = stack.back();
+    stack.pop_back();
+    const Node& node = nodes_[n];
+    for (int lane = 0; lane < 4; ++lane)
+    {
+      const int c = node.child[lane];
+      if (c == EMPTY || node.count[lane] > 0 || subtree_size_[c] < settings_.min_rebuild_size)
+      {
+        continue;
+      }
+      if (quality(c) > threshold * build_quality_[c])
+      {
+        degraded.push_back(4 * n + lane);
+      }
+      else
+      {
+        stack.push_back(c);
+      }
+    }
+  }
+  if (degraded.empty())
+  {
+    return REFITTED;
+  }
+
+  for (size_t i = 0; i < degraded.size(); ++i)
+  {
+    rebuild_subtree(degraded[i] >> 2, degraded[i] & 3);
+  }
+  index_tree();
+
+  for (size_t i = 0; i < degraded.size(); ++i)
+  {
+    for (int n = degraded[i] >> 2; n >= 0; n = parents_[n] < 0 ? -1 : (parents_[n] >> 2))
+    {
+      changed_[n] = 1;
+    }
+  }
+  return PARTIALLY_REBUILT;
+}
+
+
+//== QUERIES ====================================================================
+
+
+bool BVH::intersect_triangle(const Watertight_ray& ray, int t, Scalar tmin, Scalar tmax, Hit* hit) const
+{
+  const Triangle& tri = triangles_[t];
+  const std::vector<Vec3>& points = mesh_->points();
+  Scalar d;
+  Vec3 barycentric;
+  if (!intersect_watertight(ray, points[tri.vertices[0].idx()], points[tri.vertices[1].idx()],
+                            points[tri.vertices[2].idx()], tmin, tmax, d, barycentric))
+  {
+    return false;
+  }
+
+  if (hit)
+  {
+    hit->face        = tri.face;
+    hit->triangle    = t;
+    hit->barycentric = barycentric;
+    hit->distance    = d;
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool BVH::intersect(const Ray& ray, Hit& hit) const
+{
+  if (nodes_.empty())
+  {
+    return false;
+  }
+
+  const Watertight_ray wray(ray.origin, ray.direction);
+  const Vec3 inv = safe_inverse(ray.direction);
+  const Scalar ox = ray.origin[0], oy = ray.origin[1], oz = ray.origin[2];
+  const Scalar ix = inv[0], iy = inv[1], iz = inv[2];
+  Scalar tmax = ray.tmax;
+  bool found = false;
+
+  struct Entry { int node; Scalar t; };
+  Entry stack[STACK_SIZE];
+  int top = 0;
+  stack[top].node = 0;
+  stack[top++].t  = ray.tmin;
+
+  while (top > 0)
+  {
+    const Entry e = stack[--top];
+    if (e.t > tmax)
+    {
+      continue;
+    }
+    const Node& node = nodes_[e.node];
+
+    // slab test of the four children
+    Scalar tnear[4];
+    int    mask[4];
+    for (int i = 0; i < 4; ++i)
+    {
+      const Scalar tx0 = (node.min_x[i] - ox) * ix, tx1 = (node.max_x[i] - ox) * ix;
+      const Scalar ty0 = (node.min_y[i] - oy) * iy, ty1 = (node.max_y[i] - oy) * iy;
+      const Scalar tz0 = (node.min_z[i] - oz) * iz, tz1 = (node.max_z[i] - oz) * iz;
+      const Scalar t0 = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), ray.tmin));
+      const Scalar t1 = std::min(ROBUST_FAR_SCALE * std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1)), tmax);
+      tnear[i] = t0;
+      mask[i]  = t0 <= t1;
+    }
+
+    // leaves right away, inner children sorted near to far
+    int order[4], n_inner = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (!mask[i] || node.child[i] == EMPTY)
+      {
+        continue;
+      }
+      if (node.count[i] > 0)
+      {
+        for (int t = node.child[i], end = t + node.count[i]; t < end; ++t)
+        {
+          if (intersect_triangle(wray, t, ray.tmin, tmax, &hit))
+          {
+            tmax  = hit.distance;
+            found = true;
+          }
+        }
+      }
+      else
+      {
+        int j = n_inner++;
+        for (; j > 0 && tnear[order[j - 1]] < tnear[i]; --j)
+        {
+          order[j] = order[j - 1];
+        }
+        order[j] = i;
+      }
+    }
+    for (int j = 0; j < n_inner; ++j)
+    {
+      if (tnear[order[j]] <= tmax)
+      {
+        assert(top < STACK_SIZE);
+        stack[top].node = node.child[order[j]];
+        stack[top++].t  = tnear[order[j]];
+      }
+    }
+  }
+
+  if (found)
+  {
+    hit.point = ray.origin + hit.distance * ray.direction;
+  }
+  return found;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool BVH::occluded(const Ray& ray, Hit* hit) const
+{
+  if (nodes_.empty())
+  {
+    return false;
+  }
+
+  const Watertight_ray wray(ray.origin, ray.direction);
+  const Vec3 inv = safe_inverse(ray.direction);
+  const Scalar ox = ray.origin[0], oy = ray.origin[1], oz = ray.origin[2];
+  const Scalar ix = inv[0], iy = inv[1], iz = inv[2];
+
+  int stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0)
+  {
+    const Node& node = nodes_[stack[--top]];
+
+    int mask[4];
+    for (int i = 0; i < 4; ++i)
+    {
+      const Scalar tx0 = (node.min_x[i] - ox) * ix, tx1 = (node.max_x[i] - ox) * ix;
+      const Scalar ty0 = (node.min_y[i] - oy) * iy, ty1 = (node.max_y[i] - oy) * iy;
+      const Scalar tz0 = (node.min_z[i] - oz) * iz, tz1 = (node.max_z[i] - oz) * iz;
+      const Scalar t0 = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), ray.tmin));
+      const Scalar t1 = std::min(ROBUST_FAR_SCALE * std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1)), ray.tmax);
+      mask[i] = t0 <= t1;
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+      if (!mask[i] || node.child[i] == EMPTY)
+      {
+        continue;
+      }
+      if (node.count[i] > 0)
+      {
+        for (int t = node.child[i], end = t + node.count[i]; t < end; ++t)
+        {
+          if (intersect_triangle(wray, t, ray.tmin, ray.tmax, hit))
+          {
+            if (hit)
+            {
+              hit->point = ray.origin + hit->distance * ray.direction;
+            }
+            return true;
+          }
+        }
+      }
+      else
+      {
+        assert(top < STACK_SIZE);
+        stack[top++] = node.child[i];
+      }
+    }
+  }
+  return false;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool BVH::closest_point(const Vec3& p, Hit& hit, Scalar max_distance) const
+{
+  if (nodes_.empty())
+  {
+    return false;
+  }
+
+  const std::vector<Vec3>& points = mesh_->points();
+  const Scalar px = p[0], py = p[1], pz = p[2];
+  Scalar best = max_distance < std::numeric_limits<Scalar>::max()
+              ? max_distance * max_distance : std::numeric_limits<Scalar>::infinity();
+  bool found = false;
+
+  struct Entry { int node; Scalar d2; };
+  Entry stack[STACK_SIZE];
+  int top = 0;
+  stack[top].node = 0;
+  stack[top++].d2 = 0;
+
+  while (top > 0)
+  {
+    const Entry e = stack[--top];
+    if (e.d2 > best)
+    {
+      continue;
+    }
+    const Node& node = nodes_[e.node];
+
+    // squared distances to the four children
+    Scalar d2[4];
+    for (int i = 0; i < 4; ++i)
+    {
+      const Scalar dx = std::max(std::max(node.min_x[i] - px, px - node.max_x[i]), Scalar(0));
+      const Scalar dy = std::max(std::max(node.min_y[i] - py, py - node.max_y[i]), Scalar(0));
+      const Scalar dz = std::max(std::max(node.min_z[i] - pz, pz - node.max_z[i]), Scalar(0));
+      d2[i] = dx * dx + dy * dy + dz * dz;
+    }
+
+    int order[4], n_inner = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (node.child[i] == EMPTY || d2[i] > best)
+      {
+        continue;
+      }
+      if (node.count[i] > 0)
+      {
+        for (int t = node.child[i], end = t + node.count[i]; t < end; ++t)
+        {
+          const Triangle& tri = triangles_[t];
+          const Vec3& a = points[tri.vertices[0].idx()];
+          const Vec3& b = points[tri.vertices[1].idx()];
+          const Vec3& c = points[tri.vertices[2].idx()];
+          const Vec3 w = closest_point_triangle(p, a, b, c);
+          const Vec3 q = w[0] * a + w[1] * b + w[2] * c;
+          const Scalar dist2 = (q - p).squaredNorm();
+          if (dist2 <= best)
+          {
+            best  = dist2;
+            found = true;
+            hit.face        = tri.face;
+            hit.triangle    = t;
+            hit.barycentric = w;
+            hit.point       = q;
+          }
+        }
+      }
+      else
+      {
+        int j = n_inner++;
+        for (; j > 0 && d2[order[j - 1]] < d2[i]; --j)
+        {
+          order[j] = order[j - 1];
+        }
+        order[j] = i;
+      }
+    }
+    for (int j = 0; j < n_inner; ++j)
+    {
+      if (d2[order[j]] <= best)
+      {
+        assert(top < STACK_SIZE);
+        stack[top].node = node.child[order[j]];
+        stack[top++].d2 = d2[order[j]];
+      }
+    }
+  }
+
+  if (found)
+  {
+    hit.distance = std::sqrt(best);
+  }
+  return found;
+}
+
+}
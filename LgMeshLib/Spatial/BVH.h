@@ -0,0 +1,223 @@
+#ifndef LGMESH_BVH_H
+#define LGMESH_BVH_H
+
+#include "PolygonMesh.h"
+#include "BoundingBox.h"
+#include "RayTriangle.h"
+
+#include <limits>
+#include <vector>
+
+namespace LG {
+
+// Bounding volume hierarchy over the faces of a PolygonMesh.
+//
+// Faces are fan-triangulated, the binary tree is built top-down with binned
+// SAH splits (large subtrees and bins in parallel) and then collapsed into a
+// 4-wide tree. Every node stores the boxes of its four children as separate
+// coordinate arrays, so one node is tested against a ray or a point in a
+// single vectorizable loop over the four lanes.
+//
+// The tree keeps a reference to the mesh and reads vertex positions from it.
+// For deforming meshes update() refits the boxes of the subtrees containing
+// moved vertices and rebuilds subtrees whose SAH cost degraded too much; a
+// change of the connectivity always triggers a full rebuild.
+class BVH
+{
+public:
+  typedef PolygonMesh::Vertex Vertex;
+  typedef PolygonMesh::Face   Face;
+
+  struct Settings
+  {
+    Settings() : n_bins(16), max_leaf_size(8), traversal_cost(1), intersection_cost(1),
+                 rebuild_threshold(Scalar(1.5)), min_rebuild_size(1024) {}
+
+    int    n_bins;             // SAH bins per axis, at most 32
+    int    max_leaf_size;      // larger ranges are always split
+    Scalar traversal_cost;     // SAH cost of visiting a node ...
+    Scalar intersection_cost;  // ... relative to testing a triangle
+
+    // update() rebuilds subtrees of at least min_rebuild_size triangles whose
+    // SAH cost per area grew by this factor since they were built
+    Scalar rebuild_threshold;
+    int    min_rebuild_size;
+  };
+
+  struct Ray
+  {
+    Ray(const Vec3& _origin = Vec3::Zero(), const Vec3& _direction = Vec3::UnitZ(),
+        Scalar _tmin = 0, Scalar _tmax = std::numeric_limits<Scalar>::infinity())
+      : origin(_origin), direction(_direction), tmin(_tmin), tmax(_tmax) {};
+
+    Vec3   origin;
+    Vec3   direction;   // need not be normalized, t is in units of direction
+    Scalar tmin;
+    Scalar tmax;
+  };
+
+  // result of a query. barycentric holds the weights of the three vertices of
+  // triangle(triangle), distance is the ray parameter t or the Euclidean
+  // distance to the query point.
+  struct Hit
+  {
+    Face   face;
+    int    triangle;
+    Vec3   barycentric;
+    Vec3   point;
+    Scalar distance;
+  };
+
+  // triangle of the fan triangulation of face
+  struct Triangle
+  {
+    Vertex vertices[3];
+    Face   face;
+  };
+
+  // 4-wide node: lane i is empty (child[i] == EMPTY), an inner node
+  // (count[i] == 0, child[i] is the node index) or a leaf (count[i]
+  // triangles starting at child[i])
+  struct Node
+  {
+    Scalar min_x[4], min_y[4], min_z[4];
+    Scalar max_x[4], max_y[4], max_z[4];
+    int    child[4];
+    int    count[4];
+
+    bool is_leaf(int i)  const { return count[i] > 0; };
+    bool is_empty(int i) const { return child[i] == EMPTY; };
+    BoundingBox box(int i) const
+    {
+      return BoundingBox(Vec3(min_x[i], min_y[i], min_z[i]), Vec3(max_x[i], max_y[i], max_z[i]));
+    }
+  };
+
+  static const int EMPTY = -1;
+
+public:
+  BVH();
+
+  explicit BVH(const PolygonMesh& mesh, const Settings& settings = Settings());
+
+  // (re)build the tree over the non-deleted faces of mesh
+  void build(const PolygonMesh& mesh, const Settings& settings = Settings());
+
+  void clear();
+
+  bool empty() const { return nodes_.empty(); };
+
+  // was the tree built from the current connectivity of mesh?
+  bool is_current(const PolygonMesh& mesh) const
+  {
+    return (mesh_ == &mesh) && (topology_generation_ == mesh.topology_generation());
+  }
+
+  const PolygonMesh* mesh() const { return mesh_; };
+
+  // box of all triangles
+  const BoundingBox& bounds() const { return bounds_; };
+
+  // triangles in leaf order, node 0 is the root
+  const std::vector<Triangle>& triangles() const { return triangles_; };
+  const std::vector<Node>&     nodes()     const { return nodes_; };
+
+  const Triangle& triangle(int i) const { return triangles_[i]; };
+
+public: //--- deforming meshes
+
+  enum Update_result { UNCHANGED, REFITTED, PARTIALLY_REBUILT, REBUILT };
+
+  // bring the tree up to date with its mesh: rebuild after a topology change,
+  // otherwise refit and rebuild degraded subtrees (or everything if the root
+  // itself degraded)
+  Update_result update();
+
+  // recompute the boxes of all subtrees containing vertices moved since the
+  // last build or update; all boxes if the mesh did not log the moves.
+  // Rebuilds the tree if the connectivity changed since it was built.
+  void refit();
+
+  // SAH cost of the tree, normalized by the area of the root
+  Scalar sah_cost() const;
+
+  // did the boxes of node n change in the last build, refit or update?
+  // Lets collision passes skip pairs of unchanged subtrees.
+  bool is_changed(int n) const { return changed_[n] != 0; };
+
+  // triangles of the subtree below node n are [subtree_first(n), subtree_first(n) + subtree_size(n))
+  int subtree_first(int n) const { return subtree_first_[n]; };
+  int subtree_size(int n)  const { return subtree_size_[n]; };
+
+public: //--- queries, all of them are thread-safe
+
+  // closest intersection of ray with the mesh in [tmin, tmax]
+  bool intersect(const Ray& ray, Hit& hit) const;
+
+  // is there any intersection in [tmin, tmax]? The first one found is
+  // written to hit if given.
+  bool occluded(const Ray& ray, Hit* hit = NULL) const;
+
+  // closest point on the mesh not farther than max_distance from p
+  bool closest_point(const Vec3& p, Hit& hit,
+                     Scalar max_distance = std::numeric_limits<Scalar>::infinity()) const;
+
+private:
+  struct Build_node;
+  struct Build_ref;
+  class  Builder;
+
+  // convert the binary build tree below binary node b into node n, leaves
+  // start at triangle offset + first
+  void collapse(const std::vector<Build_node>& binary, int b, int n, int offset);
+
+  // rebuild the subtree below lane `lane` of node n
+  void rebuild_subtree(int n, int lane);
+
+  // parents, levels, leaf lanes, triangles of faces and subtree costs
+  void index_tree();
+
+  // call fn(n) for all nodes, deepest level first, nodes of a level in parallel
+  template <class Function>
+  void for_each_node_bottom_up(const Function& fn);
+
+  // recompute the boxes of the lanes of n, true if one of them changed
+  bool refit_node(int n);
+
+  // recompute the subtree cost of n from its lanes
+  void update_cost(int n);
+
+  // SAH cost per area of the subtree below n
+  Scalar quality(int n) const;
+
+  bool intersect_triangle(const Watertight_ray& ray, int t, Scalar tmin, Scalar tmax, Hit* hit) const;
+
+private:
+  const PolygonMesh*     mesh_;
+  unsigned long          topology_generation_;
+  Settings               settings_;
+  BoundingBox            bounds_;
+
+  std::vector<Triangle>  triangles_;
+  std::vector<Node>      nodes_;
+
+  // state for update() and refit()
+  unsigned long              geometry_generation_;
+  size_t                     garbage_nodes_;      // unreachable nodes left by partial rebuilds
+  std::vector<int>           parents_;            // 4 * parent + lane, -1 for the root
+  std::vector<int>           level_offsets_;      // reachable nodes ordered by depth
+  std::vector<int>           level_nodes_;
+  std::vector<int>           leaf_lanes_;         // per triangle: 4 * node + lane of its leaf
+  std::vector<int>           face_offsets_;       // fan triangles of face f are
+  std::vector<int>           face_triangles_;     // face_triangles_[face_offsets_[f]...]
+  std::vector<int>           subtree_first_;
+  std::vector<int>           subtree_size_;
+  std::vector<Scalar>        costs_;              // SAH cost of the subtree, not normalized
+  std::vector<Scalar>        build_quality_;      // quality() right after the subtree was built
+  std::vector<unsigned char> dirty_;
+  std::vector<unsigned char> changed_;
+};
+
+}
+
+#endif // !LGMESH_BVH_H
@@ -0,0 +1,96 @@
+#ifndef LGMESH_BOUNDINGBOX_H
+#define LGMESH_BOUNDINGBOX_H
+
+#include "LgMeshTypes.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace LG {
+
+// Axis-aligned bounding box, empty until the first point is added
+class BoundingBox
+{
+public:
+  BoundingBox()
+    : min_(Vec3::Constant(std::numeric_limits<Scalar>::max())),
+      max_(Vec3::Constant(-std::numeric_limits<Scalar>::max())) {};
+
+  BoundingBox(const Vec3& _min, const Vec3& _max) : min_(_min), max_(_max) {};
+
+  const Vec3& min() const { return min_; };
+  const Vec3& max() const { return max_; };
+
+  bool is_empty() const
+  {
+    return max_[0] < min_[0] || max_[1] < min_[1] || max_[2] < min_[2];
+  }
+
+  void extend(const Vec3& p)
+  {
+    min_ = min_.cwiseMin(p);
+    max_ = max_.cwiseMax(p);
+  }
+
+  void extend(const BoundingBox& b)
+  {
+    min_ = min_.cwiseMin(b.min_);
+    max_ = max_.cwiseMax(b.max_);
+  }
+
+  Vec3 center() const { return Scalar(0.5) * (min_ + max_); };
+
+  Vec3 diagonal() const { return max_ - min_; };
+
+  // surface area, 0 for empty boxes
+  Scalar area() const
+  {
+    if (is_empty())
+    {
+      return 0;
+    }
+    const Vec3 d = diagonal();
+    return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+  }
+
+  // axis of the largest extent
+  int longest_axis() const
+  {
+    const Vec3 d = diagonal();
+    return (d[0] >= d[1] && d[0] >= d[2]) ? 0 : (d[1] >= d[2] ? 1 : 2);
+  }
+
+  bool contains(const Vec3& p) const
+  {
+    return min_[0] <= p[0] && p[0] <= max_[0] &&
+           min_[1] <= p[1] && p[1] <= max_[1] &&
+           min_[2] <= p[2] && p[2] <= max_[2];
+  }
+
+  bool intersects(const BoundingBox& b) const
+  {
+    return min_[0] <= b.max_[0] && b.min_[0] <= max_[0] &&
+           min_[1] <= b.max_[1] && b.min_[1] <= max_[1] &&
+           min_[2] <= b.max_[2] && b.min_[2] <= max_[2];
+  }
+
+  // squared distance from p to the box, 0 inside
+  Scalar squared_distance(const Vec3& p) const
+  {
+    Scalar d2 = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+      const Scalar d = std::max(std::max(min_[i] - p[i], p[i] - max_[i]), Scalar(0));
+      d2 += d * d;
+    }
+    return d2;
+  }
+
+private:
+  Vec3 min_;
+  Vec3 max_;
+};
+
+}
+
+#endif // !LGMESH_BOUNDINGBOX_H
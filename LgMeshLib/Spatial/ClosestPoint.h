@@ -0,0 +1,67 @@
+#ifndef LGMESH_CLOSESTPOINT_H
+#define LGMESH_CLOSESTPOINT_H
+
+#include "LgMeshTypes.h"
+
+namespace LG {
+
+// closest point to p on triangle (a, b, c), see Ericson, Real-Time Collision
+// Detection, 5.1.5. Returns the barycentric weights of a, b and c.
+inline Vec3 closest_point_triangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+{
+  const Vec3 ab = b - a, ac = c - a, ap = p - a;
+  const Scalar d1 = ab.dot(ap), d2 = ac.dot(ap);
+  if (d1 <= 0 && d2 <= 0)
+  {
+    return Vec3(1, 0, 0);
+  }
+
+  const Vec3 bp = p - b;
+  const Scalar d3 = ab.dot(bp), d4 = ac.dot(bp);
+  if (d3 >= 0 && d4 <= d3)
+  {
+    return Vec3(0, 1, 0);
+  }
+
+  const Scalar vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0)
+  {
+    const Scalar v = d1 / (d1 - d3);
+    return Vec3(1 - v, v, 0);
+  }
+
+  const Vec3 cp = p - c;
+  const Scalar d5 = ab.dot(cp), d6 = ac.dot(cp);
+  if (d6 >= 0 && d5 <= d6)
+  {
+    return Vec3(0, 0, 1);
+  }
+
+  const Scalar vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0)
+  {
+    const Scalar w = d2 / (d2 - d6);
+    return Vec3(1 - w, 0, w);
+  }
+
+  const Scalar va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+  {
+    const Scalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return Vec3(0, 1 - w, w);
+  }
+
+  const Scalar denom = va + vb + vc;
+  if (!(denom > 0))
+  {
+    // degenerate triangle, take the closest of its vertices
+    const Scalar la = ap.squaredNorm(), lb = bp.squaredNorm(), lc = cp.squaredNorm();
+    return (la <= lb && la <= lc) ? Vec3(1, 0, 0) : (lb <= lc ? Vec3(0, 1, 0) : Vec3(0, 0, 1));
+  }
+  const Scalar v = vb / denom, w = vc / denom;
+  return Vec3(1 - v - w, v, w);
+}
+
+}
+
+#endif // !LGMESH_CLOSESTPOINT_H
@@ -0,0 +1,337 @@
+#include "KDTree.h"
+#include "Parallel.h"
+
+#include <algorithm>
+
+namespace LG {
+
+namespace {
+
+// subtrees above this size are built as tasks
+const int PARALLEL_BUILD_SIZE = 16384;
+
+// queries per task of the batched queries
+const int QUERY_GRAIN = 256;
+
+// Result buffer of one thread for batched radius queries: the neighbours of
+// all queries the thread answered, back to back
+struct Radius_buffer
+{
+  std::vector<int>              queries;
+  std::vector<int>              counts;
+  std::vector<KDTree::Neighbor> neighbors;
+};
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+KDTree::KDTree(const PolygonMesh& mesh) : mesh_(&mesh)
+{
+  build(mesh.points());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+KDTree::KDTree(const PolygonMesh& mesh, PolygonMesh::Vertex_attribute<Vec3> points) : mesh_(&mesh)
+{
+  build(points.vector());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+KDTree::KDTree(const std::vector<Vec3>& points) : mesh_(NULL)
+{
+  build(points);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KDTree::build(const std::vector<Vec3>& points)
+{
+  // collect the points, skipping deleted vertices
+  std::vector<Build_point> build_points;
+  build_points.reserve(points.size());
+  bounds_ = BoundingBox();
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    if (mesh_ == NULL || !mesh_->is_deleted(Vertex((int)i)))
+    {
+      Build_point b;
+      b.point = points[i];
+      b.index = (int)i;
+      build_points.push_back(b);
+      bounds_.extend(b.point);
+    }
+  }
+
+  const int n = (int)build_points.size();
+  axes_.assign(n, 0);
+  if (n > 0)
+  {
+    TaskGroup group;
+    build(build_points, 0, n, bounds_, group);
+    group.wait();
+  }
+
+  points_.resize(n);
+  indices_.resize(n);
+  parallel_for(0, n, 16384, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      points_[i]  = build_points[i].point;
+      indices_[i] = build_points[i].index;
+    }
+  });
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KDTree::build(std::vector<Build_point>& points, int begin, int end, BoundingBox cell, TaskGroup& group)
+{
+  while (end - begin > LEAF_SIZE)
+  {
+    // split the longest side of the cell at the median
+    const int axis = cell.longest_axis();
+    const int mid = (begin + end) / 2;
+    std::nth_element(points.begin() + begin, points.begin() + mid, points.begin() + end,
+                     [axis](const Build_point& a, const Build_point& b) { return a.point[axis] < b.point[axis]; });
+    axes_[mid] = (unsigned char)axis;
+
+    Vec3 lo = cell.min(), hi = cell.max();
+    lo[axis] = hi[axis] = points[mid].point[axis];
+    const BoundingBox right(lo, cell.max());
+    cell = BoundingBox(cell.min(), hi);
+
+    if (end - mid > PARALLEL_BUILD_SIZE)
+    {
+      group.run([this, &points, mid, end, right, &group]() { build(points, mid + 1, end, right, group); });
+    }
+    else
+    {
+      build(points, mid + 1, end, right, group);
+    }
+    end = mid;
+  }
+}
+
+
+//== SINGLE QUERIES =============================================================
+
+
+void KDTree::knn(int begin, int end, const Vec3& p, size_t k, std::vector<Neighbor>& heap) const
+{
+  while (end - begin > LEAF_SIZE)
+  {
+    const int mid = (begin + end) / 2;
+    const int axis = axes_[mid];
+    const Scalar d = p[axis] - points_[mid][axis];
+
+    if (is_valid(mid))
+    {
+      const Scalar d2 = (points_[mid] - p).squaredNorm();
+      if (heap.size() < k || d2 < heap.front().squared_distance)
+      {
+        if (heap.size() == k)
+        {
+          std::pop_heap(heap.begin(), heap.end());
+          heap.pop_back();
+        }
+        heap.push_back(Neighbor(indices_[mid], d2));
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+
+    // near side first, the far side only if the split plane is close enough
+    const int near_begin = d < 0 ? begin : mid + 1, near_end = d < 0 ? mid : end;
+    const int far_begin  = d < 0 ? mid + 1 : begin, far_end  = d < 0 ? end : mid;
+    knn(near_begin, near_end, p, k, heap);
+    if (heap.size() == k && d * d >= heap.front().squared_distance)
+    {
+      return;
+    }
+    begin = far_begin;
+    end   = far_end;
+  }
+
+  for (int i = begin; i < end; ++i)
+  {
+    const Scalar d2 = (points_[i] - p).squaredNorm();
+    if ((heap.size() < k || d2 < heap.front().squared_distance) && is_valid(i))
+    {
+      if (heap.size() == k)
+      {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.pop_back();
+      }
+      heap.push_back(Neighbor(indices_[i], d2));
+      std::push_heap(heap.begin(), heap.end());
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KDTree::radius(int begin, int end, const Vec3& p, Scalar r2, std::vector<Neighbor>& result) const
+{
+  while (end - begin > LEAF_SIZE)
+  {
+    const int mid = (begin + end) / 2;
+    const int axis = axes_[mid];
+    const Scalar d = p[axis] - points_[mid][axis];
+
+    const Scalar d2 = (points_[mid] - p).squaredNorm();
+    if (d2 <= r2 && is_valid(mid))
+    {
+      result.push_back(Neighbor(indices_[mid], d2));
+    }
+
+    const int near_begin = d < 0 ? begin : mid + 1, near_end = d < 0 ? mid : end;
+    const int far_begin  = d < 0 ? mid + 1 : begin, far_end  = d < 0 ? end : mid;
+    if (d * d <= r2)
+    {
+      radius(far_begin, far_end, p, r2, result);
+    }
+    begin = near_begin;
+    end   = near_end;
+  }
+
+  for (int i = begin; i < end; ++i)
+  {
+    const Scalar d2 = (points_[i] - p).squaredNorm();
+    if (d2 <= r2 && is_valid(i))
+    {
+      result.push_back(Neighbor(indices_[i], d2));
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+KDTree::Neighbor KDTree::nearest(const Vec3& p) const
+{
+  std::vector<Neighbor> heap;
+  heap.reserve(1);
+  knn(0, (int)points_.size(), p, 1, heap);
+  return heap.empty() ? Neighbor() : heap[0];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KDTree::knn(const Vec3& p, int k, std::vector<Neighbor>& result) const
+{
+  result.clear();
+  if (k <= 0)
+  {
+    return;
+  }
+  result.reserve(k);
+  knn(0, (int)points_.size(), p, k, result);
+  std::sort_heap(result.begin(), result.end());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KDTree::radius(const Vec3& p, Scalar r, std::vector<Neighbor>& result, bool sorted) const
+{
+  result.clear();
+  radius(0, (int)points_.size(), p, r * r, result);
+  if (sorted)
+  {
+    std::sort(result.begin(), result.end());
+  }
+}
+
+
+//== BATCHED QUERIES ============================================================
+
+
+void KDTree::knn(const std::vector<Vec3>& queries, int k, std::vector<Neighbor>& result) const
+{
+  result.assign(queries.size() * std::max(k, 0), Neighbor());
+  if (k <= 0)
+  {
+    return;
+  }
+
+  Thread_local_storage< std::vector<Neighbor> > heaps;
+  parallel_for(0, queries.size(), QUERY_GRAIN, [&](size_t first, size_t last)
+  {
+    std::vector<Neighbor>& heap = heaps.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      heap.clear();
+      knn(0, (int)points_.size(), queries[i], k, heap);
+      std::sort_heap(heap.begin(), heap.end());
+      std::copy(heap.begin(), heap.end(), result.begin() + i * k);
+    }
+  });
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KDTree::radius(const std::vector<Vec3>& queries, Scalar r,
+                    std::vector<int>& offsets, std::vector<Neighbor>& result, bool sorted) const
+{
+  // every thread appends to its own buffer, the buffers are then copied to
+  // their place in the result
+  const Scalar r2 = r * r;
+  Thread_local_storage<Radius_buffer> buffers;
+  offsets.assign(queries.size() + 1, 0);
+  parallel_for(0, queries.size(), QUERY_GRAIN, [&](size_t first, size_t last)
+  {
+    Radius_buffer& buffer = buffers.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      const size_t start = buffer.neighbors.size();
+      radius(0, (int)points_.size(), queries[i], r2, buffer.neighbors);
+      if (sorted)
+      {
+        std::sort(buffer.neighbors.begin() + start, buffer.neighbors.end());
+      }
+      buffer.queries.push_back((int)i);
+      buffer.counts.push_back(int(buffer.neighbors.size() - start));
+      offsets[i + 1] = int(buffer.neighbors.size() - start);
+    }
+  });
+
+  for (size_t i = 0; i < queries.size(); ++i)
+  {
+    offsets[i + 1] += offsets[i];
+  }
+  result.resize(offsets.back());
+
+  buffers.for_each([&](Radius_buffer& buffer)
+  {
+    size_t start = 0;
+    for (size_t j = 0; j < buffer.queries.size(); ++j)
+    {
+      std::copy(buffer.neighbors.begin() + start, buffer.neighbors.begin() + start + buffer.counts[j],
+                result.begin() + offsets[buffer.queries[j]]);
+      start += buffer.counts[j];
+    }
+  });
+}
+
+}
@@ -0,0 +1,111 @@
+#ifndef LGMESH_KDTREE_H
+#define LGMESH_KDTREE_H
+
+#include "PolygonMesh.h"
+#include "BoundingBox.h"
+
+#include <limits>
+#include <vector>
+
+namespace LG {
+
+class TaskGroup;
+
+// KD-tree for nearest neighbour and radius queries over points.
+//
+// The tree has an implicit layout: the points are reordered so that every
+// subtree is a contiguous range [begin, end) with its splitting point at the
+// median (begin + end) / 2, left subtree below and right subtree above it.
+// Only the reordered points, their original indices and one split axis per
+// median are stored, no child pointers. Ranges of at most LEAF_SIZE points
+// are scanned linearly.
+//
+// Trees over a mesh return vertex indices and skip vertices that are deleted
+// when building and, in case the mesh deletes them later, when querying.
+class KDTree
+{
+public:
+  typedef PolygonMesh::Vertex Vertex;
+
+  struct Neighbor
+  {
+    Neighbor(int _index = -1, Scalar _squared_distance = std::numeric_limits<Scalar>::infinity())
+      : index(_index), squared_distance(_squared_distance) {};
+
+    bool operator<(const Neighbor& rhs) const { return squared_distance < rhs.squared_distance; };
+
+    int    index;             // vertex or point index, -1 if there is none
+    Scalar squared_distance;
+  };
+
+  enum { LEAF_SIZE = 8 };
+
+public:
+  // tree over the vertex positions of mesh
+  explicit KDTree(const PolygonMesh& mesh);
+
+  // tree over any Vec3 vertex attribute of mesh
+  KDTree(const PolygonMesh& mesh, PolygonMesh::Vertex_attribute<Vec3> points);
+
+  // tree over points, indices are positions in the vector
+  explicit KDTree(const std::vector<Vec3>& points);
+
+  size_t size() const { return points_.size(); };
+
+  const BoundingBox& bounds() const { return bounds_; };
+
+public: //--- single queries, thread-safe
+
+  // closest point to p, index -1 if the tree is empty
+  Neighbor nearest(const Vec3& p) const;
+
+  // the k closest points to p, closest first
+  void knn(const Vec3& p, int k, std::vector<Neighbor>& result) const;
+
+  // all points within distance r of p, closest first if sorted
+  void radius(const Vec3& p, Scalar r, std::vector<Neighbor>& result, bool sorted = false) const;
+
+public: //--- batched queries, in parallel
+
+  // k neighbours of every query point: result[k * i ... k * i + k) for query
+  // i, padded with index -1 if the tree has less than k points
+  void knn(const std::vector<Vec3>& queries, int k, std::vector<Neighbor>& result) const;
+
+  // neighbours within r of every query point: result[offsets[i] ... offsets[i + 1])
+  // for query i, closest first if sorted
+  void radius(const std::vector<Vec3>& queries, Scalar r,
+              std::vector<int>& offsets, std::vector<Neighbor>& result, bool sorted = false) const;
+
+private:
+  struct Build_point
+  {
+    Vec3 point;
+    int  index;
+  };
+
+  void build(const std::vector<Vec3>& points);
+
+  // split [begin, end) of points recursively, cell is the box of the range
+  void build(std::vector<Build_point>& points, int begin, int end, BoundingBox cell, TaskGroup& group);
+
+  bool is_valid(int i) const
+  {
+    return mesh_ == NULL || !mesh_->is_deleted(Vertex(indices_[i]));
+  }
+
+  // search range [begin, end), heap is a max-heap of the k best so far
+  void knn(int begin, int end, const Vec3& p, size_t k, std::vector<Neighbor>& heap) const;
+
+  void radius(int begin, int end, const Vec3& p, Scalar r2, std::vector<Neighbor>& result) const;
+
+private:
+  const PolygonMesh*         mesh_;
+  BoundingBox                bounds_;
+  std::vector<Vec3>          points_;   // in tree order
+  std::vector<int>           indices_;  // original index of points_[i]
+  std::vector<unsigned char> axes_;     // split axis of the subtree with median i
+};
+
+}
+
+#endif // !LGMESH_KDTREE_H
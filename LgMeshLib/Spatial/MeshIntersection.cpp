@@ -0,0 +1,619 @@
+#include "MeshIntersection.h"
+#include "Parallel.h"
+#include "Predicates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace LG {
+
+namespace {
+
+typedef PolygonMesh::Vertex Vertex;
+
+// node pairs per thread the traversal is split into
+const size_t ITEMS_PER_THREAD = 64;
+
+// dominant axis of the normal of triangle t, the 2D predicates drop it
+int projection_axis(const Vec3 t[3])
+{
+  const Vec3 n = (t[1] - t[0]).cross(t[2] - t[0]);
+  const Vec3 a = n.cwiseAbs();
+  return (a[0] >= a[1] && a[0] >= a[2]) ? 0 : (a[1] >= a[2] ? 1 : 2);
+}
+
+// is c on the closed segment (a, b)? The three points are collinear.
+bool on_segment(const Vec3& a, const Vec3& b, const Vec3& c, int axis)
+{
+  for (int k = 0; k < 3; ++k)
+  {
+    if (k != axis && (c[k] < std::min(a[k], b[k]) || std::max(a[k], b[k]) < c[k]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// do the closed segments (a, b) and (c, d) intersect? All points lie in one plane.
+bool segments_intersect(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d, int axis)
+{
+  const int o1 = orient2d(a, b, c, axis), o2 = orient2d(a, b, d, axis);
+  const int o3 = orient2d(c, d, a, axis), o4 = orient2d(c, d, b, axis);
+  if (o1 * o2 < 0 && o3 * o4 < 0)
+  {
+    return true;
+  }
+  return (o1 == 0 && on_segment(a, b, c, axis)) || (o2 == 0 && on_segment(a, b, d, axis)) ||
+         (o3 == 0 && on_segment(c, d, a, axis)) || (o4 == 0 && on_segment(c, d, b, axis));
+}
+
+// is p in the closed triangle t? All points lie in one plane.
+bool point_in_triangle(const Vec3& p, const Vec3 t[3], int axis)
+{
+  const int s = orient2d(t[0], t[1], t[2], axis);
+  if (s == 0)
+  {
+    // degenerate triangle, the segments below decide
+    return false;
+  }
+  return s * orient2d(t[0], t[1], p, axis) >= 0 &&
+         s * orient2d(t[1], t[2], p, axis) >= 0 &&
+         s * orient2d(t[2], t[0], p, axis) >= 0;
+}
+
+// Does the closed segment (a, b) meet the closed triangle t? sa and sb are
+// the orientations of a and b with respect to the plane of t.
+bool segment_meets_triangle(const Vec3& a, const Vec3& b, int sa, int sb, const Vec3 t[3])
+{
+  if (sa * sb > 0)
+  {
+    return false;
+  }
+  if (sa == 0 && sb == 0)
+  {
+    // segment in the plane of t
+    const int axis = projection_axis(t);
+    return point_in_triangle(a, t, axis) || point_in_triangle(b, t, axis) ||
+           segments_intersect(a, b, t[0], t[1], axis) ||
+           segments_intersect(a, b, t[1], t[2], axis) ||
+           segments_intersect(a, b, t[2], t[0], axis);
+  }
+
+  // the segment crosses the plane, the line through it has to pass all
+  // three edges of t on the same side
+  const int s0 = orient3d(a, b, t[0], t[1]);
+  const int s1 = orient3d(a, b, t[1], t[2]);
+  const int s2 = orient3d(a, b, t[2], t[0]);
+  return (s0 >= 0 && s1 >= 0 && s2 >= 0) || (s0 <= 0 && s1 <= 0 && s2 <= 0);
+}
+
+// points where the boundary of t meets a plane; s are the exact orientations
+// of its vertices to the plane, which decide which vertices and edges count,
+// d the signed distances used to place the crossings. Returns the parameter
+// range along direction dir. t is neither on one side of nor in the plane,
+// so at least one point is found.
+void plane_crossing(const Vec3 t[3], const int s[3], const double d[3], const Eigen::Vector3d& dir,
+                    double& lo, double& hi, Vec3& lo_point, Vec3& hi_point)
+{
+  lo = std::numeric_limits<double>::max();
+  hi = -std::numeric_limits<double>::max();
+  lo_point = hi_point = t[0];
+  auto extend = [&](const Vec3& x)
+  {
+    const double v = dir.dot(x.cast<double>());
+    if (v < lo)
+    {
+      lo = v;
+      lo_point = x;
+    }
+    if (v > hi)
+    {
+      hi = v;
+      hi_point = x;
+    }
+  };
+
+  for (int k = 0; k < 3; ++k)
+  {
+    // vertex in the plane
+    if (s[k] == 0)
+    {
+      extend(t[k]);
+    }
+
+    // edge (k, l) crossing the plane
+    const int l = (k + 1) % 3;
+    if (s[k] * s[l] < 0)
+    {
+      // the distances may disagree with the predicates after rounding,
+      // keep the crossing on the edge
+      const double denominator = d[k] - d[l];
+      double lambda = (denominator != 0) ? d[k] / denominator : 0.5;
+      lambda = std::min(std::max(lambda, 0.0), 1.0);
+      extend(Vec3(t[k] + Scalar(lambda) * (t[l] - t[k])));
+    }
+  }
+}
+
+// intersection segment of two triangles known to intersect in a line, sp and
+// sq are the orientations of their vertices to the plane of the other one
+void intersection_segment(const Vec3 p[3], const Vec3 q[3], const int sp[3], const int sq[3], Vec3 segment[2])
+{
+  const Eigen::Vector3d np = (p[1] - p[0]).cast<double>().cross((p[2] - p[0]).cast<double>());
+  const Eigen::Vector3d nq = (q[1] - q[0]).cast<double>().cross((q[2] - q[0]).cast<double>());
+  double dp[3], dq[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    dp[k] = nq.dot((p[k] - q[0]).cast<double>());
+    dq[k] = np.dot((q[k] - p[0]).cast<double>());
+  }
+  const Eigen::Vector3d dir = np.cross(nq);
+
+  double lo_p, hi_p, lo_q, hi_q;
+  Vec3 lo_pp, hi_pp, lo_qp, hi_qp;
+  plane_crossing(p, sp, dp, dir, lo_p, hi_p, lo_pp, hi_pp);
+  plane_crossing(q, sq, dq, dir, lo_q, hi_q, lo_qp, hi_qp);
+  segment[0] = (lo_p >= lo_q) ? lo_pp : lo_qp;
+  segment[1] = (hi_p <= hi_q) ? hi_pp : hi_qp;
+  if (std::max(lo_p, lo_q) > std::min(hi_p, hi_q))
+  {
+    // rounding, the predicates found a (nearly) single point
+    segment[0] = segment[1] = Scalar(0.5) * (segment[0] + segment[1]);
+  }
+}
+
+// Test triangles p and q. shared[k] is the index of the vertex of q that
+// vertex k of p is identical to, -1 if none (self-intersections).
+bool intersect_triangles(const Vec3 p[3], const Vec3 q[3], const int shared[3], bool segments,
+                         Triangle_intersection& result)
+{
+  result.coplanar = false;
+  result.crossing[0] = result.crossing[1] = 0;
+
+  int n_shared = 0;
+  for (int k = 0; k < 3; ++k)
+  {
+    n_shared += (shared[k] >= 0);
+  }
+
+  if (n_shared == 3)
+  {
+    // faces on the same vertices
+    result.coplanar = true;
+    return true;
+  }
+
+  if (n_shared == 2)
+  {
+    // common edge (u, v): intersecting only if folded over in one plane
+    const int k = (shared[0] < 0) ? 0 : (shared[1] < 0 ? 1 : 2);
+    const Vec3& u = p[(k + 1) % 3];
+    const Vec3& v = p[(k + 2) % 3];
+    const Vec3& a = p[k];
+    const Vec3& b = q[3 - shared[(k + 1) % 3] - shared[(k + 2) % 3]];
+    if (orient3d(u, v, a, b) != 0)
+    {
+      return false;
+    }
+    const int axis = projection_axis(p);
+    const int sa = orient2d(u, v, a, axis), sb = orient2d(u, v, b, axis);
+    result.coplanar = true;
+    return sa != 0 && sa == sb;
+  }
+
+  // orientations of the vertices to the plane of the other triangle. A
+  // common vertex lies in both planes, which would always take the slow
+  // exact path of the predicate.
+  int sp[3] = { 0, 0, 0 }, sq[3] = { 0, 0, 0 };
+  bool q_shared[3] = { false, false, false };
+  for (int k = 0; k < 3; ++k)
+  {
+    if (shared[k] >= 0)
+    {
+      q_shared[shared[k]] = true;
+    }
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    if (!q_shared[k])
+    {
+      sq[k] = orient3d(p[0], p[1], p[2], q[k]);
+    }
+  }
+  if ((sq[0] > 0 && sq[1] > 0 && sq[2] > 0) || (sq[0] < 0 && sq[1] < 0 && sq[2] < 0))
+  {
+    return false;
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    if (shared[k] < 0)
+    {
+      sp[k] = orient3d(q[0], q[1], q[2], p[k]);
+    }
+  }
+  if ((sp[0] > 0 && sp[1] > 0 && sp[2] > 0) || (sp[0] < 0 && sp[1] < 0 && sp[2] < 0))
+  {
+    return false;
+  }
+
+  // The triangles intersect iff an edge of one meets the other. With a common
+  // vertex only the edges opposite to it count, the others contain it.
+  int shared_q = -1, shared_p = -1;
+  for (int k = 0; k < 3; ++k)
+  {
+    if (shared[k] >= 0)
+    {
+      shared_p = k;
+      shared_q = shared[k];
+    }
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    const int l = (k + 1) % 3;
+    if (n_shared == 0 || (k != shared_p && l != shared_p))
+    {
+      if (segment_meets_triangle(p[k], p[l], sp[k], sp[l], q))
+      {
+        result.crossing[0] |= (unsigned char)(1 << k);
+      }
+    }
+    if (n_shared == 0 || (k != shared_q && l != shared_q))
+    {
+      if (segment_meets_triangle(q[k], q[l], sq[k], sq[l], p))
+      {
+        result.crossing[1] |= (unsigned char)(1 << k);
+      }
+    }
+  }
+  if (result.crossing[0] == 0 && result.crossing[1] == 0)
+  {
+    return false;
+  }
+
+  result.coplanar = (sq[0] == 0 && sq[1] == 0 && sq[2] == 0) || (sp[0] == 0 && sp[1] == 0 && sp[2] == 0);
+  if (segments && !result.coplanar)
+  {
+    intersection_segment(p, q, sp, sq, result.segment);
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// A pair of subtrees: a node (count 0) or a leaf range of triangles
+struct Item
+{
+  int         a, a_count;
+  int         b, b_count;
+  BoundingBox a_box, b_box;
+
+  bool is_leaf_pair() const { return a_count > 0 && b_count > 0; };
+};
+
+struct Intersection_buffer
+{
+  std::vector<Item>                   stack;
+  std::vector<Triangle_intersection>  result;
+};
+
+class Traversal
+{
+public:
+  Traversal(const BVH& a, const BVH& b, bool self, bool segments)
+    : a_(a), b_(b), self_(self), segments_(segments) {};
+
+  // Item of the two roots
+  Item root() const
+  {
+    Item item;
+    item.a = item.b = 0;
+    item.a_count = item.b_count = 0;
+    item.a_box = a_.bounds();
+    item.b_box = b_.bounds();
+    return item;
+  }
+
+  // push the child pairs of an item with at least one inner node
+  void expand(const Item& item, std::vector<Item>& out) const
+  {
+    const bool diagonal = self_ && item.a == item.b && item.a_count == item.b_count;
+    if (diagonal)
+    {
+      // a subtree with itself: every unordered pair of children once
+      const BVH::Node& node = a_.nodes()[item.a];
+      for (int i = 0; i < 4; ++i)
+      {
+        if (node.is_empty(i))
+        {
+          continue;
+        }
+        const BoundingBox box_i = node.box(i);
+        for (int j = i; j < 4; ++j)
+        {
+          if (node.is_empty(j))
+          {
+            continue;
+          }
+          const BoundingBox box_j = node.box(j);
+          if (box_i.intersects(box_j))
+          {
+            out.push_back(make_item(node.child[i], node.count[i], box_i, node.child[j], node.count[j], box_j));
+          }
+        }
+      }
+      return;
+    }
+
+    // descend into the inner node with the larger box
+    const bool split_a = item.a_count == 0 && (item.b_count > 0 || item.a_box.area() >= item.b_box.area());
+    if (split_a)
+    {
+      const BVH::Node& node = a_.nodes()[item.a];
+      for (int i = 0; i < 4; ++i)
+      {
+        if (!node.is_empty(i))
+        {
+          const BoundingBox box = node.box(i);
+          if (box.intersects(item.b_box))
+          {
+            out.push_back(make_item(node.child[i], node.count[i], box, item.b, item.b_count, item.b_box));
+          }
+        }
+      }
+    }
+    else
+    {
+      const BVH::Node& node = b_.nodes()[item.b];
+      for (int j = 0; j < 4; ++j)
+      {
+        if (!node.is_empty(j))
+        {
+          const BoundingBox box = node.box(j);
+          if (box.intersects(item.a_box))
+          {
+            out.push_back(make_item(item.a, item.a_count, item.a_box, node.child[j], node.count[j], box));
+          }
+        }
+      }
+    }
+  }
+
+  // test all triangle pairs below item
+  void process(const Item& item, Intersection_buffer& buffer) const
+  {
+    std::vector<Item>& stack = buffer.stack;
+    stack.clear();
+    stack.reserve(256);
+    stack.push_back(item);
+    while (!stack.empty())
+    {
+      const Item top = stack.back();
+      stack.pop_back();
+      if (top.is_leaf_pair())
+      {
+        test_leaves(top, buffer.result);
+      }
+      else
+      {
+        expand(top, stack);
+      }
+    }
+  }
+
+private:
+  static Item make_item(int a, int a_count, const BoundingBox& a_box, int b, int b_count, const BoundingBox& b_box)
+  {
+    Item item;
+    item.a = a;
+    item.a_count = a_count;
+    item.a_box = a_box;
+    item.b = b;
+    item.b_count = b_count;
+    item.b_box = b_box;
+    return item;
+  }
+
+  void load(const BVH& bvh, int t, Vec3 points[3], BoundingBox& box) const
+  {
+    const std::vector<Vec3>& mesh_points = bvh.mesh()->points();
+    const BVH::Triangle& tri = bvh.triangle(t);
+    box = BoundingBox();
+    for (int k = 0; k < 3; ++k)
+    {
+      points[k] = mesh_points[tri.vertices[k].idx()];
+      box.extend(points[k]);
+    }
+  }
+
+  void test_leaves(const Item& item, std::vector<Triangle_intersection>& result) const
+  {
+    const bool diagonal = self_ && item.a == item.b;
+    for (int t = item.a; t < item.a + item.a_count; ++t)
+    {
+      Vec3 p[3];
+      BoundingBox p_box;
+      load(a_, t, p, p_box);
+      if (!p_box.intersects(item.b_box))
+      {
+        continue;
+      }
+      const BVH::Triangle& tp = a_.triangle(t);
+
+      for (int u = diagonal ? t + 1 : item.b; u < item.b + item.b_count; ++u)
+      {
+        const BVH::Triangle& tq = b_.triangle(u);
+        if (self_ && tp.face == tq.face)
+        {
+          continue;
+        }
+        Vec3 q[3];
+        BoundingBox q_box;
+        load(b_, u, q, q_box);
+        if (!p_box.intersects(q_box))
+        {
+          continue;
+        }
+
+        int shared[3] = { -1, -1, -1 };
+        if (self_)
+        {
+          for (int k = 0; k < 3; ++k)
+          {
+            for (int l = 0; l < 3; ++l)
+            {
+              if (tp.vertices[k] == tq.vertices[l])
+              {
+                shared[k] = l;
+              }
+            }
+          }
+        }
+
+        Triangle_intersection x;
+        if (intersect_triangles(p, q, shared, segments_, x))
+        {
+          x.triangle[0] = t;
+          x.triangle[1] = u;
+          x.face[0] = tp.face;
+          x.face[1] = tq.face;
+          if (self_ && u < t)
+          {
+            std::swap(x.triangle[0], x.triangle[1]);
+            std::swap(x.face[0], x.face[1]);
+            std::swap(x.crossing[0], x.crossing[1]);
+          }
+          result.push_back(x);
+        }
+      }
+    }
+  }
+
+private:
+  const BVH& a_;
+  const BVH& b_;
+  bool       self_;
+  bool       segments_;
+};
+
+bool triangle_order(const Triangle_intersection& x, const Triangle_intersection& y)
+{
+  return x.triangle[0] < y.triangle[0] || (x.triangle[0] == y.triangle[0] && x.triangle[1] < y.triangle[1]);
+}
+
+void run(const Traversal& traversal, std::vector<Triangle_intersection>& result)
+{
+  // expand the top of the traversal breadth-first into independent items
+  const size_t n_items = ITEMS_PER_THREAD * parallel_thread_count();
+  std::vector<Item> items(1, traversal.root()), next;
+  bool expanded = true;
+  while (items.size() < n_items && expanded)
+  {
+    next.clear();
+    expanded = false;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+      if (items[i].is_leaf_pair())
+      {
+        next.push_back(items[i]);
+      }
+      else
+      {
+        traversal.expand(items[i], next);
+        expanded = true;
+      }
+    }
+    items.swap(next);
+  }
+
+  Thread_local_storage<Intersection_buffer> buffers;
+  parallel_for(0, items.size(), 1, [&](size_t first, size_t last)
+  {
+    Intersection_buffer& buffer = buffers.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      traversal.process(items[i], buffer);
+    }
+  });
+
+  buffers.for_each([&](Intersection_buffer& buffer)
+  {
+    result.insert(result.end(), buffer.result.begin(), buffer.result.end());
+  });
+  std::sort(result.begin(), result.end(), triangle_order);
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void intersect(const BVH& a, const BVH& b, std::vector<Triangle_intersection>& result, bool segments)
+{
+  result.clear();
+  if (a.empty() || b.empty() || !a.bounds().intersects(b.bounds()))
+  {
+    return;
+  }
+  run(Traversal(a, b, false, segments), result);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void self_intersect(const BVH& bvh, std::vector<Triangle_intersection>& result, bool segments)
+{
+  result.clear();
+  if (bvh.empty())
+  {
+    return;
+  }
+  run(Traversal(bvh, bvh, true, segments), result);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void mark_intersections(PolygonMesh& mesh, const BVH& bvh,
+                        const std::vector<Triangle_intersection>& intersections, int side)
+{
+  PolygonMesh::Face_attribute<bool> faces = mesh.face_attribute<bool>("f:intersecting");
+  PolygonMesh::Edge_attribute<bool> edges = mesh.edge_attribute<bool>("e:intersecting");
+  std::fill(faces.vector().begin(), faces.vector().end(), false);
+  std::fill(edges.vector().begin(), edges.vector().end(), false);
+
+  for (size_t i = 0; i < intersections.size(); ++i)
+  {
+    const Triangle_intersection& x = intersections[i];
+    for (int s = 0; s < 2; ++s)
+    {
+      if (side >= 0 && side != s)
+      {
+        continue;
+      }
+      faces[x.face[s]] = true;
+
+      // fan diagonals are no mesh edges
+      const BVH::Triangle& tri = bvh.triangle(x.triangle[s]);
+      for (int k = 0; k < 3; ++k)
+      {
+        if (x.crossing[s] & (1 << k))
+        {
+          const PolygonMesh::Edge e = mesh.find_edge(tri.vertices[k], tri.vertices[(k + 1) % 3]);
+          if (e.is_valid())
+          {
+            edges[e] = true;
+          }
+        }
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef LGMESH_MESHINTERSECTION_H
+#define LGMESH_MESHINTERSECTION_H
+
+#include "BVH.h"
+
+#include <vector>
+
+namespace LG {
+
+// Pair of intersecting triangles of the fan triangulations of two BVHs (or of
+// one BVH with itself)
+struct Triangle_intersection
+{
+  typedef PolygonMesh::Face Face;
+
+  int           triangle[2];  // indices into BVH::triangles() of the first / second tree
+  Face          face[2];
+  bool          coplanar;     // the triangles overlap in a common plane
+
+  // bit k is set if edge (vertices[k], vertices[(k + 1) % 3]) of triangle[i]
+  // meets the other triangle
+  unsigned char crossing[2];
+
+  // intersection segment, only computed on request and not for coplanar pairs
+  Vec3          segment[2];
+};
+
+// Intersection detection between triangle meshes.
+//
+// Both BVHs are traversed simultaneously; the top levels of the traversal are
+// expanded serially into independent node pairs which are then processed in
+// parallel. Triangle pairs in overlapping leaves are tested with orientation
+// predicates only (see Predicates.h): the double precision filter decides
+// almost all cases and the rare degenerate ones fall back to exact
+// arithmetic, so touching, coplanar and nearly parallel triangles are
+// classified consistently.
+//
+// The results are sorted by triangle indices. Faces with more than three
+// vertices may appear in several pairs, one per intersecting fan triangle.
+
+// all intersecting triangle pairs of a and b
+void intersect(const BVH& a, const BVH& b, std::vector<Triangle_intersection>& result,
+               bool segments = false);
+
+// all intersecting pairs of triangles of different faces of one mesh, with
+// triangle[0] < triangle[1]. Faces sharing an edge only intersect if they fold
+// over each other in a common plane, faces sharing a vertex only if they meet
+// anywhere else.
+void self_intersect(const BVH& bvh, std::vector<Triangle_intersection>& result,
+                    bool segments = false);
+
+// Store the intersections of the mesh of bvh in the bool attributes
+// "f:intersecting" (faces of the pairs) and "e:intersecting" (mesh edges
+// crossing the other triangle); all other elements are set to false. side is
+// 0 or 1 to take the first or second triangle of every pair, -1 for both
+// (self-intersections).
+void mark_intersections(PolygonMesh& mesh, const BVH& bvh,
+                        const std::vector<Triangle_intersection>& intersections, int side);
+
+}
+
+#endif // !LGMESH_MESHINTERSECTION_H
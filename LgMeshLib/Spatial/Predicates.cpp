@@ -0,0 +1,171 @@
+#include "Predicates.h"
+
+#include <cmath>
+
+namespace LG {
+
+namespace {
+
+const double EPSILON = 1.1102230246251565e-16;  // 2^-53
+
+// error bounds of the static filters, Shewchuk, Adaptive Precision Floating-
+// Point Arithmetic and Fast Robust Geometric Predicates, 1997
+const double ORIENT2D_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+const double ORIENT3D_BOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+
+// The exact fallback sums determinant terms into an expansion: a sum of
+// doubles ordered by increasing magnitude whose components do not overlap,
+// so its sign is the sign of the largest (last) component.
+
+// a + b = x + y exactly
+inline void two_sum(double a, double b, double& x, double& y)
+{
+  x = a + b;
+  const double bv = x - a;
+  const double av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+// a * b = x + y exactly
+inline void two_product(double a, double b, double& x, double& y)
+{
+  x = a * b;
+  y = std::fma(a, b, -x);
+}
+
+// Add b to the expansion e of length n in place and return the new length,
+// zero components are dropped (GROW-EXPANSION with zero elimination)
+int grow_expansion(double* e, int n, double b)
+{
+  double q = b;
+  int m = 0;
+  for (int i = 0; i < n; ++i)
+  {
+    double h;
+    two_sum(q, e[i], q, h);
+    if (h != 0)
+    {
+      e[m++] = h;
+    }
+  }
+  if (q != 0)
+  {
+    e[m++] = q;
+  }
+  return m;
+}
+
+// add sign * p * q * r to the expansion e exactly
+int add_product(double* e, int n, double sign, double p, double q, double r)
+{
+  double pq, pq_error;
+  two_product(sign * p, q, pq, pq_error);
+  double x, y;
+  two_product(pq, r, x, y);
+  n = grow_expansion(e, n, y);
+  n = grow_expansion(e, n, x);
+  two_product(pq_error, r, x, y);
+  n = grow_expansion(e, n, y);
+  n = grow_expansion(e, n, x);
+  return n;
+}
+
+int sign(double x)
+{
+  return (x > 0) ? 1 : ((x < 0) ? -1 : 0);
+}
+
+// sign * det[p; q; r] of the untranslated coordinates, added to e
+int add_det3(double* e, int n, double s, const Vec3& p, const Vec3& q, const Vec3& r)
+{
+  n = add_product(e, n,  s, p[0], q[1], r[2]);
+  n = add_product(e, n, -s, p[0], q[2], r[1]);
+  n = add_product(e, n,  s, p[1], q[2], r[0]);
+  n = add_product(e, n, -s, p[1], q[0], r[2]);
+  n = add_product(e, n,  s, p[2], q[0], r[1]);
+  n = add_product(e, n, -s, p[2], q[1], r[0]);
+  return n;
+}
+
+// det[b - a; c - a; d - a] = det(b, c, d) - det(a, c, d) + det(a, b, d) - det(a, b, c)
+int orient3d_exact(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d)
+{
+  // 24 products of at most 4 components each
+  double e[100];
+  int n = 0;
+  n = add_det3(e, n,  1, b, c, d);
+  n = add_det3(e, n, -1, a, c, d);
+  n = add_det3(e, n,  1, a, b, d);
+  n = add_det3(e, n, -1, a, b, c);
+  return (n > 0) ? sign(e[n - 1]) : 0;
+}
+
+// det[b - a; c - a] = det(b, c) - det(a, c) + det(a, b) in coordinates i, j
+int orient2d_exact(const Vec3& a, const Vec3& b, const Vec3& c, int i, int j)
+{
+  double e[26];
+  int n = 0;
+  const Vec3* p[3][2] = { { &b, &c }, { &c, &a }, { &a, &b } };
+  for (int k = 0; k < 3; ++k)
+  {
+    const Vec3& u = *p[k][0];
+    const Vec3& v = *p[k][1];
+    double x, y;
+    two_product(u[i], v[j], x, y);
+    n = grow_expansion(e, n, y);
+    n = grow_expansion(e, n, x);
+    two_product(-u[j], v[i], x, y);
+    n = grow_expansion(e, n, y);
+    n = grow_expansion(e, n, x);
+  }
+  return (n > 0) ? sign(e[n - 1]) : 0;
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int orient3d(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d)
+{
+  const double ux = double(b[0]) - a[0], uy = double(b[1]) - a[1], uz = double(b[2]) - a[2];
+  const double vx = double(c[0]) - a[0], vy = double(c[1]) - a[1], vz = double(c[2]) - a[2];
+  const double wx = double(d[0]) - a[0], wy = double(d[1]) - a[1], wz = double(d[2]) - a[2];
+
+  const double vxwy = vx * wy, wxvy = wx * vy;
+  const double wxuy = wx * uy, uxwy = ux * wy;
+  const double uxvy = ux * vy, vxuy = vx * uy;
+  const double det = uz * (vxwy - wxvy) + vz * (wxuy - uxwy) + wz * (uxvy - vxuy);
+
+  const double permanent = std::fabs(uz) * (std::fabs(vxwy) + std::fabs(wxvy))
+                         + std::fabs(vz) * (std::fabs(wxuy) + std::fabs(uxwy))
+                         + std::fabs(wz) * (std::fabs(uxvy) + std::fabs(vxuy));
+  const double bound = ORIENT3D_BOUND * permanent;
+  if (det > bound || -det > bound)
+  {
+    return sign(det);
+  }
+  return orient3d_exact(a, b, c, d);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int orient2d(const Vec3& a, const Vec3& b, const Vec3& c, int axis)
+{
+  const int i = (axis + 1) % 3, j = (axis + 2) % 3;
+  const double left  = (double(b[i]) - a[i]) * (double(c[j]) - a[j]);
+  const double right = (double(b[j]) - a[j]) * (double(c[i]) - a[i]);
+  const double det = left - right;
+
+  const double bound = ORIENT2D_BOUND * (std::fabs(left) + std::fabs(right));
+  if (det > bound || -det > bound)
+  {
+    return sign(det);
+  }
+  return orient2d_exact(a, b, c, i, j);
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef LGMESH_PREDICATES_H
+#define LGMESH_PREDICATES_H
+
+#include "LgMeshTypes.h"
+
+namespace LG {
+
+// Robust orientation predicates.
+//
+// The determinants are evaluated in double precision first and accepted if
+// their magnitude exceeds the forward error bound of Shewchuk's static
+// filter. Only the remaining nearly degenerate cases are recomputed exactly
+// with floating point expansions, so the returned signs are exact for any
+// input while the common case costs a few multiplications.
+
+// sign of ((b - a) x (c - a)) . (d - a): +1 if d lies on the side of the plane
+// through a, b, c the normal of the counterclockwise triangle points to,
+// -1 on the other side and 0 if the four points are coplanar
+int orient3d(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d);
+
+// sign of the 2D orientation of a, b, c after dropping coordinate axis:
+// +1 if they turn counterclockwise in the plane of the two other
+// coordinates (in cyclic order), -1 if clockwise, 0 if collinear
+int orient2d(const Vec3& a, const Vec3& b, const Vec3& c, int axis);
+
+}
+
+#endif // !LGMESH_PREDICATES_H
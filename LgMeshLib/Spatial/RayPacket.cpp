@@ -0,0 +1,467 @@
+#include "RayPacket.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+
+namespace LG {
+
+namespace {
+
+const int N = Ray_packet::SIZE;
+
+const int STACK_SIZE = 512;
+
+// spread the lower 10 bits of x to every third bit
+inline uint64_t spread_bits(uint64_t x)
+{
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x30000ff;
+  x = (x | (x << 8))  & 0x300f00f;
+  x = (x | (x << 4))  & 0x30c30c3;
+  x = (x | (x << 2))  & 0x9249249;
+  return x;
+}
+
+// Morton code of p quantized to `bits` bits per axis inside [lo, hi]
+inline uint64_t morton_code(const Vec3& p, const Vec3& lo, const Vec3& hi, int bits)
+{
+  const Scalar cells = Scalar((1 << bits) - 1);
+  uint64_t code = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    const Scalar extent = hi[i] - lo[i];
+    Scalar x = extent > 0 ? (p[i] - lo[i]) / extent : 0;
+    x = std::max(Scalar(0), std::min(x, Scalar(1)));
+    code |= spread_bits(uint64_t(x * cells)) << i;
+  }
+  return code;
+}
+
+// LSD radix sort of (key, value) pairs on the lower `bits` bits of the keys
+void radix_sort(std::vector< std::pair<uint64_t, int> >& items, int bits)
+{
+  const int DIGIT = 11;
+  std::vector< std::pair<uint64_t, int> > buffer(items.size());
+  std::vector<size_t> offsets(size_t(1) << DIGIT);
+  for (int shift = 0; shift < bits; shift += DIGIT)
+  {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+      ++offsets[(items[i].first >> shift) & ((1 << DIGIT) - 1)];
+    }
+    size_t sum = 0;
+    for (size_t d = 0; d < offsets.size(); ++d)
+    {
+      const size_t n = offsets[d];
+      offsets[d] = sum;
+      sum += n;
+    }
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+      buffer[offsets[(items[i].first >> shift) & ((1 << DIGIT) - 1)]++] = items[i];
+    }
+    items.swap(buffer);
+  }
+}
+
+// Per-lane data of a packet during traversal. The watertight shear and axis
+// permutation of every ray is stored as three rows of a 3x3 matrix, so the
+// triangle test is the same arithmetic for all lanes.
+struct Packet_state
+{
+  Scalar ox[N], oy[N], oz[N];
+  Scalar ix[N], iy[N], iz[N];
+  Scalar tmin[N], tmax[N];
+  Scalar row_x[3][N], row_y[3][N], row_z[3][N];
+
+  explicit Packet_state(const Ray_packet& rays)
+  {
+    for (int i = 0; i < N; ++i)
+    {
+      const bool active = i < rays.n_rays && rays.tmin[i] <= rays.tmax[i];
+      const Vec3 d(rays.direction_x[i], rays.direction_y[i], rays.direction_z[i]);
+      ox[i] = rays.origin_x[i];
+      oy[i] = rays.origin_y[i];
+      oz[i] = rays.origin_z[i];
+      const Vec3 inv = safe_inverse(active ? d : Vec3(1, 1, 1));
+      ix[i] = inv[0];
+      iy[i] = inv[1];
+      iz[i] = inv[2];
+
+      // inactive lanes get an empty interval, their boxes never hit
+      tmin[i] = active ? rays.tmin[i] :  std::numeric_limits<Scalar>::infinity();
+      tmax[i] = active ? rays.tmax[i] : -std::numeric_limits<Scalar>::infinity();
+
+      const Watertight_ray w(Vec3::Zero(), active ? d : Vec3(0, 0, 1));
+      for (int k = 0; k < 3; ++k)
+      {
+        row_x[k][i] = (k == w.kx ? Scalar(1) : Scalar(0)) - (k == w.kz ? w.sx : Scalar(0));
+        row_y[k][i] = (k == w.ky ? Scalar(1) : Scalar(0)) - (k == w.kz ? w.sy : Scalar(0));
+        row_z[k][i] = (k == w.kz ? w.sz : Scalar(0));
+      }
+    }
+  }
+};
+
+// test triangle t against all lanes, records closer hits
+inline void intersect_triangle(const BVH& bvh, const std::vector<Vec3>& points, int t,
+                               const Ray_packet& rays, Packet_state& s, Packet_hits& hits)
+{
+  const BVH::Triangle& tri = bvh.triangle(t);
+  const Vec3& a = points[tri.vertices[0].idx()];
+  const Vec3& b = points[tri.vertices[1].idx()];
+  const Vec3& c = points[tri.vertices[2].idx()];
+
+  int exact[N];
+  int hit[N];
+  Scalar hit_u[N], hit_v[N], hit_t[N];
+  for (int i = 0; i < N; ++i)
+  {
+    const Scalar A0 = a[0] - s.ox[i], A1 = a[1] - s.oy[i], A2 = a[2] - s.oz[i];
+    const Scalar B0 = b[0] - s.ox[i], B1 = b[1] - s.oy[i], B2 = b[2] - s.oz[i];
+    const Scalar C0 = c[0] - s.ox[i], C1 = c[1] - s.oy[i], C2 = c[2] - s.oz[i];
+
+    const Scalar ax = s.row_x[0][i] * A0 + s.row_x[1][i] * A1 + s.row_x[2][i] * A2;
+    const Scalar ay = s.row_y[0][i] * A0 + s.row_y[1][i] * A1 + s.row_y[2][i] * A2;
+    const Scalar az = s.row_z[0][i] * A0 + s.row_z[1][i] * A1 + s.row_z[2][i] * A2;
+    const Scalar bx = s.row_x[0][i] * B0 + s.row_x[1][i] * B1 + s.row_x[2][i] * B2;
+    const Scalar by = s.row_y[0][i] * B0 + s.row_y[1][i] * B1 + s.row_y[2][i] * B2;
+    const Scalar bz = s.row_z[0][i] * B0 + s.row_z[1][i] * B1 + s.row_z[2][i] * B2;
+    const Scalar cx = s.row_x[0][i] * C0 + s.row_x[1][i] * C1 + s.row_x[2][i] * C2;
+    const Scalar cy = s.row_y[0][i] * C0 + s.row_y[1][i] * C1 + s.row_y[2][i] * C2;
+    const Scalar cz = s.row_z[0][i] * C0 + s.row_z[1][i] * C1 + s.row_z[2][i] * C2;
+
+    const Scalar u = cx * by - cy * bx;
+    const Scalar v = ax * cy - ay * cx;
+    const Scalar w = bx * ay - by * ax;
+    const Scalar det = u + v + w;
+    const Scalar d = (u * az + v * bz + w * cz) / det;
+
+    // bitwise operators keep the loop free of branches
+    const int outside = ((u < 0) | (v < 0) | (w < 0)) & ((u > 0) | (v > 0) | (w > 0));
+    hit[i]   = (outside ^ 1) & (det != 0) & (d >= s.tmin[i]) & (d <= s.tmax[i]);
+    hit_u[i] = v / det;
+    hit_v[i] = w / det;
+    hit_t[i] = d;
+    exact[i] = ((u == 0) | (v == 0) | (w == 0)) & (s.tmin[i] <= s.tmax[i]);
+  }
+
+  // edge functions that vanished in float are redone in double
+  for (int i = 0; i < N; ++i)
+  {
+    if (!exact[i])
+    {
+      continue;
+    }
+    const BVH::Ray ray = rays.ray(i);
+    Vec3 barycentric;
+    hit[i] = intersect_watertight(Watertight_ray(ray.origin, ray.direction), a, b, c,
+                                  s.tmin[i], s.tmax[i], hit_t[i], barycentric);
+    // barycentric is only written on a hit
+    if (hit[i])
+    {
+      hit_u[i] = barycentric[1];
+      hit_v[i] = barycentric[2];
+    }
+  }
+
+  const int face = tri.face.idx();
+  for (int i = 0; i < N; ++i)
+  {
+    s.tmax[i]        = hit[i] ? hit_t[i] : s.tmax[i];
+    hits.face[i]     = hit[i] ? face     : hits.face[i];
+    hits.triangle[i] = hit[i] ? t        : hits.triangle[i];
+    hits.u[i]        = hit[i] ? hit_u[i] : hits.u[i];
+    hits.v[i]        = hit[i] ? hit_v[i] : hits.v[i];
+    hits.t[i]        = hit[i] ? hit_t[i] : hits.t[i];
+  }
+}
+
+template <bool ANY_HIT>
+void trace(const BVH& bvh, const Ray_packet& rays, Packet_hits& hits)
+{
+  for (int i = 0; i < N; ++i)
+  {
+    hits.face[i]     = -1;
+    hits.triangle[i] = -1;
+  }
+  if (bvh.empty())
+  {
+    return;
+  }
+
+  const std::vector<BVH::Node>& nodes = bvh.nodes();
+  const std::vector<Vec3>& points = bvh.mesh()->points();
+  Packet_state s(rays);
+
+  int stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0)
+  {
+    const BVH::Node& node = nodes[stack[--top]];
+
+    // every child against all rays, the lane loop has no dependencies
+    // between iterations and is vectorized, the reduction is done afterwards
+    int    any[4];
+    Scalar tnear[4];
+    for (int c = 0; c < 4; ++c)
+    {
+      Scalar lane_t[N];
+      for (int i = 0; i < N; ++i)
+      {
+        const Scalar tx0 = (node.min_x[c] - s.ox[i]) * s.ix[i], tx1 = (node.max_x[c] - s.ox[i]) * s.ix[i];
+        const Scalar ty0 = (node.min_y[c] - s.oy[i]) * s.iy[i], ty1 = (node.max_y[c] - s.oy[i]) * s.iy[i];
+        const Scalar tz0 = (node.min_z[c] - s.oz[i]) * s.iz[i], tz1 = (node.max_z[c] - s.oz[i]) * s.iz[i];
+        const Scalar t0 = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), s.tmin[i]));
+        const Scalar t1 = std::min(ROBUST_FAR_SCALE * std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1)), s.tmax[i]);
+        lane_t[i] = t0 <= t1 ? t0 : std::numeric_limits<Scalar>::infinity();
+      }
+      Scalar near = lane_t[0];
+      for (int i = 1; i < N; ++i)
+      {
+        near = std::min(near, lane_t[i]);
+      }
+      any[c]   = near < std::numeric_limits<Scalar>::infinity() && node.child[c] != BVH::EMPTY;
+      tnear[c] = near;
+    }
+
+    int order[4], n_inner = 0;
+    for (int c = 0; c < 4; ++c)
+    {
+      if (!any[c])
+      {
+        continue;
+      }
+      if (node.count[c] > 0)
+      {
+        for (int t = node.child[c], end = t + node.count[c]; t < end; ++t)
+        {
+          intersect_triangle(bvh, points, t, rays, s, hits);
+        }
+        if (ANY_HIT)
+        {
+          // lanes with a hit are done
+          int n_active = 0;
+          for (int i = 0; i < N; ++i)
+          {
+            s.tmax[i] = hits.face[i] >= 0 ? -std::numeric_limits<Scalar>::infinity() : s.tmax[i];
+            n_active += s.tmin[i] <= s.tmax[i];
+          }
+          if (n_active == 0)
+          {
+            return;
+          }
+        }
+      }
+      else
+      {
+        int j = n_inner++;
+        for (; j > 0 && tnear[order[j - 1]] < tnear[c]; --j)
+        {
+          order[j] = order[j - 1];
+        }
+        order[j] = c;
+      }
+    }
+    for (int j = 0; j < n_inner; ++j)
+    {
+      assert(top < STACK_SIZE);
+      stack[top++] = node.child[order[j]];
+    }
+  }
+}
+
+// Do the rays of the packet point into similar directions? Diverging rays
+// visit disjoint parts of the tree, then single-ray traversal is faster.
+bool is_coherent(const Ray_packet& rays)
+{
+  const Scalar min_cosine = Scalar(0.9);
+  Vec3 d[N];
+  Vec3 mean = Vec3::Zero();
+  for (int i = 0; i < rays.n_rays; ++i)
+  {
+    d[i] = Vec3(rays.direction_x[i], rays.direction_y[i], rays.direction_z[i]);
+    const Scalar norm = d[i].norm();
+    if (norm > 0)
+    {
+      d[i] /= norm;
+    }
+    mean += d[i];
+  }
+  mean.normalize();
+  for (int i = 0; i < rays.n_rays; ++i)
+  {
+    if (d[i].dot(mean) < min_cosine)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// trace the rays of a packet one by one
+template <bool ANY_HIT>
+void trace_single(const BVH& bvh, const Ray_packet& rays, Packet_hits& hits)
+{
+  for (int i = 0; i < N; ++i)
+  {
+    hits.face[i]     = -1;
+    hits.triangle[i] = -1;
+  }
+  for (int i = 0; i < rays.n_rays; ++i)
+  {
+    const BVH::Ray ray = rays.ray(i);
+    BVH::Hit hit;
+    if (ANY_HIT ? bvh.occluded(ray, &hit) : bvh.intersect(ray, hit))
+    {
+      hits.face[i]     = hit.face.idx();
+      hits.triangle[i] = hit.triangle;
+      hits.u[i]        = hit.barycentric[1];
+      hits.v[i]        = hit.barycentric[2];
+      hits.t[i]        = hit.distance;
+    }
+  }
+}
+
+template <bool ANY_HIT>
+void trace(const BVH& bvh, Ray_stream& stream)
+{
+  const size_t n = stream.size();
+  stream.face.resize(n);
+  stream.triangle.resize(n);
+  stream.u.resize(n);
+  stream.v.resize(n);
+  stream.t.resize(n);
+  if (n == 0)
+  {
+    return;
+  }
+
+  // sort key: direction octant, then origin, then direction
+  std::vector< std::pair<uint64_t, int> > order(n);
+  const Vec3 lo = bvh.bounds().min(), hi = bvh.bounds().max();
+  parallel_for(0, n, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Vec3 d(stream.direction_x[i], stream.direction_y[i], stream.direction_z[i]);
+      const uint64_t octant = (d[0] < 0 ? 1 : 0) | (d[1] < 0 ? 2 : 0) | (d[2] < 0 ? 4 : 0);
+      const Scalar norm = d.norm();
+      if (norm > 0)
+      {
+        d /= norm;
+      }
+      const Vec3 o(stream.origin_x[i], stream.origin_y[i], stream.origin_z[i]);
+      const uint64_t key = (octant << 48) | (morton_code(o, lo, hi, 10) << 18)
+                         | morton_code(d, Vec3(-1, -1, -1), Vec3(1, 1, 1), 6);
+      order[i] = std::make_pair(key, (int)i);
+    }
+  });
+  radix_sort(order, 51);
+
+  const size_t n_packets = (n + N - 1) / N;
+  parallel_for(0, n_packets, 16, [&](size_t first, size_t last)
+  {
+    Ray_packet rays;
+    Packet_hits hits;
+    for (size_t p = first; p < last; ++p)
+    {
+      const size_t begin = p * N, end = std::min(begin + N, n);
+      rays.n_rays = int(end - begin);
+      for (int i = 0; i < N; ++i)
+      {
+        // pad with copies of the first ray, they are inactive anyway
+        const int r = order[begin + (i < rays.n_rays ? i : 0)].second;
+        rays.origin_x[i]    = stream.origin_x[r];
+        rays.origin_y[i]    = stream.origin_y[r];
+        rays.origin_z[i]    = stream.origin_z[r];
+        rays.direction_x[i] = stream.direction_x[r];
+        rays.direction_y[i] = stream.direction_y[r];
+        rays.direction_z[i] = stream.direction_z[r];
+        rays.tmin[i]        = stream.tmin[r];
+        rays.tmax[i]        = stream.tmax[r];
+      }
+
+      if (is_coherent(rays))
+      {
+        trace<ANY_HIT>(bvh, rays, hits);
+      }
+      else
+      {
+        trace_single<ANY_HIT>(bvh, rays, hits);
+      }
+
+      for (int i = 0; i < rays.n_rays; ++i)
+      {
+        const int r = order[begin + i].second;
+        stream.face[r]     = hits.face[i];
+        stream.triangle[r] = hits.triangle[i];
+        stream.u[r]        = hits.u[i];
+        stream.v[r]        = hits.v[i];
+        stream.t[r]        = hits.t[i];
+      }
+    }
+  });
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Ray_stream::resize(size_t n)
+{
+  origin_x.resize(n);    origin_y.resize(n);    origin_z.resize(n);
+  direction_x.resize(n); direction_y.resize(n); direction_z.resize(n);
+  tmin.resize(n, 0);
+  tmax.resize(n, std::numeric_limits<Scalar>::infinity());
+  face.resize(n);
+  triangle.resize(n);
+  u.resize(n);
+  v.resize(n);
+  t.resize(n);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void intersect(const BVH& bvh, const Ray_packet& rays, Packet_hits& hits)
+{
+  trace<false>(bvh, rays, hits);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void occluded(const BVH& bvh, const Ray_packet& rays, Packet_hits& hits)
+{
+  trace<true>(bvh, rays, hits);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void intersect(const BVH& bvh, Ray_stream& stream)
+{
+  trace<false>(bvh, stream);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void occluded(const BVH& bvh, Ray_stream& stream)
+{
+  trace<true>(bvh, stream);
+}
+
+}
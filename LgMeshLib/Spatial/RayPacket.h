@@ -0,0 +1,100 @@
+#ifndef LGMESH_RAYPACKET_H
+#define LGMESH_RAYPACKET_H
+
+#include "BVH.h"
+
+#include <vector>
+
+namespace LG {
+
+// Coherent ray queries on a BVH.
+//
+// The rays of a packet traverse the tree together: every node and triangle
+// is fetched once per packet and tested against all rays in branch-free
+// loops over the lanes, which the compiler turns into SSE/AVX code (8 floats
+// fill one AVX register when the library is built with -mavx2). Triangles
+// are tested with the watertight algorithm, like BVH::intersect().
+//
+// Large streams are sorted by direction octant, origin and direction into
+// coherent packets, which are traced in parallel on the ThreadPool.
+struct Ray_packet
+{
+  enum { SIZE = 8 };
+
+  Ray_packet() : n_rays(0) {}
+
+  // set lane i; lanes >= n_rays are inactive
+  void set(int i, const BVH::Ray& ray)
+  {
+    origin_x[i]    = ray.origin[0];    origin_y[i]    = ray.origin[1];    origin_z[i]    = ray.origin[2];
+    direction_x[i] = ray.direction[0]; direction_y[i] = ray.direction[1]; direction_z[i] = ray.direction[2];
+    tmin[i] = ray.tmin;
+    tmax[i] = ray.tmax;
+  }
+
+  BVH::Ray ray(int i) const
+  {
+    return BVH::Ray(Vec3(origin_x[i], origin_y[i], origin_z[i]),
+                    Vec3(direction_x[i], direction_y[i], direction_z[i]), tmin[i], tmax[i]);
+  }
+
+  Scalar origin_x[SIZE],    origin_y[SIZE],    origin_z[SIZE];
+  Scalar direction_x[SIZE], direction_y[SIZE], direction_z[SIZE];
+  Scalar tmin[SIZE],        tmax[SIZE];
+  int    n_rays;
+};
+
+// Hits of a packet: the face (-1 for a miss), the fan triangle of the BVH,
+// the barycentric weights u, v of the second and third triangle vertex and
+// the ray parameter t
+struct Packet_hits
+{
+  int    face[Ray_packet::SIZE];
+  int    triangle[Ray_packet::SIZE];
+  Scalar u[Ray_packet::SIZE];
+  Scalar v[Ray_packet::SIZE];
+  Scalar t[Ray_packet::SIZE];
+};
+
+// Any number of rays and their hits, one array per component
+struct Ray_stream
+{
+  size_t size() const { return origin_x.size(); };
+
+  // resize the ray and the hit arrays
+  void resize(size_t n);
+
+  void set(size_t i, const BVH::Ray& ray)
+  {
+    origin_x[i]    = ray.origin[0];    origin_y[i]    = ray.origin[1];    origin_z[i]    = ray.origin[2];
+    direction_x[i] = ray.direction[0]; direction_y[i] = ray.direction[1]; direction_z[i] = ray.direction[2];
+    tmin[i] = ray.tmin;
+    tmax[i] = ray.tmax;
+  }
+
+  // rays
+  std::vector<Scalar> origin_x,    origin_y,    origin_z;
+  std::vector<Scalar> direction_x, direction_y, direction_z;
+  std::vector<Scalar> tmin,        tmax;
+
+  // hits, as in Packet_hits
+  std::vector<int>    face;
+  std::vector<int>    triangle;
+  std::vector<Scalar> u, v, t;
+};
+
+// closest hit of every ray of the packet
+void intersect(const BVH& bvh, const Ray_packet& rays, Packet_hits& hits);
+
+// any hit of every ray: face is the face of some hit in [tmin, tmax] or -1
+void occluded(const BVH& bvh, const Ray_packet& rays, Packet_hits& hits);
+
+// closest hits of a stream, traced in parallel
+void intersect(const BVH& bvh, Ray_stream& stream);
+
+// any hits of a stream, traced in parallel
+void occluded(const BVH& bvh, Ray_stream& stream);
+
+}
+
+#endif // !LGMESH_RAYPACKET_H
@@ -0,0 +1,108 @@
+#ifndef LGMESH_RAYTRIANGLE_H
+#define LGMESH_RAYTRIANGLE_H
+
+#include "LgMeshTypes.h"
+
+#include <cmath>
+#include <limits>
+
+namespace LG {
+
+// 1/d with zero components replaced by a tiny value of the same sign, keeps
+// slab tests free of 0 * inf
+inline Vec3 safe_inverse(const Vec3& d)
+{
+  const Scalar tiny = Scalar(1e-30);
+  Vec3 inv;
+  for (int i = 0; i < 3; ++i)
+  {
+    inv[i] = Scalar(1) / (std::fabs(d[i]) > tiny ? d[i] : (d[i] < 0 ? -tiny : tiny));
+  }
+  return inv;
+}
+
+// Scale for the far distance of ray/box slab tests that makes them
+// conservative under float rounding (Ize, Robust BVH Ray Traversal, JCGT
+// 2013: 1 + 2 gamma(3), with some margin). Without it rays through vertices
+// and edges can miss the boxes of the triangles they hit.
+const Scalar ROBUST_FAR_SCALE = Scalar(1) + 4 * std::numeric_limits<Scalar>::epsilon();
+
+// Watertight ray/triangle intersection (Woop, Benthin and Wald, JCGT 2013).
+// The ray is sheared onto the +z axis, the edge functions of the projected
+// triangle are then evaluated in 2D; edges shared by two triangles are
+// classified consistently, so rays cannot slip through closed meshes.
+struct Watertight_ray
+{
+  Watertight_ray(const Vec3& _origin, const Vec3& direction) : origin(_origin)
+  {
+    const Vec3 d = direction.cwiseAbs();
+    kz = (d[0] >= d[1] && d[0] >= d[2]) ? 0 : (d[1] >= d[2] ? 1 : 2);
+    kx = (kz + 1) % 3;
+    ky = (kx + 1) % 3;
+    if (direction[kz] < 0)
+    {
+      // keep the winding of the projected triangle
+      const int k = kx; kx = ky; ky = k;
+    }
+    sx = direction[kx] / direction[kz];
+    sy = direction[ky] / direction[kz];
+    sz = Scalar(1) / direction[kz];
+  }
+
+  Vec3   origin;
+  int    kx, ky, kz;  // permuted axes, kz is the dominant direction
+  Scalar sx, sy, sz;  // shear
+};
+
+// 2D edge function in double, for the rare cases where float yields zero
+inline Scalar edge_function_exact(Scalar ax, Scalar ay, Scalar bx, Scalar by)
+{
+  return Scalar(double(ax) * double(by) - double(ay) * double(bx));
+}
+
+// Intersection of ray with triangle (a, b, c) in [tmin, tmax]: the ray
+// parameter t and the barycentric weights of a, b and c
+inline bool intersect_watertight(const Watertight_ray& ray, const Vec3& a, const Vec3& b, const Vec3& c,
+                                 Scalar tmin, Scalar tmax, Scalar& t, Vec3& barycentric)
+{
+  const Vec3 A = a - ray.origin, B = b - ray.origin, C = c - ray.origin;
+  const Scalar ax = A[ray.kx] - ray.sx * A[ray.kz], ay = A[ray.ky] - ray.sy * A[ray.kz];
+  const Scalar bx = B[ray.kx] - ray.sx * B[ray.kz], by = B[ray.ky] - ray.sy * B[ray.kz];
+  const Scalar cx = C[ray.kx] - ray.sx * C[ray.kz], cy = C[ray.ky] - ray.sy * C[ray.kz];
+
+  Scalar u = cx * by - cy * bx;
+  Scalar v = ax * cy - ay * cx;
+  Scalar w = bx * ay - by * ax;
+  if (u == 0 || v == 0 || w == 0)
+  {
+    u = edge_function_exact(cx, cy, bx, by);
+    v = edge_function_exact(ax, ay, cx, cy);
+    w = edge_function_exact(bx, by, ax, ay);
+  }
+  if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+  {
+    return false;
+  }
+
+  const Scalar det = u + v + w;
+  if (det == 0)
+  {
+    return false;
+  }
+
+  // t = T / det has to lie in [tmin, tmax], compared without the division
+  const Scalar T = ray.sz * (u * A[ray.kz] + v * B[ray.kz] + w * C[ray.kz]);
+  if (det > 0 ? (T < tmin * det || T > tmax * det) : (T > tmin * det || T < tmax * det))
+  {
+    return false;
+  }
+
+  const Scalar inv_det = Scalar(1) / det;
+  t = T * inv_det;
+  barycentric = Vec3(u * inv_det, v * inv_det, w * inv_det);
+  return true;
+}
+
+}
+
+#endif // !LGMESH_RAYTRIANGLE_H
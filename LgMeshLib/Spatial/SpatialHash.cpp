@@ -0,0 +1,683 @@
+#include "SpatialHash.h"
+#include "ClosestPoint.h"
+#include "FrozenConnectivity.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace LG {
+
+namespace {
+
+// elements per task when computing cells
+const size_t ELEMENT_GRAIN = 16384;
+
+// queries per task of the batched queries
+const size_t QUERY_GRAIN = 256;
+
+// buckets per task of close_pairs()
+const size_t PAIR_GRAIN = 1024;
+
+// update() rebuilds once the overflow lists hold this fraction of the elements
+const Scalar MAX_OVERFLOW = Scalar(0.25);
+
+// box, largest radius and number of the stored elements
+struct Extent
+{
+  Extent() : radius(0), count(0) {};
+
+  BoundingBox box;
+  Scalar      radius;
+  size_t      count;
+};
+
+// Result buffer of one thread for batched queries: the elements found for
+// all queries the thread answered, back to back
+struct Query_buffer
+{
+  std::vector<int>    queries;
+  std::vector<int>    counts;
+  std::vector<int>    elements;
+  std::vector<int>    result;
+  std::vector<size_t> buckets;
+};
+
+struct Pair_buffer
+{
+  std::vector< std::pair<int, int> > pairs;
+  std::vector<size_t>                buckets;
+};
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+SpatialHash::SpatialHash()
+{
+  clear();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+SpatialHash::SpatialHash(const PolygonMesh& mesh, Element_type type, Scalar cell_size)
+{
+  build(mesh, type, cell_size);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::clear()
+{
+  mesh_                = NULL;
+  type_                = VERTICES;
+  topology_generation_ = 0;
+  geometry_generation_ = 0;
+  cell_size_           = 1;
+  inv_cell_size_       = 1;
+  bucket_mask_         = 0;
+  n_elements_          = 0;
+  bounds_              = BoundingBox();
+  max_radius_          = 0;
+
+  offsets_.assign(2, 0);
+  elements_.clear();
+  points_.clear();
+  buckets_.clear();
+  slots_.clear();
+  radii_.clear();
+  overflow_heads_.clear();
+  overflow_.clear();
+}
+
+
+//== BUILD ======================================================================
+
+
+void SpatialHash::build(const PolygonMesh& mesh, Element_type type, Scalar cell_size)
+{
+  clear();
+  mesh_                = &mesh;
+  type_                = type;
+  topology_generation_ = mesh.topology_generation();
+  geometry_generation_ = mesh.geometry_generation();
+
+  if (!(cell_size > 0))
+  {
+    // mean edge length
+    typedef std::pair<double, size_t> Sum;
+    const Sum sum = parallel_reduce(0, mesh.edges_size(), ELEMENT_GRAIN, Sum(0, 0),
+      [&](size_t first, size_t last, Sum s)
+      {
+        for (size_t e = first; e < last; ++e)
+        {
+          if (!mesh.is_deleted(PolygonMesh::Edge((int)e)))
+          {
+            s.first += mesh.edge_length(PolygonMesh::Edge((int)e));
+            ++s.second;
+          }
+        }
+        return s;
+      },
+      [](const Sum& a, const Sum& b) { return Sum(a.first + b.first, a.second + b.second); });
+    cell_size = (sum.second > 0 && sum.first > 0) ? Scalar(sum.first / sum.second) : Scalar(1);
+  }
+  cell_size_     = cell_size;
+  inv_cell_size_ = 1 / cell_size;
+
+  // points and radii of the elements
+  mesh.freeze();
+  const size_t n = (type_ == VERTICES) ? mesh.vertices_size() : mesh.faces_size();
+  std::vector<Vec3> centers(n);
+  if (type_ == FACES)
+  {
+    radii_.assign(n, 0);
+  }
+  const Extent extent = parallel_reduce(0, n, ELEMENT_GRAIN, Extent(),
+    [&](size_t first, size_t last, Extent x)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        if (!is_deleted((int)i))
+        {
+          Scalar radius;
+          element_sphere((int)i, centers[i], radius);
+          if (type_ == FACES)
+          {
+            radii_[i] = radius;
+          }
+          x.box.extend(centers[i]);
+          x.radius = std::max(x.radius, radius);
+          ++x.count;
+        }
+      }
+      return x;
+    },
+    [](Extent a, const Extent& b)
+    {
+      a.box.extend(b.box);
+      a.radius = std::max(a.radius, b.radius);
+      a.count += b.count;
+      return a;
+    });
+  bounds_     = extent.box;
+  max_radius_ = extent.radius;
+  n_elements_ = extent.count;
+
+  // about two buckets per element
+  size_t n_buckets = 1;
+  while (n_buckets < 2 * n_elements_)
+  {
+    n_buckets *= 2;
+  }
+  bucket_mask_ = n_buckets - 1;
+
+  // counting sort by bucket
+  std::unique_ptr<std::atomic<int>[]> counts(new std::atomic<int>[n_buckets]);
+  parallel_for(0, n_buckets, ELEMENT_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      counts[b].store(0, std::memory_order_relaxed);
+    }
+  });
+
+  buckets_.resize(n);
+  slots_.assign(n, -1);
+  parallel_for(0, n, ELEMENT_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      if (!is_deleted((int)i))
+      {
+        buckets_[i] = bucket(centers[i]);
+        counts[buckets_[i]].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  });
+
+  offsets_.resize(n_buckets + 1);
+  offsets_[0] = 0;
+  for (size_t b = 0; b < n_buckets; ++b)
+  {
+    offsets_[b + 1] = offsets_[b] + counts[b].load(std::memory_order_relaxed);
+    counts[b].store(offsets_[b], std::memory_order_relaxed);
+  }
+
+  elements_.resize(n_elements_);
+  parallel_for(0, n, ELEMENT_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      if (!is_deleted((int)i))
+      {
+        elements_[counts[buckets_[i]].fetch_add(1, std::memory_order_relaxed)] = (int)i;
+      }
+    }
+  });
+
+  // the order inside a bucket depends on the scheduling, sort it to make the
+  // grid (and the order of query results) deterministic
+  points_.resize(n_elements_);
+  parallel_for(0, n_buckets, ELEMENT_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      std::sort(elements_.begin() + offsets_[b], elements_.begin() + offsets_[b + 1]);
+      for (int s = offsets_[b]; s < offsets_[b + 1]; ++s)
+      {
+        points_[s] = centers[elements_[s]];
+        slots_[elements_[s]] = s;
+      }
+    }
+  });
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::element_sphere(int i, Vec3& center, Scalar& radius) const
+{
+  const std::vector<Vec3>& points = mesh_->points();
+  if (type_ == VERTICES)
+  {
+    center = points[i];
+    radius = 0;
+    return;
+  }
+
+  const FrozenConnectivity::Vertex_range fv = mesh_->freeze().vertices(Face(i));
+  center = Vec3::Zero();
+  for (size_t k = 0; k < fv.size(); ++k)
+  {
+    center += points[fv[k].idx()];
+  }
+  center /= Scalar(std::max<size_t>(fv.size(), 1));
+
+  Scalar r2 = 0;
+  for (size_t k = 0; k < fv.size(); ++k)
+  {
+    r2 = std::max(r2, (points[fv[k].idx()] - center).squaredNorm());
+  }
+  radius = std::sqrt(r2);
+}
+
+
+//== UPDATE =====================================================================
+
+
+SpatialHash::Update_result SpatialHash::update()
+{
+  if (!mesh_)
+  {
+    return UNCHANGED;
+  }
+  if (mesh_->topology_generation() != topology_generation_)
+  {
+    build(*mesh_, type_, cell_size_);
+    return REBUILT;
+  }
+  if (mesh_->geometry_generation() == geometry_generation_)
+  {
+    return UNCHANGED;
+  }
+
+  // elements touched by the moved vertices, all if the moves were not logged
+  std::vector<Vertex> moved;
+  const bool all = !mesh_->moved_vertices(geometry_generation_, moved);
+  geometry_generation_ = mesh_->geometry_generation();
+
+  std::vector<int> candidates;
+  if (!all)
+  {
+    const FrozenConnectivity& fc = mesh_->freeze();
+    for (size_t k = 0; k < moved.size(); ++k)
+    {
+      if (type_ == VERTICES)
+      {
+        candidates.push_back(moved[k].idx());
+      }
+      else
+      {
+        const FrozenConnectivity::Face_range vf = fc.faces(moved[k]);
+        for (size_t j = 0; j < vf.size(); ++j)
+        {
+          candidates.push_back(vf[j].idx());
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  }
+
+  // new points and buckets in parallel, moving them in the table is serial
+  mesh_->freeze();
+  const size_t n = all ? slots_.size() : candidates.size();
+  std::vector<Vec3>   centers(n);
+  std::vector<Scalar> radii(n);
+  std::vector<size_t> buckets(n);
+  parallel_for(0, n, ELEMENT_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t k = first; k < last; ++k)
+    {
+      const int i = all ? (int)k : candidates[k];
+      if (slots_[i] != -1)
+      {
+        element_sphere(i, centers[k], radii[k]);
+        buckets[k] = bucket(centers[k]);
+      }
+    }
+  });
+
+  for (size_t k = 0; k < n; ++k)
+  {
+    const int i = all ? (int)k : candidates[k];
+    const int slot = slots_[i];
+    if (slot == -1)
+    {
+      continue;
+    }
+
+    bounds_.extend(centers[k]);
+    if (type_ == FACES)
+    {
+      radii_[i]   = radii[k];
+      max_radius_ = std::max(max_radius_, radii[k]);
+    }
+
+    if (buckets[k] != buckets_[i])
+    {
+      relocate(i, centers[k], buckets[k]);
+    }
+    else if (slot >= 0)
+    {
+      points_[slot] = centers[k];
+    }
+    else
+    {
+      overflow_[-2 - slot].point = centers[k];
+    }
+  }
+
+  if (overflow_.size() > MAX_OVERFLOW * n_elements_)
+  {
+    build(*mesh_, type_, cell_size_);
+    return REBUILT;
+  }
+  return UPDATED;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::relocate(int i, const Vec3& point, size_t b)
+{
+  if (overflow_heads_.empty())
+  {
+    overflow_heads_.assign(bucket_mask_ + 1, -1);
+  }
+
+  // mark the old entry stale
+  int& slot = slots_[i];
+  if (slot >= 0)
+  {
+    elements_[slot] = -1;
+  }
+  else
+  {
+    overflow_[-2 - slot].element = -1;
+  }
+
+  Overflow_entry entry;
+  entry.element = i;
+  entry.next    = overflow_heads_[b];
+  entry.point   = point;
+  overflow_heads_[b] = (int)overflow_.size();
+  slot = -2 - (int)overflow_.size();
+  overflow_.push_back(entry);
+  buckets_[i] = b;
+}
+
+
+//== QUERIES ====================================================================
+
+
+void SpatialHash::gather_buckets(const Vec3& p, Scalar reach, std::vector<size_t>& buckets) const
+{
+  buckets.clear();
+  if (n_elements_ == 0)
+  {
+    return;
+  }
+
+  // cells overlapping the query box, clipped to the stored points
+  const Vec3 lo_point = (p - Vec3::Constant(reach)).cwiseMax(bounds_.min());
+  const Vec3 hi_point = (p + Vec3::Constant(reach)).cwiseMin(bounds_.max());
+  int lo[3], hi[3];
+  double n_cells = 1;
+  for (int k = 0; k < 3; ++k)
+  {
+    if (hi_point[k] < lo_point[k])
+    {
+      return;
+    }
+    lo[k] = cell(lo_point[k]);
+    hi[k] = cell(hi_point[k]);
+    n_cells *= double(hi[k]) - lo[k] + 1;
+  }
+
+  if (n_cells > double(bucket_mask_ + 1))
+  {
+    // the range covers more cells than there are buckets
+    buckets.resize(bucket_mask_ + 1);
+    for (size_t b = 0; b <= bucket_mask_; ++b)
+    {
+      buckets[b] = b;
+    }
+    return;
+  }
+
+  for (int z = lo[2]; z <= hi[2]; ++z)
+  {
+    for (int y = lo[1]; y <= hi[1]; ++y)
+    {
+      for (int x = lo[0]; x <= hi[0]; ++x)
+      {
+        buckets.push_back(bucket(x, y, z));
+      }
+    }
+  }
+
+  // different cells may share a bucket
+  if (buckets.size() > 1)
+  {
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Function>
+void SpatialHash::for_each_in_bucket(size_t b, const Function& fn) const
+{
+  for (int s = offsets_[b]; s < offsets_[b + 1]; ++s)
+  {
+    if (elements_[s] >= 0)
+    {
+      fn(elements_[s], points_[s]);
+    }
+  }
+
+  if (!overflow_heads_.empty())
+  {
+    for (int k = overflow_heads_[b]; k >= 0; k = overflow_[k].next)
+    {
+      if (overflow_[k].element >= 0)
+      {
+        fn(overflow_[k].element, overflow_[k].point);
+      }
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar SpatialHash::squared_distance(int i, const Vec3& p) const
+{
+  const std::vector<Vec3>& points = mesh_->points();
+  if (type_ == VERTICES)
+  {
+    return (points[i] - p).squaredNorm();
+  }
+
+  // closest point on the fan triangulation of the face
+  const FrozenConnectivity::Vertex_range fv = mesh_->freeze().vertices(Face(i));
+  Scalar best = std::numeric_limits<Scalar>::max();
+  for (size_t k = 2; k < fv.size(); ++k)
+  {
+    const Vec3& a = points[fv[0].idx()];
+    const Vec3& b = points[fv[k - 1].idx()];
+    const Vec3& c = points[fv[k].idx()];
+    const Vec3 w = closest_point_triangle(p, a, b, c);
+    best = std::min(best, (w[0] * a + w[1] * b + w[2] * c - p).squaredNorm());
+  }
+  return best;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::query(const Vec3& p, Scalar r, std::vector<int>& result, std::vector<size_t>& buckets) const
+{
+  result.clear();
+  const Scalar r2 = r * r;
+  gather_buckets(p, r + max_radius_, buckets);
+  for (size_t k = 0; k < buckets.size(); ++k)
+  {
+    for_each_in_bucket(buckets[k], [&](int i, const Vec3& point)
+    {
+      if (type_ == VERTICES)
+      {
+        if ((point - p).squaredNorm() <= r2)
+        {
+          result.push_back(i);
+        }
+      }
+      else
+      {
+        // bounding sphere first, then the triangles
+        const Scalar reach = r + radii_[i];
+        if ((point - p).squaredNorm() <= reach * reach && squared_distance(i, p) <= r2)
+        {
+          result.push_back(i);
+        }
+      }
+    });
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::query(const Vec3& p, Scalar r, std::vector<int>& result) const
+{
+  std::vector<size_t> buckets;
+  query(p, r, result, buckets);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::query(const std::vector<Vec3>& queries, Scalar r,
+                        std::vector<int>& offsets, std::vector<int>& result) const
+{
+  // every thread appends to its own buffer, the buffers are then copied to
+  // their place in the result
+  Thread_local_storage<Query_buffer> buffers;
+  offsets.assign(queries.size() + 1, 0);
+  parallel_for(0, queries.size(), QUERY_GRAIN, [&](size_t first, size_t last)
+  {
+    Query_buffer& buffer = buffers.local();
+    for (size_t i = first; i < last; ++i)
+    {
+      query(queries[i], r, buffer.result, buffer.buckets);
+      buffer.elements.insert(buffer.elements.end(), buffer.result.begin(), buffer.result.end());
+      buffer.queries.push_back((int)i);
+      buffer.counts.push_back((int)buffer.result.size());
+      offsets[i + 1] = (int)buffer.result.size();
+    }
+  });
+
+  for (size_t i = 0; i < queries.size(); ++i)
+  {
+    offsets[i + 1] += offsets[i];
+  }
+  result.resize(offsets.back());
+
+  buffers.for_each([&](Query_buffer& buffer)
+  {
+    size_t start = 0;
+    for (size_t j = 0; j < buffer.queries.size(); ++j)
+    {
+      std::copy(buffer.elements.begin() + start, buffer.elements.begin() + start + buffer.counts[j],
+                result.begin() + offsets[buffer.queries[j]]);
+      start += buffer.counts[j];
+    }
+  });
+}
+
+
+//== PROXIMITY ==================================================================
+
+
+bool SpatialHash::is_adjacent(int i, int j) const
+{
+  const FrozenConnectivity& fc = mesh_->freeze();
+  if (type_ == VERTICES)
+  {
+    const FrozenConnectivity::Vertex_range vv = fc.vertices(Vertex(i));
+    return std::find(vv.begin(), vv.end(), Vertex(j)) != vv.end();
+  }
+
+  const FrozenConnectivity::Vertex_range fi = fc.vertices(Face(i));
+  const FrozenConnectivity::Vertex_range fj = fc.vertices(Face(j));
+  for (size_t k = 0; k < fi.size(); ++k)
+  {
+    if (std::find(fj.begin(), fj.end(), fi[k]) != fj.end())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void SpatialHash::close_pairs(Scalar r, std::vector< std::pair<int, int> >& pairs, bool skip_adjacent) const
+{
+  pairs.clear();
+  if (n_elements_ == 0)
+  {
+    return;
+  }
+  mesh_->freeze();
+
+  // every element searches the cells around it for partners with a larger
+  // index, so each pair is found once
+  const Scalar reach = r + 2 * max_radius_;
+  Thread_local_storage<Pair_buffer> buffers;
+  parallel_for(0, bucket_mask_ + 1, PAIR_GRAIN, [&](size_t first, size_t last)
+  {
+    Pair_buffer& buffer = buffers.local();
+    for (size_t b = first; b < last; ++b)
+    {
+      for_each_in_bucket(b, [&](int i, const Vec3& pi)
+      {
+        gather_buckets(pi, reach, buffer.buckets);
+        for (size_t k = 0; k < buffer.buckets.size(); ++k)
+        {
+          for_each_in_bucket(buffer.buckets[k], [&](int j, const Vec3& pj)
+          {
+            if (j <= i)
+            {
+              return;
+            }
+            const Scalar limit = (type_ == VERTICES) ? r : r + radii_[i] + radii_[j];
+            if ((pj - pi).squaredNorm() <= limit * limit && !(skip_adjacent && is_adjacent(i, j)))
+            {
+              buffer.pairs.push_back(std::make_pair(i, j));
+            }
+          });
+        }
+      });
+    }
+  });
+
+  buffers.for_each([&](Pair_buffer& buffer)
+  {
+    pairs.insert(pairs.end(), buffer.pairs.begin(), buffer.pairs.end());
+  });
+  std::sort(pairs.begin(), pairs.end());
+}
+
+}
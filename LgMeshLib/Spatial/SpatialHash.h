@@ -0,0 +1,176 @@
+#ifndef LGMESH_SPATIALHASH_H
+#define LGMESH_SPATIALHASH_H
+
+#include "PolygonMesh.h"
+#include "BoundingBox.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace LG {
+
+// Uniform grid over the vertices or faces of a PolygonMesh, with the grid
+// cells hashed into a table of buckets.
+//
+// Vertices are stored in the cell of their position, faces in the cell of
+// their centroid together with the radius of their bounding sphere. The build
+// computes the bucket of every element in parallel and sorts the elements by
+// bucket with a counting sort, so the elements (and their points) of one
+// bucket are contiguous. Several cells may share a bucket; queries filter the
+// candidates by distance anyway.
+//
+// update() follows moving vertices: elements that stay in their bucket are
+// updated in place, elements that change bucket are marked stale in the sorted
+// arrays and appended to an overflow list of their new bucket. When the
+// overflow grows too large, or the connectivity changed, the grid is rebuilt.
+class SpatialHash
+{
+public:
+  typedef PolygonMesh::Vertex Vertex;
+  typedef PolygonMesh::Face   Face;
+
+  enum Element_type { VERTICES, FACES };
+
+  enum Update_result { UNCHANGED, UPDATED, REBUILT };
+
+public:
+  SpatialHash();
+
+  // grid over the elements of mesh, cell_size 0 selects the mean edge length
+  SpatialHash(const PolygonMesh& mesh, Element_type type, Scalar cell_size = 0);
+
+  void build(const PolygonMesh& mesh, Element_type type, Scalar cell_size = 0);
+
+  void clear();
+
+  // was the grid built from the current connectivity of mesh?
+  bool is_current(const PolygonMesh& mesh) const
+  {
+    return (mesh_ == &mesh) && (topology_generation_ == mesh.topology_generation());
+  }
+
+  const PolygonMesh* mesh() const { return mesh_; };
+
+  Element_type element_type() const { return type_; };
+
+  Scalar cell_size() const { return cell_size_; };
+
+  // number of stored elements
+  size_t size() const { return n_elements_; };
+
+  // number of elements moved to the overflow lists since the last build
+  size_t overflow_size() const { return overflow_.size(); };
+
+  // box of the stored vertices or face centroids
+  const BoundingBox& bounds() const { return bounds_; };
+
+public: //--- deforming meshes
+
+  // bring the grid up to date with the vertex positions of its mesh, rebuild
+  // after a topology change or when too many elements changed their bucket
+  Update_result update();
+
+public: //--- queries, thread-safe
+
+  // indices of the vertices or faces within distance r of p, unordered.
+  // Faces are tested exactly against their fan triangulation.
+  void query(const Vec3& p, Scalar r, std::vector<int>& result) const;
+
+  // elements within r of every query point: result[offsets[i] ... offsets[i + 1])
+  // for query i, computed in parallel
+  void query(const std::vector<Vec3>& queries, Scalar r,
+             std::vector<int>& offsets, std::vector<int>& result) const;
+
+  // all pairs (i, j), i < j, of vertices closer than r, or of faces whose
+  // bounding spheres are closer than r. With skip_adjacent, vertices sharing
+  // an edge and faces sharing a vertex are not reported. The pairs are sorted.
+  void close_pairs(Scalar r, std::vector< std::pair<int, int> >& pairs, bool skip_adjacent = true) const;
+
+private:
+  struct Overflow_entry
+  {
+    int  element;   // -1 once the element moved on
+    int  next;      // next entry of the same bucket, -1 at the end
+    Vec3 point;
+  };
+
+  // integer coordinate of the cell containing x
+  int cell(Scalar x) const
+  {
+    return (int)std::floor(x * inv_cell_size_);
+  }
+
+  size_t bucket(int x, int y, int z) const
+  {
+    unsigned long long h = (unsigned long long)(unsigned int)x * 0x9E3779B97F4A7C15ULL
+                         ^ (unsigned long long)(unsigned int)y * 0xC2B2AE3D27D4EB4FULL
+                         ^ (unsigned long long)(unsigned int)z * 0x165667B19E3779F9ULL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return size_t(h) & bucket_mask_;
+  }
+
+  size_t bucket(const Vec3& p) const
+  {
+    return bucket(cell(p[0]), cell(p[1]), cell(p[2]));
+  }
+
+  bool is_deleted(int i) const
+  {
+    return (type_ == VERTICES) ? mesh_->is_deleted(Vertex(i)) : mesh_->is_deleted(Face(i));
+  }
+
+  // vertex position or face centroid, radius is the bounding sphere of a face
+  void element_sphere(int i, Vec3& center, Scalar& radius) const;
+
+  Scalar squared_distance(int i, const Vec3& p) const;
+
+  // the distinct buckets of all cells within reach of p
+  void gather_buckets(const Vec3& p, Scalar reach, std::vector<size_t>& buckets) const;
+
+  // call fn(element, point) for all live elements in bucket b
+  template <class Function>
+  void for_each_in_bucket(size_t b, const Function& fn) const;
+
+  // query with caller-provided scratch space
+  void query(const Vec3& p, Scalar r, std::vector<int>& result, std::vector<size_t>& buckets) const;
+
+  bool is_adjacent(int i, int j) const;
+
+  // move element i to the bucket of its new point
+  void relocate(int i, const Vec3& point, size_t b);
+
+private:
+  const PolygonMesh*  mesh_;
+  Element_type        type_;
+  unsigned long       topology_generation_;
+  unsigned long       geometry_generation_;
+
+  Scalar              cell_size_;
+  Scalar              inv_cell_size_;
+  size_t              bucket_mask_;  // number of buckets (a power of two) - 1
+  size_t              n_elements_;
+  BoundingBox         bounds_;
+  Scalar              max_radius_;   // largest face bounding sphere
+
+  // elements sorted by bucket, elements of bucket b are [offsets_[b], offsets_[b+1]),
+  // stale entries have element -1
+  std::vector<int>    offsets_;
+  std::vector<int>    elements_;
+  std::vector<Vec3>   points_;
+
+  // per element: bucket, position in elements_ (>= 0), overflow entry k
+  // (-2 - k) or not stored (-1), and face radius
+  std::vector<size_t> buckets_;
+  std::vector<int>    slots_;
+  std::vector<Scalar> radii_;
+
+  std::vector<int>             overflow_heads_;  // first overflow entry per bucket
+  std::vector<Overflow_entry>  overflow_;
+};
+
+}
+
+#endif // !LGMESH_SPATIALHASH_H
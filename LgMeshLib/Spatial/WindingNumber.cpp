@@ -0,0 +1,259 @@
+#include "WindingNumber.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <limits>
+
+namespace LG {
+
+namespace {
+
+// subtrees down to this depth are aggregated as tasks
+const int PARALLEL_DEPTH = 4;
+
+// points per task of the batched evaluation
+const size_t QUERY_GRAIN = 256;
+
+const int STACK_SIZE = 512;
+
+const double INV_FOUR_PI = 0.25 / 3.14159265358979323846;
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// area vector, area and area weighted centroid sum of a set of triangles
+struct WindingNumber::Moment
+{
+  Moment() : normal(Vec3::Zero()), center(Vec3::Zero()), area(0) {};
+
+  Moment& operator+=(const Moment& rhs)
+  {
+    normal += rhs.normal;
+    center += rhs.center;
+    area   += rhs.area;
+    return *this;
+  }
+
+  Vec3   normal;
+  Vec3   center;   // divided by area when stored
+  Scalar area;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+WindingNumber::WindingNumber(const BVH& bvh, Scalar beta) : bvh_(bvh), beta_(beta)
+{
+  update();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void WindingNumber::update()
+{
+  nodes_.resize(bvh_.nodes().size());
+  if (!nodes_.empty())
+  {
+    aggregate(0, 0);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+WindingNumber::Moment WindingNumber::aggregate(int n, int depth)
+{
+  const BVH::Node& node = bvh_.nodes()[n];
+  const std::vector<Vec3>& points = bvh_.mesh()->points();
+
+  // moments of the lanes, inner lanes from their subtrees
+  Moment lanes[4];
+  if (depth < PARALLEL_DEPTH)
+  {
+    TaskGroup group;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (!node.is_empty(i) && !node.is_leaf(i))
+      {
+        Moment* lane = &lanes[i];
+        const int child = node.child[i];
+        group.run([this, lane, child, depth]() { *lane = aggregate(child, depth + 1); });
+      }
+    }
+    group.wait();
+  }
+  else
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      if (!node.is_empty(i) && !node.is_leaf(i))
+      {
+        lanes[i] = aggregate(node.child[i], depth + 1);
+      }
+    }
+  }
+
+  Node& far = nodes_[n];
+  Moment total;
+  for (int i = 0; i < 4; ++i)
+  {
+    if (node.is_empty(i))
+    {
+      far.cx[i] = far.cy[i] = far.cz[i] = 0;
+      far.nx[i] = far.ny[i] = far.nz[i] = 0;
+      far.r2[i] = std::numeric_limits<Scalar>::max();
+      continue;
+    }
+
+    Moment& m = lanes[i];
+    if (node.is_leaf(i))
+    {
+      for (int t = node.child[i]; t < node.child[i] + node.count[i]; ++t)
+      {
+        const BVH::Triangle& tri = bvh_.triangle(t);
+        const Vec3& a = points[tri.vertices[0].idx()];
+        const Vec3& b = points[tri.vertices[1].idx()];
+        const Vec3& c = points[tri.vertices[2].idx()];
+        const Vec3 normal = Scalar(0.5) * (b - a).cross(c - a);
+        const Scalar area = normal.norm();
+        m.normal += normal;
+        m.center += area * (a + b + c) / Scalar(3);
+        m.area   += area;
+      }
+    }
+    total += m;
+
+    // expansion center and the farthest box corner from it
+    const BoundingBox box = node.box(i);
+    const Vec3 center = (m.area > 0) ? Vec3(m.center / m.area) : box.center();
+    const Vec3 extent = (center - box.min()).cwiseAbs().cwiseMax((box.max() - center).cwiseAbs());
+    far.cx[i] = center[0];
+    far.cy[i] = center[1];
+    far.cz[i] = center[2];
+    far.nx[i] = m.normal[0];
+    far.ny[i] = m.normal[1];
+    far.nz[i] = m.normal[2];
+    far.r2[i] = extent.squaredNorm();
+  }
+  return total;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+double WindingNumber::solid_angle(int t, const Vec3& p) const
+{
+  // van Oosterom and Strackee, The Solid Angle of a Plane Triangle, 1983
+  const std::vector<Vec3>& points = bvh_.mesh()->points();
+  const BVH::Triangle& tri = bvh_.triangle(t);
+  const Eigen::Vector3d a = (points[tri.vertices[0].idx()] - p).cast<double>();
+  const Eigen::Vector3d b = (points[tri.vertices[1].idx()] - p).cast<double>();
+  const Eigen::Vector3d c = (points[tri.vertices[2].idx()] - p).cast<double>();
+  const double la = a.norm(), lb = b.norm(), lc = c.norm();
+  const double det = a.dot(b.cross(c));
+  const double div = la * lb * lc + a.dot(b) * lc + b.dot(c) * la + c.dot(a) * lb;
+  return 2 * std::atan2(det, div) * INV_FOUR_PI;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Scalar WindingNumber::evaluate(const Vec3& p) const
+{
+  if (nodes_.empty())
+  {
+    return 0;
+  }
+
+  const Scalar px = p[0], py = p[1], pz = p[2];
+  const Scalar beta2 = beta_ * beta_;
+  const std::vector<BVH::Node>& tree = bvh_.nodes();
+  double sum = 0;
+
+  int stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0)
+  {
+    const int n = stack[--top];
+    const Node& far = nodes_[n];
+    const BVH::Node& node = tree[n];
+
+    // dipole terms of the lanes far enough away, masked per lane
+    Scalar dipole[4];
+    bool   is_far[4];
+    for (int i = 0; i < 4; ++i)
+    {
+      const Scalar dx = far.cx[i] - px, dy = far.cy[i] - py, dz = far.cz[i] - pz;
+      const Scalar d2 = dx * dx + dy * dy + dz * dz;
+      is_far[i] = d2 > beta2 * far.r2[i];
+      const Scalar inv_d = 1 / std::sqrt(is_far[i] ? d2 : Scalar(1));
+      const Scalar term = (far.nx[i] * dx + far.ny[i] * dy + far.nz[i] * dz) * inv_d * inv_d * inv_d;
+      dipole[i] = is_far[i] ? term : Scalar(0);
+    }
+    sum += double(dipole[0] + dipole[1] + dipole[2] + dipole[3]) * INV_FOUR_PI;
+
+    for (int i = 0; i < 4; ++i)
+    {
+      if (is_far[i] || node.is_empty(i))
+      {
+        continue;
+      }
+      if (node.is_leaf(i))
+      {
+        for (int t = node.child[i]; t < node.child[i] + node.count[i]; ++t)
+        {
+          sum += solid_angle(t, p);
+        }
+      }
+      else
+      {
+        stack[top++] = node.child[i];
+      }
+    }
+  }
+  return Scalar(sum);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void WindingNumber::evaluate(const std::vector<Vec3>& points, std::vector<Scalar>& result) const
+{
+  result.resize(points.size());
+  parallel_for(0, points.size(), QUERY_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      result[i] = evaluate(points[i]);
+    }
+  });
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void WindingNumber::classify(const std::vector<Vec3>& points, std::vector<unsigned char>& inside) const
+{
+  inside.resize(points.size());
+  parallel_for(0, points.size(), QUERY_GRAIN, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      inside[i] = is_inside(points[i]) ? 1 : 0;
+    }
+  });
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef LG_PARALLEL_H
+#define LG_PARALLEL_H
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace LG {
+
+// Number of threads used by the parallel helpers below
+inline unsigned int parallel_thread_count()
+{
+  return ThreadPool::GetInstance()->thread_count();
+}
+
+namespace detail {
+
+// split [begin, end) in halves, spawning the upper halves as tasks
+template <class Function>
+void parallel_for_split(TaskGroup& group, size_t begin, size_t end, size_t grain, const Function& fn)
+{
+  while (end - begin > grain)
+  {
+    const size_t mid = begin + (end - begin) / 2;
+    group.run([&group, &fn, mid, end, grain]() { parallel_for_split(group, mid, end, grain, fn); });
+    end = mid;
+  }
+  fn(begin, end);
+}
+
+}
+
+// Call fn(first, last) on disjoint sub-ranges covering [begin, end).
+// Ranges smaller than grain are processed on the calling thread. The work
+// runs on the shared ThreadPool, so parallel_for may be called from inside
+// another parallel_for.
+template <class Function>
+void parallel_for(size_t begin, size_t end, size_t grain, const Function& fn)
+{
+  if (end <= begin)
+  {
+    return;
+  }
+
+  const size_t n = end - begin;
+  const size_t n_threads = parallel_thread_count();
+  grain = std::max<size_t>(grain, 1);
+  if (n_threads == 1 || n <= grain)
+  {
+    fn(begin, end);
+    return;
+  }
+
+  // a few sub-ranges per thread leave room for stealing without flooding the queues
+  grain = std::max<size_t>(grain, (n + 4 * n_threads - 1) / (4 * n_threads));
+
+  TaskGroup group;
+  detail::parallel_for_split(group, begin, end, grain, fn);
+  group.wait();
+}
+
+// Reduce [begin, end): fn(first, last, identity) returns the value of a
+// sub-range, partial values are combined with reduce(a, b). The range is cut
+// into blocks of grain indices independently of the number of threads and
+// the block values are combined in order, so floating point results do not
+// depend on the scheduling.
+template <class T, class Function, class Reduce>
+T parallel_reduce(size_t begin, size_t end, size_t grain, const T& identity,
+                  const Function& fn, const Reduce& reduce)
+{
+  if (end <= begin)
+  {
+    return identity;
+  }
+
+  grain = std::max<size_t>(grain, 1);
+  const size_t n_blocks = (end - begin + grain - 1) / grain;
+  std::vector<T> partial(n_blocks, identity);
+
+  parallel_for(0, n_blocks, 1, [&](size_t b, size_t e)
+  {
+    for (size_t block = b; block < e; ++block)
+    {
+      partial[block] = fn(begin + block * grain, std::min(begin + (block + 1) * grain, end), identity);
+    }
+  });
+
+  T result = identity;
+  for (size_t block = 0; block < n_blocks; ++block)
+  {
+    result = reduce(result, partial[block]);
+  }
+  return result;
+}
+
+}
+
+#endif // !LG_PARALLEL_H
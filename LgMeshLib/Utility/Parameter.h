@@ -66,6 +66,11 @@ public:
     return val;
   }
 
+  bool has_parameter(const std::string& name) const
+  {
+    return global_paras_.find(name) != global_paras_.end();
+  }
+
   template <class T>
   T& get_parameter(const std::string& name)
   {
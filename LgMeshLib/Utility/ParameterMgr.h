@@ -35,6 +35,11 @@ public:
     return para_container_->add_parameter<T>(name, initval);
   }
 
+  bool has_parameter(const std::string& name) const
+  {
+    return para_container_->has_parameter(name);
+  }
+
   template <class T>
   T& get_parameter(const std::string& name)
   {
@@ -0,0 +1,297 @@
+#include "ThreadPool.h"
+#include "ParameterMgr.h"
+
+#include <chrono>
+
+namespace LG {
+
+namespace {
+
+// pool membership of the calling thread
+thread_local unsigned int  t_thread_index = 0;
+thread_local void*         t_worker       = NULL;
+
+}
+
+
+ThreadPool::ThreadPool()
+  : queued_(0), stop_(false)
+{
+  unsigned int n = 0;
+  GlobalParameterMgr* para_mgr = GlobalParameterMgr::GetInstance();
+  if (para_mgr->has_parameter("thread_count"))
+  {
+    int count = para_mgr->get_parameter<int>("thread_count");
+    n = count > 0 ? (unsigned int)count : 0;
+  }
+  start(n);
+}
+
+ThreadPool::~ThreadPool()
+{
+  stop();
+}
+
+ThreadPool* ThreadPool::GetInstance()
+{
+  static ThreadPool instance;
+  return &instance;
+}
+
+void ThreadPool::set_thread_count(unsigned int n)
+{
+  stop();
+  start(n);
+}
+
+unsigned int ThreadPool::thread_index()
+{
+  return t_thread_index;
+}
+
+void ThreadPool::start(unsigned int n)
+{
+  if (n == 0)
+  {
+    n = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  stop_ = false;
+  workers_.clear();
+  for (unsigned int i = 1; i < n; ++i)
+  {
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+  }
+  // start the threads once the worker list is complete, they steal from each other
+  for (unsigned int i = 0; i < workers_.size(); ++i)
+  {
+    workers_[i]->thread = std::thread(&ThreadPool::worker_main, this, i + 1);
+  }
+}
+
+void ThreadPool::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  sleep_cv_.notify_all();
+
+  for (size_t i = 0; i < workers_.size(); ++i)
+  {
+    if (workers_[i]->thread.joinable())
+    {
+      workers_[i]->thread.join();
+    }
+  }
+  workers_.clear();
+}
+
+void ThreadPool::push(Task& task)
+{
+  Worker* worker = static_cast<Worker*>(t_worker);
+  if (worker)
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->tasks.push_back(std::move(task));
+  }
+  else
+  {
+    std::lock_guard<std::mutex> lock(inject_mutex_);
+    inject_.push_back(std::move(task));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    ++queued_;
+  }
+  sleep_cv_.notify_one();
+}
+
+namespace {
+
+// take the first task of `tasks` that belongs to `only` (any task if NULL)
+template <class Deque, class Task, class Group>
+bool take_front(Deque& tasks, Task& task, const Group* only)
+{
+  for (typename Deque::iterator it = tasks.begin(); it != tasks.end(); ++it)
+  {
+    if (only == NULL || it->group == only)
+    {
+      task = std::move(*it);
+      tasks.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+// take the last task of `tasks` that belongs to `only` (any task if NULL)
+template <class Deque, class Task, class Group>
+bool take_back(Deque& tasks, Task& task, const Group* only)
+{
+  for (typename Deque::iterator it = tasks.end(); it != tasks.begin(); )
+  {
+    --it;
+    if (only == NULL || it->group == only)
+    {
+      task = std::move(*it);
+      tasks.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
+bool ThreadPool::pop(Task& task, const TaskGroup* only)
+{
+  if (queued_ == 0)
+  {
+    return false;
+  }
+
+  // own deque, newest task first (it is the most likely to be in cache)
+  Worker* self = static_cast<Worker*>(t_worker);
+  if (self)
+  {
+    std::lock_guard<std::mutex> lock(self->mutex);
+    if (take_back(self->tasks, task, only))
+    {
+      --queued_;
+      return true;
+    }
+  }
+
+  // tasks injected from outside the pool
+  {
+    std::lock_guard<std::mutex> lock(inject_mutex_);
+    if (take_front(inject_, task, only))
+    {
+      --queued_;
+      return true;
+    }
+  }
+
+  // steal the oldest task of another worker, starting at the next one
+  const size_t n = workers_.size();
+  const size_t first = t_thread_index;
+  for (size_t k = 0; k < n; ++k)
+  {
+    Worker* victim = workers_[(first + k) % n].get();
+    if (victim == self)
+    {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (take_front(victim->tasks, task, only))
+    {
+      --queued_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::execute(Task& task)
+{
+  std::exception_ptr error;
+  try
+  {
+    task.fn();
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+  task.group->finish(error);
+}
+
+void ThreadPool::worker_main(unsigned int index)
+{
+  t_thread_index = index;
+  t_worker       = workers_[index - 1].get();
+
+  for (;;)
+  {
+    Task task;
+    if (pop(task, NULL))
+    {
+      execute(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    if (stop_)
+    {
+      break;
+    }
+    // queued tasks that could not be taken are being taken by others right now
+    sleep_cv_.wait_for(lock, std::chrono::milliseconds(10), [this]() { return stop_ || queued_ > 0; });
+  }
+
+  t_worker = NULL;
+  t_thread_index = 0;
+}
+
+
+TaskGroup::~TaskGroup()
+{
+  try
+  {
+    wait();
+  }
+  catch (...)
+  {
+  }
+}
+
+void TaskGroup::wait()
+{
+  ThreadPool* pool = ThreadPool::GetInstance();
+  // only help with the own tasks: the waiting thread may be in the middle of
+  // a task of an enclosing group, running another task of that group here
+  // would reenter its Thread_local_storage instance. Idle workers pick up
+  // everything else.
+  const TaskGroup* only = this;
+
+  while (pending_ > 0)
+  {
+    ThreadPool::Task task;
+    if (pool->pop(task, only))
+    {
+      pool->execute(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(lock, std::chrono::microseconds(200), [this]() { return pending_ == 0; });
+  }
+
+  // finish() decrements under the lock, make sure it has left before the
+  // group can be destroyed
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_)
+  {
+    std::exception_ptr error = error_;
+    error_ = std::exception_ptr();
+    std::rethrow_exception(error);
+  }
+}
+
+void TaskGroup::finish(std::exception_ptr error)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error && !error_)
+  {
+    error_ = error;
+  }
+  if (--pending_ == 0)
+  {
+    cv_.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,187 @@
+#ifndef LG_THREADPOOL_H
+#define LG_THREADPOOL_H
+
+#include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LG {
+
+class TaskGroup;
+
+// Work-stealing thread pool shared by all parallel algorithms of the library.
+//
+// Every worker owns a deque: tasks spawned by a worker are pushed to and
+// popped from the back of its own deque, idle workers steal from the front
+// of the others. Tasks spawned by threads outside the pool go to a shared
+// injection queue. A thread waiting for a TaskGroup executes pending tasks
+// of that group meanwhile, so parallel algorithms can be nested freely.
+//
+// The number of threads is read from the global parameter "thread_count"
+// (int, see GlobalParameterMgr) when the pool is first used and defaults to
+// the number of hardware threads. It can be changed later through
+// set_thread_count() while no parallel work is running.
+class ThreadPool
+{
+private:
+  ThreadPool();
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+
+public:
+  ~ThreadPool();
+
+  static ThreadPool* GetInstance();
+
+  // number of threads taking part in parallel work, the worker threads plus
+  // the thread that started the work
+  unsigned int thread_count() const { return (unsigned int)workers_.size() + 1; };
+
+  // restart the pool with n threads (n = 0 selects the hardware concurrency)
+  void set_thread_count(unsigned int n);
+
+  // index of the calling thread in [0, thread_count()): workers have the
+  // indices 1..thread_count()-1, any thread outside the pool has index 0
+  static unsigned int thread_index();
+
+private:
+  friend class TaskGroup;
+
+  struct Task
+  {
+    std::function<void()> fn;
+    TaskGroup*            group;
+  };
+
+  struct Worker
+  {
+    std::mutex        mutex;
+    std::deque<Task>  tasks;
+    std::thread       thread;
+  };
+
+  void start(unsigned int n);
+  void stop();
+
+  // queue a task, on the own deque of a worker or on the injection queue
+  void push(Task& task);
+
+  // take a queued task of group `only`, any task if NULL. Idle workers take
+  // any task, waiting threads only tasks of the group they wait for: this
+  // keeps index 0 exclusive to one thread per group, and a thread never runs
+  // a task of a group while it is inside another task of it.
+  bool pop(Task& task, const TaskGroup* only);
+
+  void execute(Task& task);
+
+  void worker_main(unsigned int index);
+
+private:
+  std::vector< std::unique_ptr<Worker> >  workers_;
+
+  std::mutex               inject_mutex_;
+  std::deque<Task>         inject_;
+
+  std::mutex               sleep_mutex_;
+  std::condition_variable  sleep_cv_;
+  std::atomic<size_t>      queued_;
+  bool                     stop_;
+};
+
+
+// A set of tasks that can be waited for. Tasks may spawn nested groups.
+class TaskGroup
+{
+public:
+  TaskGroup() : pending_(0) {}
+
+  // waits for unfinished tasks, exceptions are dropped here
+  ~TaskGroup();
+
+  // run fn asynchronously (or immediately if the pool has no workers)
+  template <class Function>
+  void run(const Function& fn)
+  {
+    ThreadPool* pool = ThreadPool::GetInstance();
+    ++pending_;
+    ThreadPool::Task task;
+    task.fn    = fn;
+    task.group = this;
+    if (pool->thread_count() == 1)
+    {
+      pool->execute(task);
+    }
+    else
+    {
+      pool->push(task);
+    }
+  }
+
+  // wait until all tasks are finished, executing queued tasks meanwhile.
+  // Rethrows the first exception thrown by a task.
+  void wait();
+
+private:
+  friend class ThreadPool;
+
+  void finish(std::exception_ptr error);
+
+private:
+  std::atomic<size_t>      pending_;
+  std::mutex               mutex_;
+  std::condition_variable  cv_;
+  std::exception_ptr       error_;
+};
+
+
+// Per-thread scratch storage: one lazily constructed T per pool thread, e.g.
+// to keep result buffers of parallel queries without locking.
+// Only use it from tasks of groups started after its construction. The
+// instance stays with its task while that waits for a nested group.
+template <class T>
+class Thread_local_storage
+{
+public:
+  explicit Thread_local_storage(const T& prototype = T())
+    : prototype_(prototype), slots_(ThreadPool::GetInstance()->thread_count()) {}
+
+  // the instance of the calling thread
+  T& local()
+  {
+    unsigned int i = ThreadPool::thread_index();
+    assert(i < slots_.size());
+    if (!slots_[i])
+    {
+      slots_[i].reset(new T(prototype_));
+    }
+    return *slots_[i];
+  }
+
+  // call fn(T&) for every instance created so far, in thread index order
+  template <class Function>
+  void for_each(const Function& fn)
+  {
+    for (size_t i = 0; i < slots_.size(); ++i)
+    {
+      if (slots_[i])
+      {
+        fn(*slots_[i]);
+      }
+    }
+  }
+
+private:
+  T                                 prototype_;
+  std::vector< std::unique_ptr<T> > slots_;
+};
+
+}
+
+#endif // !LG_THREADPOOL_H
@@ -0,0 +1,144 @@
+#ifndef LGMESH_ATTRIBUTEMATRIX_H
+#define LGMESH_ATTRIBUTEMATRIX_H
+
+#include "PolygonMesh.h"
+
+namespace LG {
+
+// Zero-copy Eigen views over Scalar, Vec2 and Vec3 attributes.
+//
+// Column i of the view is the value of element i, so whole-mesh operations
+// become single Eigen expressions:
+//
+//   Attribute_matrix<Vec3>::Map P = points_matrix(mesh);
+//   P = (R * P).colwise() + t;
+//   mesh.points_changed();
+//
+// Deleted elements keep their slots until garbage collection. Element-wise
+// operations can ignore them, reductions have to exclude them unless
+// mesh.is_compact() is true, e.g. with a live mask:
+//
+//   Vec3 c = mesh.is_compact()
+//          ? Vec3(P.rowwise().mean())
+//          : Vec3(P * vertex_live_mask(mesh).transpose() / Scalar(mesh.n_vertices()));
+//
+// A view stays valid until the attribute array is reallocated, i.e. until
+// elements are added or the mesh is cleared.
+
+template <int Rows>
+struct Attribute_matrix_base
+{
+  enum { rows = Rows };
+  typedef Eigen::Matrix<Scalar, Rows, Eigen::Dynamic>  Matrix;
+  typedef Eigen::Map<Matrix>                           Map;
+  typedef Eigen::Map<const Matrix>                     Const_map;
+};
+
+// only defined for value types that are tightly packed Scalars
+template <class T>
+struct Attribute_matrix;
+
+template <>
+struct Attribute_matrix<Scalar> : public Attribute_matrix_base<1> {};
+
+template <>
+struct Attribute_matrix<Vec2> : public Attribute_matrix_base<2> {};
+
+template <>
+struct Attribute_matrix<Vec3> : public Attribute_matrix_base<3> {};
+
+
+// mutable view on the values of attr
+template <class T>
+typename Attribute_matrix<T>::Map attribute_matrix(Attribute<T>& attr)
+{
+  static_assert(sizeof(T) == Attribute_matrix<T>::rows * sizeof(Scalar), "attribute values are not tightly packed");
+  std::vector<T>& v = attr.vector();
+  Scalar* data = v.empty() ? NULL : reinterpret_cast<Scalar*>(&v[0]);
+  return typename Attribute_matrix<T>::Map(data, Attribute_matrix<T>::rows, v.size());
+}
+
+// read-only view on the values of attr
+template <class T>
+typename Attribute_matrix<T>::Const_map attribute_matrix(const Attribute<T>& attr)
+{
+  static_assert(sizeof(T) == Attribute_matrix<T>::rows * sizeof(Scalar), "attribute values are not tightly packed");
+  const std::vector<T>& v = attr.vector();
+  const Scalar* data = v.empty() ? NULL : reinterpret_cast<const Scalar*>(&v[0]);
+  return typename Attribute_matrix<T>::Const_map(data, Attribute_matrix<T>::rows, v.size());
+}
+
+// 3 x n_vertices view on the vertex positions, call mesh.points_changed()
+// after writing through it
+inline Attribute_matrix<Vec3>::Map points_matrix(PolygonMesh& mesh)
+{
+  PolygonMesh::Vertex_attribute<Vec3> points = mesh.get_vertex_attribute<Vec3>("v:point");
+  return attribute_matrix(points);
+}
+
+inline Attribute_matrix<Vec3>::Const_map points_matrix(const PolygonMesh& mesh)
+{
+  const std::vector<Vec3>& v = mesh.points();
+  const Scalar* data = v.empty() ? NULL : v[0].data();
+  return Attribute_matrix<Vec3>::Const_map(data, 3, v.size());
+}
+
+
+// Row vectors with 1 for live and 0 for deleted elements, to weight
+// reductions over views of meshes that are not compact
+
+inline Eigen::Matrix<Scalar, 1, Eigen::Dynamic> vertex_live_mask(const PolygonMesh& mesh)
+{
+  Eigen::Matrix<Scalar, 1, Eigen::Dynamic> mask = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>::Ones(mesh.vertices_size());
+  if (!mesh.is_compact())
+  {
+    for (size_t i = 0; i < mesh.vertices_size(); ++i)
+    {
+      if (mesh.is_deleted(PolygonMesh::Vertex((int)i))) mask[i] = 0;
+    }
+  }
+  return mask;
+}
+
+inline Eigen::Matrix<Scalar, 1, Eigen::Dynamic> halfedge_live_mask(const PolygonMesh& mesh)
+{
+  Eigen::Matrix<Scalar, 1, Eigen::Dynamic> mask = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>::Ones(mesh.halfedges_size());
+  if (!mesh.is_compact())
+  {
+    for (size_t i = 0; i < mesh.halfedges_size(); ++i)
+    {
+      if (mesh.is_deleted(PolygonMesh::Halfedge((int)i))) mask[i] = 0;
+    }
+  }
+  return mask;
+}
+
+inline Eigen::Matrix<Scalar, 1, Eigen::Dynamic> edge_live_mask(const PolygonMesh& mesh)
+{
+  Eigen::Matrix<Scalar, 1, Eigen::Dynamic> mask = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>::Ones(mesh.edges_size());
+  if (!mesh.is_compact())
+  {
+    for (size_t i = 0; i < mesh.edges_size(); ++i)
+    {
+      if (mesh.is_deleted(PolygonMesh::Edge((int)i))) mask[i] = 0;
+    }
+  }
+  return mask;
+}
+
+inline Eigen::Matrix<Scalar, 1, Eigen::Dynamic> face_live_mask(const PolygonMesh& mesh)
+{
+  Eigen::Matrix<Scalar, 1, Eigen::Dynamic> mask = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>::Ones(mesh.faces_size());
+  if (!mesh.is_compact())
+  {
+    for (size_t i = 0; i < mesh.faces_size(); ++i)
+    {
+      if (mesh.is_deleted(PolygonMesh::Face((int)i))) mask[i] = 0;
+    }
+  }
+  return mask;
+}
+
+}
+
+#endif // !LGMESH_ATTRIBUTEMATRIX_H
@@ -116,6 +116,11 @@ public:
     return data_;
   }
 
+  const std::vector<T>& vector() const
+  {
+    return data_;
+  }
+
   // Access the i'th element. No range check is performed!
   reference operator[](int _idx)
   {
@@ -192,6 +197,12 @@ public:
     return attr_array_->vector();
   }
 
+  const std::vector<T>& vector() const
+  {
+    assert(attr_array_ != NULL);
+    return attr_array_->vector();
+  }
+
 private:
   
   AttributeArray<T>& array()
@@ -304,6 +315,42 @@ public:
     return attr;
   }
 
+  // Add a custom array type derived from BaseAttributeArray (e.g. a
+  // StaticAttributeArray holding several attributes). Returns NULL if an
+  // attribute with this name already exists.
+  template <class ArrayType>
+  ArrayType* add_array(const std::string& name)
+  {
+    for (size_t i = 0; i < attr_arrays_.size(); ++i)
+    {
+      if (attr_arrays_[i]->name() == name)
+      {
+        std::cerr << "[AttributeContainer] An attribute with name \""
+                  << name << "\" already exists. Returning invalid array.\n";
+        return NULL;
+      }
+    }
+
+    ArrayType* array = new ArrayType(name);
+    array->resize(size_);
+    attr_arrays_.push_back(array);
+    return array;
+  }
+
+  // Get a custom array by its name. Returns NULL if it does not exist.
+  template <class ArrayType>
+  ArrayType* get_array(const std::string& name) const
+  {
+    for (size_t i = 0; i < attr_arrays_.size(); ++i)
+    {
+      if (attr_arrays_[i]->name() == name)
+      {
+        return dynamic_cast<ArrayType*>(attr_arrays_[i]);
+      }
+    }
+    return NULL;
+  }
+
   // Get the type of property by its name. Return typeid(void) if it does not exist
   const std::type_info& get_type(const std::string& name)
   {
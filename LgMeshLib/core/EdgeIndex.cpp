@@ -0,0 +1,207 @@
+#include "EdgeIndex.h"
+
+#include <assert.h>
+
+namespace LG {
+
+
+EdgeIndex::EdgeIndex()
+  : capacity_(0), size_(0), tombstones_(0)
+{
+
+}
+
+EdgeIndex::EdgeIndex(const EdgeIndex& rhs)
+  : capacity_(0), size_(0), tombstones_(0)
+{
+  operator=(rhs);
+}
+
+EdgeIndex& EdgeIndex::operator=(const EdgeIndex& rhs)
+{
+  if (this != &rhs)
+  {
+    clear();
+    if (rhs.capacity_ > 0)
+    {
+      keys_.reset(new std::atomic<uint64_t>[rhs.capacity_]);
+      values_.reset(new int[rhs.capacity_]);
+      capacity_ = rhs.capacity_;
+      for (size_t i = 0; i < capacity_; ++i)
+      {
+        keys_[i].store(rhs.keys_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        values_[i] = rhs.values_[i];
+      }
+      size_       = rhs.size_.load();
+      tombstones_ = rhs.tombstones_;
+    }
+  }
+  return *this;
+}
+
+void EdgeIndex::clear()
+{
+  keys_.reset();
+  values_.reset();
+  capacity_   = 0;
+  size_       = 0;
+  tombstones_ = 0;
+}
+
+void EdgeIndex::reserve(size_t n)
+{
+  // keep the load factor (including tombstones) below 1/2
+  size_t required = 2 * (size_ + tombstones_ + n);
+  if (required < capacity_)
+  {
+    return;
+  }
+
+  size_t capacity = 16;
+  while (capacity <= required)
+  {
+    capacity <<= 1;
+  }
+  rehash(capacity);
+}
+
+void EdgeIndex::insert(int v0, int v1, int e)
+{
+  const uint64_t key = make_key(v0, v1);
+
+  long slot = find_slot(key);
+  if (slot >= 0)
+  {
+    values_[slot] = e;
+    return;
+  }
+
+  reserve(1);
+
+  // reuse the first free slot, tombstones included
+  const size_t mask = capacity_ - 1;
+  size_t i = hash(key) & mask;
+  for (;; i = (i + 1) & mask)
+  {
+    uint64_t k = keys_[i].load(std::memory_order_relaxed);
+    if (k == EMPTY_KEY || k == TOMBSTONE_KEY)
+    {
+      if (k == TOMBSTONE_KEY)
+      {
+        --tombstones_;
+      }
+      keys_[i].store(key, std::memory_order_relaxed);
+      values_[i] = e;
+      ++size_;
+      return;
+    }
+  }
+}
+
+void EdgeIndex::concurrent_insert(int v0, int v1, int e)
+{
+  assert(2 * (size_ + tombstones_ + 1) <= capacity_);
+
+  const uint64_t key  = make_key(v0, v1);
+  const size_t   mask = capacity_ - 1;
+  size_t i = hash(key) & mask;
+  for (;;)
+  {
+    uint64_t k = keys_[i].load(std::memory_order_acquire);
+    if (k == key)
+    {
+      values_[i] = e;
+      return;
+    }
+    if (k == EMPTY_KEY)
+    {
+      if (keys_[i].compare_exchange_strong(k, key, std::memory_order_acq_rel))
+      {
+        values_[i] = e;
+        ++size_;
+        return;
+      }
+      // another thread claimed the slot first, look at it again
+      continue;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+void EdgeIndex::erase(int v0, int v1)
+{
+  long slot = find_slot(make_key(v0, v1));
+  if (slot >= 0)
+  {
+    keys_[slot].store(TOMBSTONE_KEY, std::memory_order_relaxed);
+    values_[slot] = -1;
+    --size_;
+    ++tombstones_;
+  }
+}
+
+int EdgeIndex::find(int v0, int v1) const
+{
+  long slot = find_slot(make_key(v0, v1));
+  return slot >= 0 ? values_[slot] : -1;
+}
+
+long EdgeIndex::find_slot(uint64_t key) const
+{
+  if (capacity_ == 0)
+  {
+    return -1;
+  }
+
+  const size_t mask = capacity_ - 1;
+  size_t i = hash(key) & mask;
+  for (;; i = (i + 1) & mask)
+  {
+    uint64_t k = keys_[i].load(std::memory_order_relaxed);
+    if (k == key)
+    {
+      return long(i);
+    }
+    if (k == EMPTY_KEY)
+    {
+      return -1;
+    }
+  }
+}
+
+void EdgeIndex::rehash(size_t capacity)
+{
+  std::unique_ptr<std::atomic<uint64_t>[]> old_keys(keys_.release());
+  std::unique_ptr<int[]>                   old_values(values_.release());
+  const size_t old_capacity = capacity_;
+
+  keys_.reset(new std::atomic<uint64_t>[capacity]);
+  values_.reset(new int[capacity]);
+  capacity_   = capacity;
+  tombstones_ = 0;
+  for (size_t i = 0; i < capacity_; ++i)
+  {
+    keys_[i].store(EMPTY_KEY, std::memory_order_relaxed);
+    values_[i] = -1;
+  }
+
+  // tombstones are dropped on the way
+  const size_t mask = capacity_ - 1;
+  for (size_t j = 0; j < old_capacity; ++j)
+  {
+    uint64_t key = old_keys[j].load(std::memory_order_relaxed);
+    if (key == EMPTY_KEY || key == TOMBSTONE_KEY)
+    {
+      continue;
+    }
+    size_t i = hash(key) & mask;
+    while (keys_[i].load(std::memory_order_relaxed) != EMPTY_KEY)
+    {
+      i = (i + 1) & mask;
+    }
+    keys_[i].store(key, std::memory_order_relaxed);
+    values_[i] = old_values[j];
+  }
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef LGMESH_EDGEINDEX_H
+#define LGMESH_EDGEINDEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+namespace LG {
+
+// Open-addressing hash table mapping an unordered vertex pair to an edge index.
+// Keys are (min, max) vertex indices packed into 64 bits, collisions are
+// resolved by linear probing and erased slots are marked as tombstones.
+class EdgeIndex
+{
+public:
+
+  EdgeIndex();
+
+  EdgeIndex(const EdgeIndex& rhs);
+
+  EdgeIndex& operator=(const EdgeIndex& rhs);
+
+  // Remove all entries and release the table
+  void clear();
+
+  // Make room for n entries; afterwards up to n concurrent_insert() calls
+  // can run in parallel without triggering a rehash
+  void reserve(size_t n);
+
+  // Number of stored vertex pairs
+  size_t size() const { return size_; };
+
+  // Map vertex pair (v0, v1) to edge e, replacing an existing mapping
+  void insert(int v0, int v1, int e);
+
+  // Thread-safe insertion into a table prepared by reserve()
+  void concurrent_insert(int v0, int v1, int e);
+
+  // Remove the mapping of vertex pair (v0, v1) if it exists
+  void erase(int v0, int v1);
+
+  // Return the edge index of vertex pair (v0, v1), -1 if there is none
+  int find(int v0, int v1) const;
+
+private:
+
+  static const uint64_t EMPTY_KEY     = ~uint64_t(0);
+  static const uint64_t TOMBSTONE_KEY = ~uint64_t(0) - 1;
+
+  static uint64_t make_key(int v0, int v1)
+  {
+    if (v1 < v0)
+    {
+      std::swap(v0, v1);
+    }
+    return (uint64_t(uint32_t(v0)) << 32) | uint64_t(uint32_t(v1));
+  }
+
+  // 64 bit finalizer of MurmurHash3, spreads the packed indices over the table
+  static size_t hash(uint64_t key)
+  {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return size_t(key);
+  }
+
+  // reallocate the table with the given power-of-two capacity and re-insert all entries
+  void rehash(size_t capacity);
+
+  // slot of key, or -1 if the key is not stored
+  long find_slot(uint64_t key) const;
+
+private:
+  std::unique_ptr<std::atomic<uint64_t>[]> keys_;
+  std::unique_ptr<int[]>                   values_;
+  size_t                                   capacity_;
+  std::atomic<size_t>                      size_;
+  size_t                                   tombstones_;
+};
+
+}
+
+#endif // !LGMESH_EDGEINDEX_H
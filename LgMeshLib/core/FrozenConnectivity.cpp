@@ -0,0 +1,171 @@
+#include "FrozenConnectivity.h"
+#include "Parallel.h"
+
+namespace LG {
+
+namespace {
+
+// turn per-element counts stored at offsets[i+1] into CSR offsets
+void exclusive_scan(std::vector<int>& offsets)
+{
+  offsets[0] = 0;
+  for (size_t i = 1; i < offsets.size(); ++i)
+  {
+    offsets[i] += offsets[i - 1];
+  }
+}
+
+}
+
+
+FrozenConnectivity::FrozenConnectivity(const PolygonMesh& mesh)
+  : mesh_(&mesh), generation_(mesh.topology_generation())
+{
+  typedef PolygonMesh::Vertex   Vertex;
+  typedef PolygonMesh::Halfedge Halfedge;
+  typedef PolygonMesh::Edge     Edge;
+  typedef PolygonMesh::Face     Face;
+
+  const size_t nv = mesh.vertices_size();
+  const size_t ne = mesh.edges_size();
+  const size_t nf = mesh.faces_size();
+  const size_t grain = 1024;
+
+  vv_offsets_.assign(nv + 1, 0);
+  vf_offsets_.assign(nv + 1, 0);
+  fv_offsets_.assign(nf + 1, 0);
+  ef_offsets_.assign(ne + 1, 0);
+
+  // first pass: count neighbours of every element
+  parallel_for(0, nv, grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Vertex v((int)i);
+      if (mesh.is_deleted(v))
+      {
+        continue;
+      }
+      int n_vertices = 0, n_faces = 0;
+      PolygonMesh::Halfedge_around_vertex_circulator hc = mesh.halfedges(v), hc_end = hc;
+      if (hc)
+      {
+        do
+        {
+          ++n_vertices;
+          if (!mesh.is_boundary(*hc))
+          {
+            ++n_faces;
+          }
+        } while (++hc != hc_end);
+      }
+      vv_offsets_[i + 1] = n_vertices;
+      vf_offsets_[i + 1] = n_faces;
+    }
+  });
+
+  parallel_for(0, nf, grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Face f((int)i);
+      if (mesh.is_deleted(f))
+      {
+        continue;
+      }
+      int n = 0;
+      Halfedge h = mesh.halfedge(f), hh = h;
+      do
+      {
+        ++n;
+        h = mesh.next_halfedge(h);
+      } while (h != hh);
+      fv_offsets_[i + 1] = n;
+    }
+  });
+
+  parallel_for(0, ne, grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Edge e((int)i);
+      if (mesh.is_deleted(e))
+      {
+        continue;
+      }
+      ef_offsets_[i + 1] = (mesh.face(e, 0).is_valid() ? 1 : 0) + (mesh.face(e, 1).is_valid() ? 1 : 0);
+    }
+  });
+
+  exclusive_scan(vv_offsets_);
+  exclusive_scan(vf_offsets_);
+  exclusive_scan(fv_offsets_);
+  exclusive_scan(ef_offsets_);
+
+  vv_.resize(vv_offsets_.back());
+  vf_.resize(vf_offsets_.back());
+  fv_.resize(fv_offsets_.back());
+  ef_.resize(ef_offsets_.back());
+
+  // second pass: fill the neighbour lists. Skipping the boundary halfedges
+  // of the ccw sweep yields the same face order as the face circulator.
+  parallel_for(0, nv, grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      if (vv_offsets_[i] == vv_offsets_[i + 1])
+      {
+        continue;
+      }
+      Vertex v((int)i);
+      int iv = vv_offsets_[i], jf = vf_offsets_[i];
+      PolygonMesh::Halfedge_around_vertex_circulator hc = mesh.halfedges(v), hc_end = hc;
+      do
+      {
+        vv_[iv++] = mesh.to_vertex(*hc);
+        if (!mesh.is_boundary(*hc))
+        {
+          vf_[jf++] = mesh.face(*hc);
+        }
+      } while (++hc != hc_end);
+    }
+  });
+
+  parallel_for(0, nf, grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      int j = fv_offsets_[i];
+      if (j == fv_offsets_[i + 1])
+      {
+        continue;
+      }
+      Face f((int)i);
+      Halfedge h = mesh.halfedge(f), hh = h;
+      do
+      {
+        fv_[j++] = mesh.to_vertex(h);
+        h = mesh.next_halfedge(h);
+      } while (h != hh);
+    }
+  });
+
+  parallel_for(0, ne, grain, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      int j = ef_offsets_[i];
+      Edge e((int)i);
+      for (unsigned int k = 0; k < 2 && j < ef_offsets_[i + 1]; ++k)
+      {
+        Face f = mesh.face(e, k);
+        if (f.is_valid())
+        {
+          ef_[j++] = f;
+        }
+      }
+    }
+  });
+}
+
+}
@@ -0,0 +1,115 @@
+#ifndef LGMESH_FROZENCONNECTIVITY_H
+#define LGMESH_FROZENCONNECTIVITY_H
+
+#include "PolygonMesh.h"
+
+namespace LG {
+
+// Immutable snapshot of the mesh connectivity in compressed sparse row form.
+// Neighbour lists are stored contiguously, which makes read-only traversals
+// much cheaper than following halfedge links. The snapshot belongs to one
+// topology generation of its mesh; see PolygonMesh::freeze().
+class FrozenConnectivity
+{
+public:
+
+  // contiguous read-only list of handles, usable in range-based for loops
+  template <class T>
+  class Range
+  {
+  public:
+    Range(const T* _begin = NULL, const T* _end = NULL) : begin_(_begin), end_(_end) {};
+    const T* begin() const { return begin_; };
+    const T* end()   const { return end_; };
+    size_t size() const { return end_ - begin_; };
+    bool empty() const { return begin_ == end_; };
+    const T& operator[](size_t i) const { assert(begin_ + i < end_); return begin_[i]; };
+
+  private:
+    const T* begin_;
+    const T* end_;
+  };
+
+  typedef Range<PolygonMesh::Vertex> Vertex_range;
+  typedef Range<PolygonMesh::Face>   Face_range;
+
+public:
+
+  // build the adjacency arrays of mesh (in parallel)
+  explicit FrozenConnectivity(const PolygonMesh& mesh);
+
+  // topology generation of the mesh this snapshot was built from
+  unsigned long generation() const { return generation_; };
+
+  // is this snapshot still valid for mesh?
+  bool is_current(const PolygonMesh& mesh) const
+  {
+    return (mesh_ == &mesh) && (generation_ == mesh.topology_generation());
+  }
+
+  // one-ring vertices of v, in the order of Vertex_around_vertex_circulator
+  Vertex_range vertices(PolygonMesh::Vertex v) const
+  {
+    return range(vv_offsets_, vv_, v.idx());
+  }
+
+  // incident faces of v, in the order of Face_around_vertex_circulator
+  Face_range faces(PolygonMesh::Vertex v) const
+  {
+    return range(vf_offsets_, vf_, v.idx());
+  }
+
+  // vertices of f, in the order of Vertex_around_face_circulator
+  Vertex_range vertices(PolygonMesh::Face f) const
+  {
+    return range(fv_offsets_, fv_, f.idx());
+  }
+
+  // the one or two faces incident to e
+  Face_range faces(PolygonMesh::Edge e) const
+  {
+    return range(ef_offsets_, ef_, e.idx());
+  }
+
+  size_t valence(PolygonMesh::Vertex v) const
+  {
+    return vv_offsets_[v.idx() + 1] - vv_offsets_[v.idx()];
+  }
+
+  // raw arrays, neighbours of element i are [offsets[i], offsets[i+1])
+  const std::vector<int>&                  vertex_vertex_offsets() const { return vv_offsets_; };
+  const std::vector<PolygonMesh::Vertex>&  vertex_vertices()       const { return vv_; };
+  const std::vector<int>&                  vertex_face_offsets()   const { return vf_offsets_; };
+  const std::vector<PolygonMesh::Face>&    vertex_faces()          const { return vf_; };
+  const std::vector<int>&                  face_vertex_offsets()   const { return fv_offsets_; };
+  const std::vector<PolygonMesh::Vertex>&  face_vertices()         const { return fv_; };
+  const std::vector<int>&                  edge_face_offsets()     const { return ef_offsets_; };
+  const std::vector<PolygonMesh::Face>&    edge_faces()            const { return ef_; };
+
+private:
+
+  template <class T>
+  static Range<T> range(const std::vector<int>& offsets, const std::vector<T>& data, int i)
+  {
+    assert(0 <= i && i + 1 < (int)offsets.size());
+    const T* base = data.empty() ? NULL : &data[0];
+    return Range<T>(base + offsets[i], base + offsets[i + 1]);
+  }
+
+private:
+  const PolygonMesh* mesh_;
+  unsigned long      generation_;
+
+  std::vector<int>                  vv_offsets_;
+  std::vector<PolygonMesh::Vertex>  vv_;
+  std::vector<int>                  vf_offsets_;
+  std::vector<PolygonMesh::Face>    vf_;
+  std::vector<int>                  fv_offsets_;
+  std::vector<PolygonMesh::Vertex>  fv_;
+  std::vector<int>                  ef_offsets_;
+  std::vector<PolygonMesh::Face>    ef_;
+};
+
+}
+
+#endif // !LGMESH_FROZENCONNECTIVITY_H
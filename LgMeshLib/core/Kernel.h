@@ -19,6 +19,8 @@ class Kernel
     const std::type_info& mytype;
     BaseGlobalAttribute(const std::type_info& mytype = typeid(void))
       : mytype(mytype) {}
+    // Attributes are deleted through this base
+    virtual ~BaseGlobalAttribute() {}
     // Return a deep copy of itself
     virtual BaseGlobalAttribute* clone() const = 0;
   };
@@ -57,7 +59,9 @@ public:
     {
       for (auto it : _rhs.global_attrs_)
       {
-        global_attrs_[it.first] = it.second->clone();
+        BaseGlobalAttribute*& attr = global_attrs_[it.first];
+        delete attr;
+        attr = it.second->clone();
       }
     }
     return *this;
@@ -88,6 +92,12 @@ public:
     return val;
   }
 
+  // Whether an attribute with this name exists
+  bool has_attribute(const std::string& name) const
+  {
+    return global_attrs_.find(name) != global_attrs_.end();
+  }
+
   // Get an attribute by its name
   template <class T>
   T& get_attribute(const std::string& name)
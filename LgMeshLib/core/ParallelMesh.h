@@ -0,0 +1,128 @@
+#ifndef LGMESH_PARALLELMESH_H
+#define LGMESH_PARALLELMESH_H
+
+#include "PolygonMesh.h"
+#include "Parallel.h"
+
+namespace LG {
+
+// Parallel loops over the element ranges of a mesh, e.g.
+//
+//   parallel_for_each(mesh.faces(), [&](PolygonMesh::Face f) { ... });
+//
+//   Scalar area = parallel_reduce(mesh.faces(), Scalar(0),
+//                   [&](PolygonMesh::Face f) { return face_area(f); },
+//                   [](Scalar a, Scalar b) { return a + b; });
+//
+// The index range is cut into grains that are processed in parallel.
+// Deleted elements are skipped, and the deleted flags are only read when
+// the mesh is not compact. The function is called concurrently for
+// different elements, so it must only write data owned by its element.
+
+namespace detail {
+
+template <class Handle, class Iterator, class Function>
+void parallel_for_each_impl(const Iterator& begin, const Iterator& end, const Function& fn, size_t grain)
+{
+  const PolygonMesh* mesh = begin.mesh();
+  const size_t first = (*begin).idx(), last = (*end).idx();
+  const bool skip_deleted = mesh && !mesh->is_compact();
+
+  parallel_for(first, last, grain, [&](size_t b, size_t e)
+  {
+    for (size_t i = b; i < e; ++i)
+    {
+      Handle h((int)i);
+      if (skip_deleted && mesh->is_deleted(h))
+      {
+        continue;
+      }
+      fn(h);
+    }
+  });
+}
+
+// Blocks of `grain` elements are reduced in parallel and combined in order,
+// see parallel_reduce() in Parallel.h.
+template <class Handle, class Iterator, class T, class Map, class Reduce>
+T parallel_reduce_impl(const Iterator& begin, const Iterator& end, const T& identity,
+                       const Map& map, const Reduce& reduce, size_t grain)
+{
+  const PolygonMesh* mesh = begin.mesh();
+  const size_t first = (*begin).idx(), last = (*end).idx();
+  const bool skip_deleted = mesh && !mesh->is_compact();
+
+  return parallel_reduce(first, last, grain, identity, [&](size_t b, size_t e, T value)
+  {
+    for (size_t i = b; i < e; ++i)
+    {
+      Handle h((int)i);
+      if (skip_deleted && mesh->is_deleted(h))
+      {
+        continue;
+      }
+      value = reduce(value, map(h));
+    }
+    return value;
+  }, reduce);
+}
+
+}
+
+
+template <class Function>
+void parallel_for_each(const PolygonMesh::Vertex_container& range, const Function& fn, size_t grain = 1024)
+{
+  detail::parallel_for_each_impl<PolygonMesh::Vertex>(range.begin(), range.end(), fn, grain);
+}
+
+template <class Function>
+void parallel_for_each(const PolygonMesh::Halfedge_container& range, const Function& fn, size_t grain = 1024)
+{
+  detail::parallel_for_each_impl<PolygonMesh::Halfedge>(range.begin(), range.end(), fn, grain);
+}
+
+template <class Function>
+void parallel_for_each(const PolygonMesh::Edge_container& range, const Function& fn, size_t grain = 1024)
+{
+  detail::parallel_for_each_impl<PolygonMesh::Edge>(range.begin(), range.end(), fn, grain);
+}
+
+template <class Function>
+void parallel_for_each(const PolygonMesh::Face_container& range, const Function& fn, size_t grain = 1024)
+{
+  detail::parallel_for_each_impl<PolygonMesh::Face>(range.begin(), range.end(), fn, grain);
+}
+
+
+template <class T, class Map, class Reduce>
+T parallel_reduce(const PolygonMesh::Vertex_container& range, const T& identity,
+                  const Map& map, const Reduce& reduce, size_t grain = 1024)
+{
+  return detail::parallel_reduce_impl<PolygonMesh::Vertex>(range.begin(), range.end(), identity, map, reduce, grain);
+}
+
+template <class T, class Map, class Reduce>
+T parallel_reduce(const PolygonMesh::Halfedge_container& range, const T& identity,
+                  const Map& map, const Reduce& reduce, size_t grain = 1024)
+{
+  return detail::parallel_reduce_impl<PolygonMesh::Halfedge>(range.begin(), range.end(), identity, map, reduce, grain);
+}
+
+template <class T, class Map, class Reduce>
+T parallel_reduce(const PolygonMesh::Edge_container& range, const T& identity,
+                  const Map& map, const Reduce& reduce, size_t grain = 1024)
+{
+  return detail::parallel_reduce_impl<PolygonMesh::Edge>(range.begin(), range.end(), identity, map, reduce, grain);
+}
+
+template <class T, class Map, class Reduce>
+T parallel_reduce(const PolygonMesh::Face_container& range, const T& identity,
+                  const Map& map, const Reduce& reduce, size_t grain = 1024)
+{
+  return detail::parallel_reduce_impl<PolygonMesh::Face>(range.begin(), range.end(), identity, map, reduce, grain);
+}
+
+}
+
+#endif // !LGMESH_PARALLELMESH_H
@@ -1,5 +1,9 @@
 #include "PolygonMesh.h"
+#include "FrozenConnectivity.h"
 #include "IO.h"
+#include "ParallelMesh.h"
+
+#include <atomic>
 
 namespace LG {
 
@@ -9,7 +13,14 @@ PolygonMesh::PolygonMesh()
   // allocate standard properties
   // same list is used in operator=() and assign()
   vconn_    = add_vertex_attribute<Vertex_connectivity>("v:connectivity");
+#ifdef LGMESH_HALFEDGE_SOA
+  hface_    = add_halfedge_attribute<Face>("h:face");
+  hvertex_  = add_halfedge_attribute<Vertex>("h:vertex");
+  hnext_    = add_halfedge_attribute<Halfedge>("h:next");
+  hprev_    = add_halfedge_attribute<Halfedge>("h:prev");
+#else
   hconn_    = add_halfedge_attribute<Halfedge_connectivity>("h:connectivity");
+#endif
   fconn_    = add_face_attribute<Face_connectivity>("f:connectivity");
   vpoint_   = add_vertex_attribute<Vec3>("v:point");
   vdeleted_ = add_vertex_attribute<bool>("v:deleted", false);
@@ -18,6 +29,13 @@ PolygonMesh::PolygonMesh()
 
   deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
   garbage_ = false;
+
+  use_edge_index_ = false;
+
+  topology_generation_ = 0;
+  geometry_generation_ = moved_log_start_ = 0;
+  normals_valid_ = false;
+  refresh_stamp_ = 0;
 }
 
 PolygonMesh::~PolygonMesh()
@@ -45,7 +63,14 @@ operator=(const PolygonMesh& rhs)
 
     // property handles contain pointers, have to be reassigned
     vconn_    = vertex_attribute<Vertex_connectivity>("v:connectivity");
+#ifdef LGMESH_HALFEDGE_SOA
+    hface_    = halfedge_attribute<Face>("h:face");
+    hvertex_  = halfedge_attribute<Vertex>("h:vertex");
+    hnext_    = halfedge_attribute<Halfedge>("h:next");
+    hprev_    = halfedge_attribute<Halfedge>("h:prev");
+#else
     hconn_    = halfedge_attribute<Halfedge_connectivity>("h:connectivity");
+#endif
     fconn_    = face_attribute<Face_connectivity>("f:connectivity");
     vdeleted_ = vertex_attribute<bool>("v:deleted");
     edeleted_ = edge_attribute<bool>("e:deleted");
@@ -61,6 +86,16 @@ operator=(const PolygonMesh& rhs)
     deleted_edges_    = rhs.deleted_edges_;
     deleted_faces_    = rhs.deleted_faces_;
     garbage_          = rhs.garbage_;
+
+    edge_index_     = rhs.edge_index_;
+    use_edge_index_ = rhs.use_edge_index_;
+
+    // snapshots refer to their own mesh, the copy builds a new one on demand
+    ++topology_generation_;
+    frozen_.reset();
+
+    log_moved_all();
+    normals_valid_ = false;
   }
 
   return *this;
@@ -275,6 +310,256 @@ PolygonMesh::add_face(const std::vector<Vertex>& vertices)
 }
 
 
+bool PolygonMesh::add_triangles(const std::vector<Vec3>& points, const std::vector<int>& triangles)
+{
+  const int nv = (int)points.size();
+  const int nh = (int)triangles.size();
+  const int nf = nh / 3;
+  if (nh % 3 != 0)
+  {
+    std::cerr << "PolygonMesh::add_triangles: index count is not a multiple of 3" << std::endl;
+    return false;
+  }
+
+  for (int f = 0; f < nf; ++f)
+  {
+    const int* t = &triangles[3 * f];
+    if (t[0] < 0 || t[1] < 0 || t[2] < 0 || t[0] >= nv || t[1] >= nv || t[2] >= nv)
+    {
+      std::cerr << "PolygonMesh::add_triangles: vertex index out of range" << std::endl;
+      return false;
+    }
+    if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0])
+    {
+      std::cerr << "PolygonMesh::add_triangles: degenerate triangle" << std::endl;
+      return false;
+    }
+  }
+
+  // corner k = 3 f + i of the input is the face halfedge from triangles[k]
+  // to the next vertex of triangle f
+  auto from = [&](int k) { return triangles[k]; };
+  auto to   = [&](int k) { return triangles[k - k % 3 + (k % 3 + 1) % 3]; };
+
+  // bucket the face halfedges by their smaller vertex (counting sort)
+  std::vector<int> bucket_start(nv + 1, 0);
+  for (int k = 0; k < nh; ++k)
+  {
+    ++bucket_start[std::min(from(k), to(k)) + 1];
+  }
+  for (int v = 0; v < nv; ++v)
+  {
+    bucket_start[v + 1] += bucket_start[v];
+  }
+  std::vector<int> bucket(nh);
+  {
+    std::vector<int> fill(bucket_start.begin(), bucket_start.end() - 1);
+    for (int k = 0; k < nh; ++k)
+    {
+      bucket[fill[std::min(from(k), to(k))]++] = k;
+    }
+  }
+
+  // pair opposite halfedges within the buckets and count the edges
+  std::vector<int> twin(nh, -1);
+  std::vector<int> edge_start(nv + 1, 0);
+  std::atomic<bool> complex_edge(false);
+  parallel_for(0, nv, 1024, [&](size_t first, size_t last)
+  {
+    for (size_t v = first; v < last; ++v)
+    {
+      int edges = 0;
+      for (int i = bucket_start[v]; i < bucket_start[v + 1]; ++i)
+      {
+        const int k = bucket[i];
+        const int other = from(k) + to(k) - (int)v;
+        int matches = 0;
+        for (int j = bucket_start[v]; j < bucket_start[v + 1]; ++j)
+        {
+          const int kk = bucket[j];
+          if (kk != k && from(kk) + to(kk) - (int)v == other)
+          {
+            ++matches;
+            if (from(kk) == from(k))
+            {
+              matches = 2;  // same direction, inconsistent orientation
+            }
+            twin[k] = kk;
+          }
+        }
+        if (matches > 1)
+        {
+          complex_edge = true;
+        }
+        if (twin[k] < 0 || k < twin[k])
+        {
+          ++edges;
+        }
+      }
+      edge_start[v + 1] = edges;
+    }
+  });
+  if (complex_edge)
+  {
+    std::cerr << "PolygonMesh::add_triangles: complex edge" << std::endl;
+    return false;
+  }
+  for (int v = 0; v < nv; ++v)
+  {
+    edge_start[v + 1] += edge_start[v];
+  }
+  const int ne = edge_start[nv];
+
+  // number the edges bucket by bucket, the halfedge of the first corner of
+  // an edge is its halfedge 0, the opposite corner or the boundary its halfedge 1
+  std::vector<int> corner_halfedge(nh);
+  parallel_for(0, nv, 1024, [&](size_t first, size_t last)
+  {
+    for (size_t v = first; v < last; ++v)
+    {
+      int e = edge_start[v];
+      for (int i = bucket_start[v]; i < bucket_start[v + 1]; ++i)
+      {
+        const int k = bucket[i];
+        if (twin[k] < 0 || k < twin[k])
+        {
+          corner_halfedge[k] = 2 * e;
+          if (twin[k] >= 0)
+          {
+            corner_halfedge[twin[k]] = 2 * e + 1;
+          }
+          ++e;
+        }
+      }
+    }
+  });
+
+  // connectivity of the new elements, local indices, -1 for none
+  std::vector<int> halfedge_vertex(2 * ne), halfedge_next(2 * ne), halfedge_face(2 * ne, -1);
+  std::vector<int> vertex_halfedge(nv, -1), boundary_out(nv, -1), degree(nv, 0);
+  for (int k = 0; k < nh; ++k)
+  {
+    const int h = corner_halfedge[k];
+    halfedge_vertex[h] = to(k);
+    halfedge_next[h]   = corner_halfedge[k - k % 3 + (k % 3 + 1) % 3];
+    halfedge_face[h]   = k / 3;
+    vertex_halfedge[from(k)] = h;
+    ++degree[from(k)];
+    if (twin[k] < 0)
+    {
+      // the boundary halfedge runs from to(k) back to from(k)
+      halfedge_vertex[h ^ 1] = from(k);
+      if (boundary_out[to(k)] >= 0)
+      {
+        std::cerr << "PolygonMesh::add_triangles: complex vertex" << std::endl;
+        return false;
+      }
+      boundary_out[to(k)] = h ^ 1;
+      ++degree[to(k)];
+    }
+  }
+  for (int v = 0; v < nv; ++v)
+  {
+    const int b = boundary_out[v];
+    if (b >= 0)
+    {
+      vertex_halfedge[v] = b;
+      halfedge_next[b] = boundary_out[halfedge_vertex[b]];
+    }
+  }
+
+  // a vertex whose outgoing halfedges are not all reached by one rotation
+  // joins several closed fans
+  std::atomic<bool> complex_vertex(false);
+  parallel_for(0, nv, 1024, [&](size_t first, size_t last)
+  {
+    for (size_t v = first; v < last; ++v)
+    {
+      const int hh = vertex_halfedge[v];
+      if (hh < 0)
+      {
+        continue;
+      }
+      int n = 0, h = hh;
+      do
+      {
+        h = halfedge_next[h ^ 1];
+        ++n;
+      } while (h != hh && n <= degree[v]);
+      if (n != degree[v])
+      {
+        complex_vertex = true;
+      }
+    }
+  });
+  if (complex_vertex)
+  {
+    std::cerr << "PolygonMesh::add_triangles: complex vertex" << std::endl;
+    return false;
+  }
+
+  // append the elements
+  const int v0 = (int)vertices_size(), h0 = (int)halfedges_size(), f0 = (int)faces_size();
+  vattrs_.resize(v0 + nv);
+  hattrs_.resize(h0 + 2 * ne);
+  eattrs_.resize(h0 / 2 + ne);
+  fattrs_.resize(f0 + nf);
+
+  parallel_for(0, nv, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Vertex v(v0 + (int)i);
+      vpoint_[v] = points[i];
+      vconn_[v].halfedge_ = (vertex_halfedge[i] >= 0) ? Halfedge(h0 + vertex_halfedge[i]) : Halfedge();
+    }
+  });
+  parallel_for(0, 2 * ne, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Halfedge h(h0 + (int)i);
+      const Vertex   vertex(v0 + halfedge_vertex[i]);
+      const Face     face = (halfedge_face[i] >= 0) ? Face(f0 + halfedge_face[i]) : Face();
+      const Halfedge next(h0 + halfedge_next[i]);
+#ifdef LGMESH_HALFEDGE_SOA
+      hvertex_[h] = vertex;
+      hface_[h]   = face;
+      hnext_[h]   = next;
+      hprev_[next] = h;
+#else
+      hconn_[h].vertex_        = vertex;
+      hconn_[h].face_          = face;
+      hconn_[h].next_halfedge_ = next;
+      hconn_[next].prev_halfedge_ = h;
+#endif
+    }
+  });
+  parallel_for(0, nf, 4096, [&](size_t first, size_t last)
+  {
+    for (size_t f = first; f < last; ++f)
+    {
+      fconn_[Face(f0 + (int)f)].halfedge_ = Halfedge(h0 + corner_halfedge[3 * f]);
+    }
+  });
+
+  if (use_edge_index_)
+  {
+    edge_index_.reserve(ne);
+    parallel_for(0, ne, 4096, [&](size_t first, size_t last)
+    {
+      for (size_t e = first; e < last; ++e)
+      {
+        edge_index_.concurrent_insert(v0 + halfedge_vertex[2 * e + 1], v0 + halfedge_vertex[2 * e], h0 / 2 + (int)e);
+      }
+    });
+  }
+
+  ++topology_generation_;
+  return true;
+}
+
+
 
 bool PolygonMesh::read(const std::string& filename)
 {
@@ -306,6 +591,15 @@ void PolygonMesh::clear()
 
   deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
   garbage_ = false;
+
+  // the index stays enabled, but it is empty now
+  edge_index_.clear();
+
+  ++topology_generation_;
+  frozen_.reset();
+
+  log_moved_all();
+  normals_valid_ = false;
 }
 
 // free redundant memory, different from clear()
@@ -334,6 +628,17 @@ PolygonMesh::find_halfedge(Vertex start, Vertex end) const
 {
   assert(is_valid(start) && is_valid(end));
 
+  if (use_edge_index_)
+  {
+    Edge e(edge_index_.find(start.idx(), end.idx()));
+    if (!e.is_valid() || is_deleted(e))
+    {
+      return Halfedge();
+    }
+    Halfedge h0 = halfedge(e, 0);
+    return (to_vertex(h0) == end) ? h0 : halfedge(e, 1);
+  }
+
   Halfedge h  = halfedge(start);
   const Halfedge hh = h;
 
@@ -352,6 +657,50 @@ PolygonMesh::find_halfedge(Vertex start, Vertex end) const
   return Halfedge();
 }
 
+PolygonMesh::Edge
+PolygonMesh::find_edge(Vertex v0, Vertex v1) const
+{
+  Halfedge h = find_halfedge(v0, v1);
+  return h.is_valid() ? edge(h) : Edge();
+}
+
+void PolygonMesh::enable_edge_index()
+{
+  edge_index_.clear();
+  edge_index_.reserve(n_edges());
+
+  // every edge owns a distinct vertex pair, so the insertions do not conflict
+  parallel_for(0, edges_size(), 4096, [this](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; ++i)
+    {
+      Edge e((int)i);
+      if (!garbage_ || !is_deleted(e))
+      {
+        edge_index_.concurrent_insert(vertex(e, 0).idx(), vertex(e, 1).idx(), e.idx());
+      }
+    }
+  });
+
+  use_edge_index_ = true;
+}
+
+void PolygonMesh::disable_edge_index()
+{
+  use_edge_index_ = false;
+  edge_index_.clear();
+}
+
+const FrozenConnectivity& PolygonMesh::freeze() const
+{
+  if (!frozen_ || !frozen_->is_current(*this))
+  {
+    frozen_.reset();
+    frozen_ = std::make_shared<const FrozenConnectivity>(*this);
+  }
+  return *frozen_;
+}
+
 
 
 void PolygonMesh::update_face_normals()
@@ -361,11 +710,7 @@ void PolygonMesh::update_face_normals()
     fnormal_ = face_attribute<Vec3>("f:normal");
   }
 
-  Face_iterator fit = faces_begin(), fend = faces_end();
-  for (; fit != fend; ++fit)
-  {
-    fnormal_[*fit] = compute_face_normal(*fit);
-  }
+  compute_face_normals(fnormal_.vector(), false);
 }
 
 Vec3 PolygonMesh::compute_face_normal(Face f) const
@@ -379,15 +724,14 @@ Vec3 PolygonMesh::compute_face_normal(Face f) const
   h = next_halfedge(h);
   Vec3 p2 = vpoint_[to_vertex(h)];
 
+  Vec3 n(0, 0, 0);
   if (next_halfedge(h) == hend)
   {
     // if it is a triangle
-    return (p2 - p1).cross(p0 - p1).normalized();
+    n = (p2 - p1).cross(p0 - p1);
   }
   else
   {
-    Vec3 n(0, 0, 0);
-    
     hend = h;
     do 
     {
@@ -397,43 +741,300 @@ Vec3 PolygonMesh::compute_face_normal(Face f) const
       p1 = p2;
       p2 = vpoint_[to_vertex(h)];
     } while (h != hend);
+  }
 
-    return n.normalized();
+  // zero for degenerate faces, as in compute_face_normals()
+  Scalar l = n.norm();
+  return (l > 0) ? Vec3(n / l) : n;
+}
+
+Vec3 PolygonMesh::compute_face_area_normal(Face f) const
+{
+  // relative to the first corner to avoid cancellation for small faces far from the origin
+  Vec3 n(0, 0, 0);
+  Halfedge h = halfedge(f);
+  const Vec3& o = vpoint_[from_vertex(h)];
+  h = next_halfedge(h);
+  Halfedge hend = prev_halfedge(halfedge(f));
+  for (; h != hend; h = next_halfedge(h))
+  {
+    n += (vpoint_[from_vertex(h)] - o).cross(vpoint_[to_vertex(h)] - o);
   }
+  return n;
+}
+
+Scalar PolygonMesh::corner_angle(Halfedge h) const
+{
+  const Vec3& p = vpoint_[from_vertex(h)];
+  Vec3 d0 = vpoint_[to_vertex(h)] - p;
+  Vec3 d1 = vpoint_[from_vertex(prev_halfedge(h))] - p;
+  return std::atan2(d0.cross(d1).norm(), d0.dot(d1));
+}
+
+void PolygonMesh::compute_face_normals(std::vector<Vec3>& normals, bool area_weighted) const
+{
+  const FrozenConnectivity& fc = freeze();
+  const std::vector<int>&    offsets = fc.face_vertex_offsets();
+  const std::vector<Vertex>& fv      = fc.face_vertices();
+  const std::vector<Vec3>&   points  = vpoint_.vector();
+
+  normals.resize(faces_size());
+
+  parallel_for(0, faces_size(), 1024, [&](size_t first, size_t last)
+  {
+    // triangles are gathered into blocks of edge vectors (structure of arrays),
+    // the cross products are then computed in plain loops that vectorize
+    const size_t BLOCK = 64;
+    Scalar ax[BLOCK], ay[BLOCK], az[BLOCK], bx[BLOCK], by[BLOCK], bz[BLOCK];
+    Scalar nx[BLOCK], ny[BLOCK], nz[BLOCK];
+    size_t face[BLOCK];
+    size_t n_block = 0;
+
+    auto flush = [&]()
+    {
+      for (size_t k = 0; k < n_block; ++k)
+      {
+        nx[k] = ay[k] * bz[k] - az[k] * by[k];
+        ny[k] = az[k] * bx[k] - ax[k] * bz[k];
+        nz[k] = ax[k] * by[k] - ay[k] * bx[k];
+      }
+      if (!area_weighted)
+      {
+        for (size_t k = 0; k < n_block; ++k)
+        {
+          Scalar l = std::sqrt(nx[k] * nx[k] + ny[k] * ny[k] + nz[k] * nz[k]);
+          Scalar s = (l > 0) ? Scalar(1) / l : Scalar(0);
+          nx[k] *= s;
+          ny[k] *= s;
+          nz[k] *= s;
+        }
+      }
+      for (size_t k = 0; k < n_block; ++k)
+      {
+        normals[face[k]] = Vec3(nx[k], ny[k], nz[k]);
+      }
+      n_block = 0;
+    };
+
+    for (size_t i = first; i < last; ++i)
+    {
+      const int begin = offsets[i], valence = offsets[i + 1] - begin;
+      if (valence == 3)
+      {
+        // same orientation as compute_face_normal(): (p2 - p1) x (p0 - p1)
+        const Vec3& p0 = points[fv[begin].idx()];
+        const Vec3& p1 = points[fv[begin + 1].idx()];
+        const Vec3& p2 = points[fv[begin + 2].idx()];
+        ax[n_block] = p2[0] - p1[0]; ay[n_block] = p2[1] - p1[1]; az[n_block] = p2[2] - p1[2];
+        bx[n_block] = p0[0] - p1[0]; by[n_block] = p0[1] - p1[1]; bz[n_block] = p0[2] - p1[2];
+        face[n_block] = i;
+        if (++n_block == BLOCK)
+        {
+          flush();
+        }
+      }
+      else if (valence > 3)
+      {
+        Face f((int)i);
+        normals[i] = area_weighted ? compute_face_area_normal(f) : compute_face_normal(f);
+      }
+      else
+      {
+        // deleted face
+        normals[i] = Vec3(0, 0, 0);
+      }
+    }
+    flush();
+  });
 }
 
-void PolygonMesh::update_vertex_normals()
+void PolygonMesh::update_vertex_normals(Normal_weighting weighting)
 {
   if (!vnormal_)
   {
     vnormal_ = vertex_attribute<Vec3>("v:normal");
   }
 
-  Vertex_iterator vit = vertices_begin(), vend = vertices_end();
-  for (; vit != vend; ++vit)
+  // every face normal is computed exactly once
+  std::vector<Vec3> face_normals;
+  compute_face_normals(face_normals, weighting == AREA_WEIGHTING);
+
+  const FrozenConnectivity& fc = freeze();
+
+  // gather per vertex: each vertex is owned by one thread and sums its faces
+  // in circulator order, which keeps the result deterministic
+  parallel_for(0, vertices_size(), 1024, [&](size_t first, size_t last)
   {
-    vnormal_[*vit] = compute_vertex_normal(*vit);
-  }
+    for (size_t i = first; i < last; ++i)
+    {
+      Vertex v((int)i);
+      Vec3 n(0, 0, 0);
+
+      if (weighting == ANGLE_WEIGHTING)
+      {
+        Halfedge_around_vertex_circulator hc = halfedges(v), hc_end = hc;
+        if (hc)
+        {
+          do
+          {
+            if (!is_boundary(*hc))
+            {
+              n += corner_angle(*hc) * face_normals[face(*hc).idx()];
+            }
+          } while (++hc != hc_end);
+        }
+      }
+      else
+      {
+        FrozenConnectivity::Face_range faces = fc.faces(v);
+        for (const Face* f = faces.begin(); f != faces.end(); ++f)
+        {
+          n += face_normals[f->idx()];
+        }
+      }
+
+      Scalar l = n.norm();
+      vnormal_[v] = (l > 0) ? Vec3(n / l) : n;
+    }
+  });
 }
 
-Vec3 PolygonMesh::compute_vertex_normal(Vertex v) const
+Vec3 PolygonMesh::compute_vertex_normal(Vertex v, Normal_weighting weighting) const
 {
   Vec3 n(0, 0, 0);
-  Face_around_vertex_circulator fc, fc_end;
-  fc = fc_end = faces(v);
+  Halfedge_around_vertex_circulator hc, hc_end;
+  hc = hc_end = halfedges(v);
 
-  if (fc)
+  if (hc)
   {
     do 
     {
-      n += compute_face_normal(*fc);
-    } while (++fc != fc_end);
-    n.normalize();
+      if (is_boundary(*hc))
+      {
+        continue;
+      }
+      Face f = face(*hc);
+      switch (weighting)
+      {
+      case UNIFORM_WEIGHTING:
+        n += compute_face_normal(f);
+        break;
+      case AREA_WEIGHTING:
+        n += compute_face_area_normal(f);
+        break;
+      case ANGLE_WEIGHTING:
+        n += corner_angle(*hc) * compute_face_normal(f);
+        break;
+      }
+    } while (++hc != hc_end);
+
+    Scalar l = n.norm();
+    if (l > 0)
+    {
+      n /= l;
+    }
   }
 
   return n;
 }
 
+void PolygonMesh::refresh_normals(Normal_weighting weighting)
+{
+  std::vector<Vertex> moved;
+  bool incremental = normals_valid_ && fnormal_ && vnormal_
+                  && normals_weighting_ == weighting
+                  && normals_topology_generation_ == topology_generation_
+                  && moved_vertices(normals_geometry_generation_, moved);
+
+  if (!incremental)
+  {
+    update_face_normals();
+    update_vertex_normals(weighting);
+
+    refresh_vertex_stamp_.assign(vertices_size(), 0);
+    refresh_face_stamp_.assign(faces_size(), 0);
+    refresh_stamp_ = 0;
+  }
+  else if (!moved.empty())
+  {
+    if (++refresh_stamp_ == 0)
+    {
+      // wrapped around, old stamps could collide
+      std::fill(refresh_vertex_stamp_.begin(), refresh_vertex_stamp_.end(), 0);
+      std::fill(refresh_face_stamp_.begin(), refresh_face_stamp_.end(), 0);
+      refresh_stamp_ = 1;
+    }
+
+    // faces around the moved vertices
+    std::vector<Face> faces;
+    for (size_t i = 0; i < moved.size(); ++i)
+    {
+      Face_around_vertex_circulator fc = this->faces(moved[i]), fc_end = fc;
+      if (fc)
+      {
+        do
+        {
+          if (refresh_face_stamp_[(*fc).idx()] != refresh_stamp_)
+          {
+            refresh_face_stamp_[(*fc).idx()] = refresh_stamp_;
+            faces.push_back(*fc);
+          }
+        } while (++fc != fc_end);
+      }
+    }
+
+    // vertices of these faces see a changed face normal
+    std::vector<Vertex> vertices;
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+      Vertex_around_face_circulator vc = this->vertices(faces[i]), vc_end = vc;
+      do
+      {
+        if (refresh_vertex_stamp_[(*vc).idx()] != refresh_stamp_)
+        {
+          refresh_vertex_stamp_[(*vc).idx()] = refresh_stamp_;
+          vertices.push_back(*vc);
+        }
+      } while (++vc != vc_end);
+    }
+
+    parallel_for(0, faces.size(), 512, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        fnormal_[faces[i]] = compute_face_normal(faces[i]);
+      }
+    });
+
+    parallel_for(0, vertices.size(), 512, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; ++i)
+      {
+        vnormal_[vertices[i]] = compute_vertex_normal(vertices[i], weighting);
+      }
+    });
+  }
+
+  normals_valid_               = true;
+  normals_weighting_           = weighting;
+  normals_topology_generation_ = topology_generation_;
+  normals_geometry_generation_ = geometry_generation_;
+}
+
+bool PolygonMesh::moved_vertices(unsigned long since, std::vector<Vertex>& vertices) const
+{
+  vertices.clear();
+  if (since < moved_log_start_)
+  {
+    return false;
+  }
+  if (since - moved_log_start_ < moved_log_.size())
+  {
+    vertices.assign(moved_log_.begin() + (since - moved_log_start_), moved_log_.end());
+  }
+  return true;
+}
+
 Scalar PolygonMesh::edge_length(Edge e) const
 {
   return (vpoint_[vertex(e, 0)] - vpoint_[vertex(e, 1)]).norm();
@@ -446,11 +1047,10 @@ void PolygonMesh::update_laplacian_cot()
   // (cot(alpha) + cot(beta)) / 2
   PolygonMesh::Edge_attribute<Scalar> laplacian_cot = edge_attribute<Scalar>("e:laplacian_cot");
 
-  Edge_iterator eit = edges_begin(), eend = edges_end();
-  for (; eit != eend; ++eit)
+  parallel_for_each(edges(), [&](Edge e)
   {
-    laplacian_cot[*eit] = compute_laplacian_cot(*eit);
-  }
+    laplacian_cot[e] = compute_laplacian_cot(e);
+  });
 }
 
 Scalar PolygonMesh::compute_laplacian_cot(Edge e) const
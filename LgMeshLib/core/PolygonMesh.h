@@ -2,12 +2,25 @@
 #define PolygonMesh_H
 
 #include "Attributes.h"
+#include "EdgeIndex.h"
 #include "Kernel.h"
 #include "LgMeshTypes.h"
 
+#include <memory>
+
 namespace LG {
 
+class FrozenConnectivity;
+
 
+// Halfedge data structure for polygon meshes.
+//
+// VERTEX POSITIONS HAVE TO BE CHANGED THROUGH set_position(), OR WRITTEN
+// THROUGH points_matrix() FOLLOWED BY points_changed(). Only these advance
+// geometry_generation(), which the geometry caches check: normals of
+// refresh_normals(), BVH and SpatialHash update(), the Laplacian solver
+// caches, ... The writable position(v) and points() overloads are
+// deprecated, writes through them go unnoticed and leave the caches stale.
 class PolygonMesh : public Kernel
 {
 
@@ -102,6 +115,7 @@ public: //-------------------------------------------------- connectivity types
 
   // This type stores the halfedge connectivity
   // a Vertex_connectivity, Face_connectivity
+  // (with LGMESH_HALFEDGE_SOA defined its fields live in separate arrays)
   struct Halfedge_connectivity
   {
     /// face incident to halfedge
@@ -228,6 +242,9 @@ public://--- iterator types
     // get the vertex the iterator refers to
     Vertex operator*() const { return hnd_; };
 
+    // the mesh the iterator belongs to
+    const PolygonMesh* mesh() const { return mesh_; };
+
     // are two iterators equal?
     bool operator==(const Vertex_iterator& rhs) const
     {
@@ -286,6 +303,9 @@ public://--- iterator types
 
     Halfedge operator*() const { return hnd_; };
 
+    // the mesh the iterator belongs to
+    const PolygonMesh* mesh() const { return mesh_; };
+
     bool operator==(const Halfedge_iterator& rhs) const
     {
       return (hnd_ == rhs.hnd_);
@@ -341,6 +361,9 @@ public://--- iterator types
 
     Edge operator*() const { return hnd_; };
 
+    // the mesh the iterator belongs to
+    const PolygonMesh* mesh() const { return mesh_; };
+
     bool operator==(const Edge_iterator& rhs) const
     {
       return (hnd_ == rhs.hnd_);
@@ -395,6 +418,9 @@ public://--- iterator types
 
     Face operator*() const { return hnd_; };
 
+    // the mesh the iterator belongs to
+    const PolygonMesh* mesh() const { return mesh_; };
+
     bool operator==(const Face_iterator& rhs) const
     {
       return (hnd_ == rhs.hnd_);
@@ -778,7 +804,7 @@ public: //--- constructor / destructor
 
   virtual ~PolygonMesh();
 
-  PolygonMesh(const PolygonMesh& rhs) { operator=(rhs); };
+  PolygonMesh(const PolygonMesh& rhs) : geometry_generation_(0), topology_generation_(0) { operator=(rhs); };
 
   PolygonMesh& operator=(const PolygonMesh& rhs);
 
@@ -805,6 +831,15 @@ public: //--- add new vertex / face
   // use add_face() API above
   Face add_quad(Vertex v0, Vertex v1, Vertex v2, Vertex v3);
 
+  // Append points as new vertices and the triangles given as index triples
+  // into points in one pass: halfedges are paired by sorting instead of one
+  // find_halfedge() per corner and all arrays are resized once, which makes
+  // it much faster than add_face() for large generated meshes. The
+  // triangles have to form an oriented manifold (no edge with more than two
+  // triangles, no vertex where several fans meet); otherwise false is
+  // returned and the mesh is left unchanged.
+  bool add_triangles(const std::vector<Vec3>& points, const std::vector<int>& triangles);
+
 
 public: //--- memory management
 
@@ -831,6 +866,10 @@ public: //--- memory management
 
   void garbage_collection();
 
+  // true if no element is flagged deleted, i.e. the attribute arrays hold
+  // live elements only and can be processed as dense blocks
+  bool is_compact() const { return !garbage_; };
+
   // returns whether vertex v is deleted
   bool is_deleted(Vertex v) const
   {
@@ -884,6 +923,7 @@ public: //--- low-level connectivity
   // set the outgoing halfedge of vertex v to h
   void set_halfedge(Vertex v, Halfedge h)
   {
+    ++topology_generation_;
     vconn_[v].halfedge_ = h;
   }
 
@@ -920,7 +960,11 @@ public: //--- low-level connectivity
 
   Vertex to_vertex(Halfedge h) const
   {
+#ifdef LGMESH_HALFEDGE_SOA
+    return hvertex_[h];
+#else
     return hconn_[h].vertex_;
+#endif
   }
 
   Vertex from_vertex(Halfedge h) const
@@ -930,33 +974,61 @@ public: //--- low-level connectivity
 
   void set_vertex(Halfedge h, Vertex v)
   {
+    ++topology_generation_;
+#ifdef LGMESH_HALFEDGE_SOA
+    hvertex_[h] = v;
+#else
     hconn_[h].vertex_ = v;
+#endif
   }
 
   Face face(Halfedge h) const
   {
+#ifdef LGMESH_HALFEDGE_SOA
+    return hface_[h];
+#else
     return hconn_[h].face_;
+#endif
   }
 
   void set_face(Halfedge h, Face f)
   {
+    ++topology_generation_;
+#ifdef LGMESH_HALFEDGE_SOA
+    hface_[h] = f;
+#else
     hconn_[h].face_ = f;
+#endif
   }
 
   Halfedge next_halfedge(Halfedge h) const
   {
+#ifdef LGMESH_HALFEDGE_SOA
+    return hnext_[h];
+#else
     return hconn_[h].next_halfedge_;
+#endif
   }
 
   void set_next_halfedge(Halfedge h, Halfedge nh)
   {
+    ++topology_generation_;
+#ifdef LGMESH_HALFEDGE_SOA
+    hnext_[h]  = nh;
+    hprev_[nh] = h;
+#else
     hconn_[h].next_halfedge_ = nh;
     hconn_[nh].prev_halfedge_ = h;
+#endif
   }
 
   Halfedge prev_halfedge(Halfedge h) const
   {
+#ifdef LGMESH_HALFEDGE_SOA
+    return hprev_[h];
+#else
     return hconn_[h].prev_halfedge_;
+#endif
   }
 
   Halfedge opposite_halfedge(Halfedge h) const
@@ -1017,6 +1089,7 @@ public: //--- low-level connectivity
 
   void set_halfedge(Face f, Halfedge h)
   {
+    ++topology_generation_;
     fconn_[f].halfedge_ = h;
   }
 
@@ -1293,24 +1366,94 @@ public: // ---higher-level operations
 
   // TODO
 
+  // find the halfedge from start to end, uses the edge index when it is enabled
   Halfedge find_halfedge(Vertex start, Vertex end) const;
 
+  // find the edge connecting v0 and v1
+  Edge find_edge(Vertex v0, Vertex v1) const;
+
+public: //--- edge index
+
+  // build a hash index over all edges (in parallel) and keep it up to date,
+  // turns find_halfedge() / find_edge() into O(1) queries on high-valence vertices
+  void enable_edge_index();
+
+  void disable_edge_index();
+
+  bool has_edge_index() const { return use_edge_index_; };
+
+public: //--- geometry change tracking
+
+  // counter that increases with every change of a vertex position made
+  // through set_position() or announced by mark_moved() / points_changed()
+  unsigned long geometry_generation() const { return geometry_generation_; };
+
+  // announce that v was moved through the writable position(v)
+  void mark_moved(Vertex v) { log_moved_vertex(v); };
+
+  // announce that any number of positions were written through points()
+  void points_changed() { log_moved_all(); };
+
+  // collect the vertices moved after geometry generation `since` (may contain
+  // duplicates). Returns false if that information is no longer available,
+  // e.g. after points_changed() or too many moves were logged; callers then
+  // have to treat all vertices as moved.
+  bool moved_vertices(unsigned long since, std::vector<Vertex>& vertices) const;
+
+public: //--- frozen connectivity
+
+  // counter that changes whenever the connectivity is modified
+  unsigned long topology_generation() const { return topology_generation_; };
+
+  // return flat CSR adjacency arrays of the current connectivity. The snapshot
+  // is built (in parallel) on first use and rebuilt once the topology
+  // generation has changed, references to an outdated snapshot become invalid.
+  const FrozenConnectivity& freeze() const;
+
 public: //--- geometry-related functions
 
 
   const Vec3& position(Vertex v) const { return vpoint_[v]; };
 
+  // deprecated: writes through the reference are not tracked, use
+  // set_position() (or call mark_moved(v) after them)
+  [[deprecated("untracked write access, use set_position() or the const overload")]]
   Vec3& position(Vertex v) { return vpoint_[v]; };
 
+  void set_position(Vertex v, const Vec3& p) { log_moved_vertex(v); vpoint_[v] = p; };
+
+  // deprecated: writes through the reference are not tracked, use
+  // points_matrix() of AttributeMatrix.h and call points_changed() after them
+  [[deprecated("untracked write access, use points_matrix() and points_changed() or the const overload")]]
   std::vector<Vec3>& points() { return vpoint_.vector(); };
 
+  const std::vector<Vec3>& points() const { return vpoint_.vector(); };
+
+  // how the normals of incident faces are combined into a vertex normal
+  enum Normal_weighting
+  {
+    UNIFORM_WEIGHTING,  // plain sum of unit face normals
+    AREA_WEIGHTING,     // face normals weighted by face area
+    ANGLE_WEIGHTING     // face normals weighted by the corner angle at the vertex
+  };
+
+  // compute "f:normal" for all faces (in parallel)
   void update_face_normals();
 
   Vec3 compute_face_normal(Face f) const;
 
-  void update_vertex_normals();
+  // compute "v:normal" for all vertices (in parallel), every face normal is
+  // computed once and gathered per vertex in a fixed order, so the result
+  // does not depend on the number of threads
+  void update_vertex_normals(Normal_weighting weighting = UNIFORM_WEIGHTING);
 
-  Vec3 compute_vertex_normal(Vertex v) const;
+  Vec3 compute_vertex_normal(Vertex v, Normal_weighting weighting = UNIFORM_WEIGHTING) const;
+
+  // bring "f:normal" and "v:normal" up to date with the vertex positions.
+  // The first call (and any call after a topology change) updates all
+  // normals, later calls only recompute the faces around the vertices moved
+  // since the previous call and the vertices of these faces.
+  void refresh_normals(Normal_weighting weighting = UNIFORM_WEIGHTING);
 
   Scalar edge_length(Edge e) const;
 
@@ -1324,6 +1467,7 @@ public: //--- allocate new elements
 
   Vertex new_vertex()
   {
+    ++topology_generation_;
     vattrs_.push_back();
     return Vertex(vertices_size() - 1);
   }
@@ -1332,6 +1476,7 @@ public: //--- allocate new elements
   {
     assert(start != end);
 
+    ++topology_generation_;
     eattrs_.push_back();
     hattrs_.push_back();
     hattrs_.push_back();
@@ -1342,15 +1487,47 @@ public: //--- allocate new elements
     set_vertex(h0, end);
     set_vertex(h1, start);
 
+    if (use_edge_index_)
+    {
+      edge_index_.insert(start.idx(), end.idx(), edge(h0).idx());
+    }
+
     return h0;
   }
 
   Face new_face()
   {
+    ++topology_generation_;
     fattrs_.push_back();
     return Face(faces_size() - 1);
   }
 
+protected: //--- custom attribute arrays for derived mesh types (see StaticPolygonMesh)
+
+  template <class ArrayType>
+  ArrayType* add_vertex_array(const std::string& name) { return vattrs_.add_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* add_halfedge_array(const std::string& name) { return hattrs_.add_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* add_edge_array(const std::string& name) { return eattrs_.add_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* add_face_array(const std::string& name) { return fattrs_.add_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* get_vertex_array(const std::string& name) const { return vattrs_.get_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* get_halfedge_array(const std::string& name) const { return hattrs_.get_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* get_edge_array(const std::string& name) const { return eattrs_.get_array<ArrayType>(name); };
+
+  template <class ArrayType>
+  ArrayType* get_face_array(const std::string& name) const { return fattrs_.get_array<ArrayType>(name); };
+
 private: //--- helper functions
 
 
@@ -1360,6 +1537,36 @@ private: //--- helper functions
 
   bool garbage() const { return garbage_; };
 
+  // normal of f scaled by twice the face area
+  Vec3 compute_face_area_normal(Face f) const;
+
+  // record a position change of v / of all vertices
+  void log_moved_vertex(Vertex v)
+  {
+    ++geometry_generation_;
+    // bound the log, once it outgrows the mesh a full update is cheaper anyway
+    if (moved_log_.size() >= std::max<size_t>(1024, vertices_size()))
+    {
+      log_moved_all();
+      return;
+    }
+    moved_log_.push_back(v);
+  }
+
+  void log_moved_all()
+  {
+    ++geometry_generation_;
+    moved_log_.clear();
+    moved_log_start_ = geometry_generation_;
+  }
+
+  // interior angle of the face of outgoing halfedge h at its from_vertex
+  Scalar corner_angle(Halfedge h) const;
+
+  // face normals of all faces in one parallel pass,
+  // unit length or scaled by twice the face area
+  void compute_face_normals(std::vector<Vec3>& normals, bool area_weighted) const;
+
 private: //------------------------------------------------------- private data
 
   friend bool read_poly(PolygonMesh& mesh, const std::string& filename);
@@ -1370,7 +1577,15 @@ private: //------------------------------------------------------- private data
   AttributeContainer fattrs_;
 
   Vertex_attribute<Vertex_connectivity>      vconn_;
+#ifdef LGMESH_HALFEDGE_SOA
+  // one array per halfedge connectivity field, traversals only touch what they read
+  Halfedge_attribute<Face>      hface_;
+  Halfedge_attribute<Vertex>    hvertex_;
+  Halfedge_attribute<Halfedge>  hnext_;
+  Halfedge_attribute<Halfedge>  hprev_;
+#else
   Halfedge_attribute<Halfedge_connectivity>  hconn_;
+#endif
   Face_attribute<Face_connectivity>          fconn_;
 
   Vertex_attribute<bool>  vdeleted_;
@@ -1386,6 +1601,30 @@ private: //------------------------------------------------------- private data
   unsigned int deleted_faces_;
   bool garbage_;
 
+  // vertex pair -> edge lookup, only maintained if use_edge_index_ is set
+  EdgeIndex edge_index_;
+  bool      use_edge_index_;
+
+  // vertices moved after generation moved_log_start_, entry i was logged
+  // at geometry generation moved_log_start_ + i + 1
+  unsigned long        geometry_generation_;
+  unsigned long        moved_log_start_;
+  std::vector<Vertex>  moved_log_;
+
+  // state of refresh_normals(): generations the normals correspond to and
+  // stamps to find affected elements without clearing per-element flags
+  bool                       normals_valid_;
+  Normal_weighting           normals_weighting_;
+  unsigned long              normals_topology_generation_;
+  unsigned long              normals_geometry_generation_;
+  unsigned int               refresh_stamp_;
+  std::vector<unsigned int>  refresh_vertex_stamp_;
+  std::vector<unsigned int>  refresh_face_stamp_;
+
+  // connectivity snapshot returned by freeze()
+  unsigned long                                       topology_generation_;
+  mutable std::shared_ptr<const FrozenConnectivity>   frozen_;
+
   // helper data for add_face()
   typedef std::pair<Halfedge, Halfedge>  NextCacheEntry;
   typedef std::vector<NextCacheEntry>    NextCache;
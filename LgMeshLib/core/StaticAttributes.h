@@ -0,0 +1,175 @@
+#ifndef LGMESH_STATICATTRIBUTES_H
+#define LGMESH_STATICATTRIBUTES_H
+
+#include "Attributes.h"
+
+#include <type_traits>
+
+namespace LG {
+
+// Compile-time attribute schemas.
+//
+// A schema is a list of tags, each tag names one typed attribute:
+//
+//   struct Normal_tag { typedef Vec3 value_type; };
+//   struct Label_tag  { typedef int  value_type; };
+//   typedef Static_schema<Normal_tag, Label_tag> My_vertex_schema;
+//
+// All arrays of a schema are direct members of one StaticAttributeArray, so
+// the attribute container sees the whole schema as a single array. Resizing,
+// push_back and swap are expanded inline over the members and element access
+// is a plain vector access without name lookup.
+
+template <class... Tags>
+struct Static_schema
+{
+  enum { size = sizeof...(Tags) };
+};
+
+
+// storage of a single tag inside a StaticAttributeArray
+template <class Tag>
+class StaticAttributeStorage
+{
+public:
+  typedef typename Tag::value_type   value_type;
+  typedef std::vector<value_type>    vector_type;
+
+  vector_type data_;
+};
+
+
+template <class Schema>
+class StaticAttributeArray;
+
+template <class... Tags>
+class StaticAttributeArray< Static_schema<Tags...> >
+  : public BaseAttributeArray, public StaticAttributeStorage<Tags>...
+{
+public:
+
+  typedef Static_schema<Tags...> schema_type;
+
+  StaticAttributeArray(const std::string& name) : BaseAttributeArray(name) {}
+
+public: // virtual interface of BaseAttributeArray
+
+  virtual void reserve(size_t n)
+  {
+    int expand[] = { 0, (storage<Tags>().reserve(n), 0)... };
+    (void)expand;
+  }
+
+  virtual void resize(size_t n)
+  {
+    int expand[] = { 0, (storage<Tags>().resize(n, typename Tags::value_type()), 0)... };
+    (void)expand;
+  }
+
+  virtual void push_back()
+  {
+    int expand[] = { 0, (storage<Tags>().push_back(typename Tags::value_type()), 0)... };
+    (void)expand;
+  }
+
+  virtual void free_memory()
+  {
+    int expand[] = { 0, (typename StaticAttributeStorage<Tags>::vector_type(storage<Tags>()).swap(storage<Tags>()), 0)... };
+    (void)expand;
+  }
+
+  virtual void swap(size_t i0, size_t i1)
+  {
+    int expand[] = { 0, (swap_elements(storage<Tags>(), i0, i1), 0)... };
+    (void)expand;
+  }
+
+  virtual BaseAttributeArray* clone() const
+  {
+    return new StaticAttributeArray(*this);
+  }
+
+  virtual const std::type_info& type() { return typeid(schema_type); };
+
+public:
+
+  // Get reference to the array of attribute Tag
+  template <class Tag>
+  typename StaticAttributeStorage<Tag>::vector_type& storage()
+  {
+    return static_cast<StaticAttributeStorage<Tag>&>(*this).data_;
+  }
+
+  template <class Tag>
+  const typename StaticAttributeStorage<Tag>::vector_type& storage() const
+  {
+    return static_cast<const StaticAttributeStorage<Tag>&>(*this).data_;
+  }
+
+private:
+
+  // swap by value, also works for the proxy references of std::vector<bool>
+  template <class Vector>
+  static void swap_elements(Vector& v, size_t i0, size_t i1)
+  {
+    typename Vector::value_type d(v[i0]);
+    v[i0] = v[i1];
+    v[i1] = d;
+  }
+};
+
+// Does the schema declare attribute Tag?
+template <class Tag, class Schema>
+struct schema_contains
+  : std::is_base_of< StaticAttributeStorage<Tag>, StaticAttributeArray<Schema> > {};
+
+
+// Typed handle to one attribute of a StaticAttributeArray, indexed by the
+// mesh handle type of the element it is attached to
+template <class Tag, class Handle>
+class Static_attribute
+{
+public:
+
+  typedef typename StaticAttributeStorage<Tag>::vector_type  vector_type;
+  typedef typename vector_type::reference                    reference;
+  typedef typename vector_type::const_reference              const_reference;
+
+  Static_attribute(StaticAttributeStorage<Tag>* storage = NULL) : storage_(storage) {}
+
+  operator bool() const
+  {
+    return storage_ != NULL;
+  }
+
+  reference operator[](Handle h)
+  {
+    assert(storage_ != NULL && size_t(h.idx()) < storage_->data_.size());
+    return storage_->data_[h.idx()];
+  }
+
+  const_reference operator[](Handle h) const
+  {
+    assert(storage_ != NULL && size_t(h.idx()) < storage_->data_.size());
+    return storage_->data_[h.idx()];
+  }
+
+  vector_type& vector()
+  {
+    assert(storage_ != NULL);
+    return storage_->data_;
+  }
+
+  const vector_type& vector() const
+  {
+    assert(storage_ != NULL);
+    return storage_->data_;
+  }
+
+private:
+  StaticAttributeStorage<Tag>* storage_;
+};
+
+}
+
+#endif // !LGMESH_STATICATTRIBUTES_H
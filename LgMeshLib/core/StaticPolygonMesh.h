@@ -0,0 +1,146 @@
+#ifndef StaticPolygonMesh_H
+#define StaticPolygonMesh_H
+
+#include "PolygonMesh.h"
+#include "StaticAttributes.h"
+
+namespace LG {
+
+// PolygonMesh with compile-time attribute schemas for its elements, e.g.
+//
+//   struct Normal_tag { typedef Vec3 value_type; };
+//   struct Color_tag  { typedef Vec3 value_type; };
+//   struct UV_tag     { typedef Vec2 value_type; };
+//   struct Label_tag  { typedef int  value_type; };
+//
+//   typedef StaticPolygonMesh< Static_schema<Normal_tag, Color_tag>,
+//                              Static_schema<UV_tag>,
+//                              Static_schema<>,
+//                              Static_schema<Label_tag> > ScanMesh;
+//
+//   ScanMesh mesh;
+//   ScanMesh::Attribute<Normal_tag>::type normals = mesh.attribute<Normal_tag>();
+//   normals[v] = n;
+//
+// Each schema is stored as one block in the corresponding attribute container,
+// so allocating, swapping or resizing elements costs one virtual call per
+// container for the whole schema, and attribute access never looks up names.
+// Runtime attributes (add_vertex_attribute() etc.) keep working alongside.
+template <class VertexSchema,
+          class HalfedgeSchema = Static_schema<>,
+          class EdgeSchema     = Static_schema<>,
+          class FaceSchema     = Static_schema<> >
+class StaticPolygonMesh : public PolygonMesh
+{
+public:
+
+  typedef StaticAttributeArray<VertexSchema>    Vertex_array;
+  typedef StaticAttributeArray<HalfedgeSchema>  Halfedge_array;
+  typedef StaticAttributeArray<EdgeSchema>      Edge_array;
+  typedef StaticAttributeArray<FaceSchema>      Face_array;
+
+  // element type and handle type of the attribute declared by Tag
+  template <class Tag>
+  struct Attribute
+  {
+    enum
+    {
+      in_vertices  = schema_contains<Tag, VertexSchema>::value,
+      in_halfedges = schema_contains<Tag, HalfedgeSchema>::value,
+      in_edges     = schema_contains<Tag, EdgeSchema>::value,
+      in_faces     = schema_contains<Tag, FaceSchema>::value
+    };
+
+    static_assert(in_vertices + in_halfedges + in_edges + in_faces == 1,
+                  "an attribute tag has to be declared in exactly one schema");
+
+    typedef typename std::conditional<in_vertices,  Vertex,
+            typename std::conditional<in_halfedges, Halfedge,
+            typename std::conditional<in_edges,     Edge,
+                                                    Face>::type>::type>::type handle_type;
+
+    typedef Static_attribute<Tag, handle_type> type;
+  };
+
+public: //--- constructor / destructor
+
+  StaticPolygonMesh()
+  {
+    vertex_array_   = (VertexSchema::size   > 0) ? add_vertex_array<Vertex_array>("v:static")       : NULL;
+    halfedge_array_ = (HalfedgeSchema::size > 0) ? add_halfedge_array<Halfedge_array>("h:static")   : NULL;
+    edge_array_     = (EdgeSchema::size     > 0) ? add_edge_array<Edge_array>("e:static")           : NULL;
+    face_array_     = (FaceSchema::size     > 0) ? add_face_array<Face_array>("f:static")           : NULL;
+  }
+
+  StaticPolygonMesh(const StaticPolygonMesh& rhs) : PolygonMesh(rhs)
+  {
+    fetch_arrays();
+  }
+
+  StaticPolygonMesh& operator=(const StaticPolygonMesh& rhs)
+  {
+    if (this != &rhs)
+    {
+      PolygonMesh::operator=(rhs);
+      // arrays were deep copied, update the pointers
+      fetch_arrays();
+    }
+    return *this;
+  }
+
+public: //--- static attribute access
+
+  // handle of the attribute declared by Tag, no lookup involved
+  template <class Tag>
+  typename Attribute<Tag>::type attribute()
+  {
+    return typename Attribute<Tag>::type(storage<Tag>(typename Attribute<Tag>::handle_type()));
+  }
+
+  // direct access to the value of attribute Tag for element h
+  template <class Tag>
+  typename Attribute<Tag>::type::reference get(typename Attribute<Tag>::handle_type h)
+  {
+    return storage<Tag>(h)->data_[h.idx()];
+  }
+
+  template <class Tag>
+  typename Attribute<Tag>::type::const_reference get(typename Attribute<Tag>::handle_type h) const
+  {
+    return const_cast<StaticPolygonMesh*>(this)->storage<Tag>(h)->data_[h.idx()];
+  }
+
+private:
+
+  // select the block by the handle type, the derived-to-base conversion
+  // picks the member array of Tag
+  template <class Tag>
+  StaticAttributeStorage<Tag>* storage(Vertex)   { return vertex_array_; };
+
+  template <class Tag>
+  StaticAttributeStorage<Tag>* storage(Halfedge) { return halfedge_array_; };
+
+  template <class Tag>
+  StaticAttributeStorage<Tag>* storage(Edge)     { return edge_array_; };
+
+  template <class Tag>
+  StaticAttributeStorage<Tag>* storage(Face)     { return face_array_; };
+
+  void fetch_arrays()
+  {
+    vertex_array_   = get_vertex_array<Vertex_array>("v:static");
+    halfedge_array_ = get_halfedge_array<Halfedge_array>("h:static");
+    edge_array_     = get_edge_array<Edge_array>("e:static");
+    face_array_     = get_face_array<Face_array>("f:static");
+  }
+
+private:
+  Vertex_array*    vertex_array_;
+  Halfedge_array*  halfedge_array_;
+  Edge_array*      edge_array_;
+  Face_array*      face_array_;
+};
+
+}
+
+#endif // !StaticPolygonMesh_H
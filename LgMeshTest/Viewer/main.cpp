@@ -78,6 +78,7 @@ int main( int argc, char** argv )
     LG::PolygonMesh::Face_iterator   fit;
     LG::PolygonMesh::Vertex_around_face_circulator vfc, vfc_end;
     LG::PolygonMesh::Face_attribute<LG::Vec3> f_normals = mesh.get_face_attribute<LG::Vec3>("f:normal");
+    const LG::PolygonMesh& cmesh = mesh;
 
     for (fit = mesh.faces_begin(); fit != mesh.faces_end(); ++fit)
     {
@@ -90,7 +91,7 @@ int main( int argc, char** argv )
 
       do 
       {
-        LG::Vec3 vp = mesh.position((*vfc));
+        LG::Vec3 vp = cmesh.position((*vfc));
         glVertex3d ( vp.x(), vp.y(), vp.z());
       } while (++vfc != vfc_end);
 
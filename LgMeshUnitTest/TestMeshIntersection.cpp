@@ -0,0 +1,76 @@
+#include "UnitTest.h"
+#include "BVH.h"
+#include "MeshIntersection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace LG {
+
+namespace {
+
+Scalar plane_distance(const Vec3 t[3], const Vec3& x)
+{
+  const Vec3 n = (t[1] - t[0]).cross(t[2] - t[0]).normalized();
+  return std::abs(n.dot(x - t[0]));
+}
+
+}
+
+// Two icospheres of different levels share the 12 icosahedron corners and
+// touch along the edges of the coarser one, so many triangle pairs meet in
+// a vertex lying exactly in the other plane. The end points of all
+// intersection segments have to lie in both triangle planes.
+bool test_touching_intersection()
+{
+  PolygonMesh a, b;
+  make_icosphere(a, 4);
+  make_icosphere(b, 3);
+  const BVH bvh_a(a), bvh_b(b);
+
+  std::vector<Triangle_intersection> result;
+  intersect(bvh_a, bvh_b, result, true);
+
+  const PolygonMesh& ca = a;
+  const PolygonMesh& cb = b;
+  size_t pairs = 0, wrong = 0;
+  Scalar worst = 0;
+  for (size_t i = 0; i < result.size(); ++i)
+  {
+    const Triangle_intersection& x = result[i];
+    if (x.coplanar)
+    {
+      continue;
+    }
+    ++pairs;
+    const BVH::Triangle& ta = bvh_a.triangle(x.triangle[0]);
+    const BVH::Triangle& tb = bvh_b.triangle(x.triangle[1]);
+    Vec3 p[3], q[3];
+    for (int k = 0; k < 3; ++k)
+    {
+      p[k] = ca.position(ta.vertices[k]);
+      q[k] = cb.position(tb.vertices[k]);
+    }
+    for (int s = 0; s < 2; ++s)
+    {
+      const Scalar d = std::max(plane_distance(p, x.segment[s]), plane_distance(q, x.segment[s]));
+      worst = std::max(worst, d);
+      if (!(d <= Scalar(1e-4)))
+      {
+        ++wrong;
+      }
+    }
+  }
+
+  if (pairs == 0 || wrong > 0)
+  {
+    std::cerr << "test_touching_intersection: " << wrong << " of " << 2 * pairs
+              << " segment points off the triangle planes, up to " << worst << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,117 @@
+#include "UnitTest.h"
+#include "Parallel.h"
+#include "ShortestPaths.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace LG {
+
+namespace {
+
+// a nested parallel_for of uneven length per outer index i. The sleeping
+// ranges let a waiting thread run out of own tasks while others are still
+// busy, so that it looks for more work elsewhere.
+void nested_work(size_t i, std::atomic<size_t>& counter)
+{
+  parallel_for(0, 1 + i * 7 % 5, 1, [&](size_t first, size_t last)
+  {
+    for (size_t k = first; k < last; ++k)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      ++counter;
+    }
+  });
+}
+
+}
+
+// A task holding its Thread_local_storage instance must not get it handed
+// out again while it waits for a nested parallel_for.
+bool test_nested_parallelism()
+{
+  ThreadPool* pool = ThreadPool::GetInstance();
+  const unsigned int thread_count = pool->thread_count();
+  // enough threads to have idle ones steal while others wait
+  pool->set_thread_count(std::max(16u, thread_count));
+
+  bool passed = true;
+
+  // the instance stays marked busy during the nested loop
+  {
+    Thread_local_storage<int> busy(0);
+    std::atomic<size_t> reentered(0), counter(0);
+    for (int round = 0; round < 10; ++round)
+    {
+      parallel_for(0, 64, 1, [&](size_t first, size_t last)
+      {
+        for (size_t i = first; i < last; ++i)
+        {
+          int& b = busy.local();
+          if (b)
+          {
+            ++reentered;
+          }
+          b = 1;
+          nested_work(i, counter);
+          b = 0;
+        }
+      });
+    }
+    if (reentered > 0)
+    {
+      std::cerr << "test_nested_parallelism: " << reentered << " instances handed out while in use" << std::endl;
+      passed = false;
+    }
+  }
+
+  // the results of run_parallel() survive a nested parallel_for in fn
+  {
+    PolygonMesh mesh;
+    make_torus(mesh, 32);
+    const size_t n = mesh.n_vertices();
+
+    std::vector< std::vector<PolygonMesh::Vertex> > source_sets;
+    for (size_t i = 0; i < 64; ++i)
+    {
+      source_sets.push_back(std::vector<PolygonMesh::Vertex>(1, PolygonMesh::Vertex((int)(i * 37 % n))));
+    }
+
+    ShortestPaths serial(mesh);
+    std::vector<Scalar> expected(source_sets.size());
+    for (size_t i = 0; i < source_sets.size(); ++i)
+    {
+      serial.run(source_sets[i]);
+      expected[i] = serial.distance(PolygonMesh::Vertex((int)(i * 53 % n)));
+    }
+
+    std::atomic<size_t> wrong(0), counter(0);
+    for (int round = 0; round < 10; ++round)
+    {
+      serial.run_parallel(source_sets, [&](size_t i, const ShortestPaths& result)
+      {
+        nested_work(i, counter);
+        if (result.distance(PolygonMesh::Vertex((int)(i * 53 % n))) != expected[i])
+        {
+          ++wrong;
+        }
+      });
+    }
+    if (wrong > 0)
+    {
+      std::cerr << "test_nested_parallelism: " << wrong << " of " << 10 * source_sets.size()
+                << " run_parallel() results changed during a nested parallel_for" << std::endl;
+      passed = false;
+    }
+  }
+
+  pool->set_thread_count(thread_count);
+  return passed;
+}
+
+}
@@ -0,0 +1,96 @@
+#include "UnitTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace LG {
+
+void make_torus(PolygonMesh& mesh, int n)
+{
+  const int m = std::max(4, n / 2);
+  const Scalar pi = Scalar(3.14159265358979);
+  std::vector<Vec3> points((size_t)n * m);
+  for (int i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < m; ++j)
+    {
+      const Scalar u = 2 * pi * i / n, v = 2 * pi * j / m;
+      const Scalar r = Scalar(0.35);
+      points[(size_t)i * m + j] = Vec3((1 + r * std::cos(v)) * std::cos(u),
+                                       (1 + r * std::cos(v)) * std::sin(u),
+                                       r * std::sin(v));
+    }
+  }
+
+  std::vector<int> triangles;
+  triangles.reserve((size_t)6 * n * m);
+  for (int i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < m; ++j)
+    {
+      const int a = i * m + j, b = ((i + 1) % n) * m + j;
+      const int c = ((i + 1) % n) * m + (j + 1) % m, d = i * m + (j + 1) % m;
+      const int t[6] = { a, b, c, a, c, d };
+      triangles.insert(triangles.end(), t, t + 6);
+    }
+  }
+  mesh.add_triangles(points, triangles);
+}
+
+void make_icosphere(PolygonMesh& mesh, int level)
+{
+  const Scalar g = (1 + std::sqrt(Scalar(5))) / 2;
+  const Scalar corners[12][3] =
+  {
+    { -1, g, 0 }, { 1, g, 0 }, { -1, -g, 0 }, { 1, -g, 0 },
+    { 0, -1, g }, { 0, 1, g }, { 0, -1, -g }, { 0, 1, -g },
+    { g, 0, -1 }, { g, 0, 1 }, { -g, 0, -1 }, { -g, 0, 1 }
+  };
+  const int faces[20][3] =
+  {
+    { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+    { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+    { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+    { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+  };
+
+  std::vector<Vec3> points;
+  for (int i = 0; i < 12; ++i)
+  {
+    points.push_back(Vec3(corners[i][0], corners[i][1], corners[i][2]).normalized());
+  }
+  std::vector<int> triangles(&faces[0][0], &faces[0][0] + 60);
+
+  for (int l = 0; l < level; ++l)
+  {
+    // one new vertex per edge, shared by both of its triangles
+    std::map<std::pair<int, int>, int> midpoints;
+    auto midpoint = [&](int a, int b)
+    {
+      const std::pair<int, int> key(std::min(a, b), std::max(a, b));
+      std::map<std::pair<int, int>, int>::const_iterator it = midpoints.find(key);
+      if (it != midpoints.end())
+      {
+        return it->second;
+      }
+      points.push_back((points[a] + points[b]).normalized());
+      return midpoints[key] = (int)points.size() - 1;
+    };
+
+    std::vector<int> split;
+    for (size_t t = 0; t < triangles.size(); t += 3)
+    {
+      const int a = triangles[t], b = triangles[t + 1], c = triangles[t + 2];
+      const int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      const int children[12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+      split.insert(split.end(), children, children + 12);
+    }
+    triangles.swap(split);
+  }
+  mesh.add_triangles(points, triangles);
+}
+
+}
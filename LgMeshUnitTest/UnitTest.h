@@ -0,0 +1,24 @@
+#ifndef LGMESH_UNITTEST_H
+#define LGMESH_UNITTEST_H
+
+#include "PolygonMesh.h"
+
+namespace LG {
+
+// closed torus of n x (n / 2) quads split into triangles, built with
+// add_triangles()
+void make_torus(PolygonMesh& mesh, int n);
+
+// unit sphere around the origin: icosahedron with every triangle split into
+// four level times, vertices projected to the sphere
+void make_icosphere(PolygonMesh& mesh, int level);
+
+
+// the tests, return false (and report to std::cerr) on failure
+
+bool test_nested_parallelism();
+bool test_touching_intersection();
+
+}
+
+#endif // !LGMESH_UNITTEST_H
@@ -0,0 +1,46 @@
+// Regression tests of the library.
+//
+//   LgMeshUnitTest [test ...]
+//
+// Runs the tests given by name, all if none is given, and exits with 1 if
+// any of them fails. Every test is also registered with ctest (enable
+// LGMESH_BUILD_TESTS).
+
+#include "UnitTest.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+  using namespace LG;
+
+  struct Entry
+  {
+    const char* name;
+    bool (*run)();
+  };
+  const Entry tests[] =
+  {
+    { "nested_parallelism",    test_nested_parallelism },
+    { "touching_intersection", test_touching_intersection }
+  };
+
+  int failed = 0;
+  for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); ++t)
+  {
+    bool selected = argc < 2;
+    for (int k = 1; k < argc; ++k)
+    {
+      selected |= !std::strcmp(argv[k], tests[t].name);
+    }
+    if (selected)
+    {
+      const bool passed = tests[t].run();
+      std::printf("%-24s %s\n", tests[t].name, passed ? "passed" : "FAILED");
+      failed += passed ? 0 : 1;
+    }
+  }
+  return failed > 0 ? 1 : 0;
+}